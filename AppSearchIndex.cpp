@@ -0,0 +1,219 @@
+// AppSearchIndex.cpp
+// Separate name and path posting lists keyed by packed trigrams, plus word-start grams
+// (boundary, boundary, c) and (boundary, c, d) so short queries act as word prefixes.
+// Queries count hits per id in a dense scratch array, score every candidate and keep the top k.
+#include "AppSearchIndex.h"
+#include <algorithm>
+#include <cwctype>
+#include <iterator>
+
+namespace {
+    const std::uint32_t kBoundary = 0x1FFFFF; // outside Unicode, so never a folded character
+    const std::size_t kMaxQueryGrams = 255;   // per-id hit counters are one byte
+
+    std::uint64_t Gram(std::uint32_t a, std::uint32_t b, std::uint32_t c) {
+        return ((std::uint64_t)(a & 0x1FFFFF) << 42) | ((std::uint64_t)(b & 0x1FFFFF) << 21) | (c & 0x1FFFFF);
+    }
+
+    std::wstring Fold(const std::wstring& s, bool path) {
+        std::wstring out(s);
+        for (auto& c : out) c = (path && c == L'/') ? L'\\' : (wchar_t)std::towlower(c);
+        return out;
+    }
+
+    bool WordStart(const std::wstring& s, std::size_t i) {
+        return std::iswalnum(s[i]) && (i == 0 || !std::iswalnum(s[i - 1]));
+    }
+
+    // Sorted, distinct grams of one folded field; word-start grams only from wordsFrom on,
+    // so a path's directories (all starting "c:\") do not match every short query
+    void Grams(const std::wstring& s, std::size_t wordsFrom, std::vector<std::uint64_t>& out) {
+        out.clear();
+        for (std::size_t i = 0; i < s.size(); ++i) {
+            if (i + 2 < s.size()) out.push_back(Gram(s[i], s[i + 1], s[i + 2]));
+            if (i >= wordsFrom && WordStart(s, i)) {
+                out.push_back(Gram(kBoundary, kBoundary, s[i]));
+                if (i + 1 < s.size()) out.push_back(Gram(kBoundary, s[i], s[i + 1]));
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    void QueryGrams(const std::wstring& q, std::vector<std::uint64_t>& out) {
+        out.clear();
+        if (q.empty()) return;
+        if (q.size() == 1) { out.push_back(Gram(kBoundary, kBoundary, q[0])); return; }
+        for (std::size_t i = 0; i + 2 < q.size(); ++i) out.push_back(Gram(q[i], q[i + 1], q[i + 2]));
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        // The word-start gram sorts last (kBoundary is in the high bits), so it is added after
+        // truncating the trigrams; Search relies on every query having exactly one
+        if (out.size() >= kMaxQueryGrams) out.resize(kMaxQueryGrams - 1);
+        out.push_back(Gram(kBoundary, q[0], q[1])); // rewards matches at the start of a word
+    }
+
+    const int kCountWeight = 20;
+    const std::uint32_t kNameHit = 0x100, kWordStartHit = 0x10000; // path hits count in the low byte
+
+    // First two folded characters of a name and its length capped at 3, enough to score
+    // one- and two-character queries without touching the entry
+    std::uint64_t NameHead(const std::wstring& name) {
+        return Gram((std::uint32_t)std::min<std::size_t>(name.size(), 3), name.size() > 0 ? name[0] : 0, name.size() > 1 ? name[1] : 0);
+    }
+
+    // Bonus for the query as a literal part of the folded name. Only called when every query
+    // trigram hit the name, or for a one- or two-character query that matched a word start.
+    int NameBonus(const std::wstring& name, const std::wstring& q) {
+        if (name == q) return 400;
+        if (name.compare(0, q.size(), q) == 0) return 200;
+        const std::size_t at = name.find(q);
+        if (at == std::wstring::npos) return 0;
+        return WordStart(name, at) ? 150 : 100;
+    }
+
+    // The same bonus for a one- or two-character query, from the name's head
+    int ShortNameBonus(std::uint64_t head, const std::wstring& q) {
+        const bool two = q.size() > 1;
+        const std::uint64_t mask = Gram(0, 0x1FFFFF, two ? 0x1FFFFF : 0);
+        if ((head & mask) != Gram(0, q[0], two ? q[1] : 0)) return 150;
+        return (head >> 42) == q.size() ? 400 : 200;
+    }
+
+    const std::uint8_t kDeadSlot = 0xFF;
+    std::uint8_t LengthPenalty(const std::wstring& name) { return (std::uint8_t)(std::min<std::size_t>(name.size(), 100) / 4); }
+
+    void Trim(std::wstring& s) {
+        while (!s.empty() && std::iswspace(s.back())) s.pop_back();
+        std::size_t i = 0;
+        while (i < s.size() && std::iswspace(s[i])) ++i;
+        s.erase(0, i);
+    }
+}
+
+void AppSearchIndex::Build(const std::vector<ApplicationInfo>& apps) {
+    entries.clear();
+    penalty.clear();
+    heads.clear();
+    byPath.clear();
+    nameGrams.clear();
+    pathGrams.clear();
+    live = dead = 0;
+    entries.reserve(apps.size());
+    penalty.reserve(apps.size());
+    heads.reserve(apps.size());
+    for (const auto& app : apps) Add(app);
+}
+
+AppIndexUpdate AppSearchIndex::Update(const std::vector<ApplicationInfo>& apps) {
+    AppIndexUpdate update;
+    std::unordered_map<std::wstring, const ApplicationInfo*> incoming;
+    incoming.reserve(apps.size());
+    for (const auto& app : apps) incoming[Fold(app.exePath, true)] = &app;
+    std::vector<std::uint32_t> stale;
+    for (const auto& kv : byPath) {
+        auto it = incoming.find(kv.first);
+        const ApplicationInfo& had = entries[kv.second].app;
+        if (it == incoming.end() || it->second->name != had.name || it->second->source != had.source || it->second->isUWP != had.isUWP) stale.push_back(kv.second);
+    }
+    for (auto id : stale) update.removed += Remove(id) ? 1 : 0;
+    for (const auto& app : apps) {
+        if (byPath.count(Fold(app.exePath, true))) continue;
+        Add(*incoming[Fold(app.exePath, true)]); // the last duplicate of a path wins, as in Build
+        ++update.added;
+    }
+    return update;
+}
+
+std::uint32_t AppSearchIndex::Add(const ApplicationInfo& app) {
+    Entry e;
+    e.app = app;
+    e.name = Fold(app.name, false);
+    e.path = Fold(app.exePath, true);
+    e.alive = true;
+    auto existing = byPath.find(e.path);
+    if (existing != byPath.end()) Remove(existing->second);
+    const auto id = (std::uint32_t)entries.size();
+    entries.push_back(std::move(e));
+    byPath[entries[id].path] = id;
+    penalty.push_back(LengthPenalty(entries[id].name));
+    heads.push_back(NameHead(entries[id].name));
+    ++live;
+    IndexEntry(id);
+    return id;
+}
+
+void AppSearchIndex::IndexEntry(std::uint32_t id) {
+    // New ids are always the largest, so appending keeps every posting list ascending
+    std::vector<std::uint64_t> grams;
+    const Entry& e = entries[id];
+    Grams(e.name, 0, grams);
+    for (auto g : grams) nameGrams[g].push_back(id);
+    const std::size_t slash = e.path.find_last_of(L'\\');
+    Grams(e.path, slash == std::wstring::npos ? 0 : slash + 1, grams);
+    for (auto g : grams) pathGrams[g].push_back(id);
+}
+
+bool AppSearchIndex::Remove(std::uint32_t id) {
+    if (id >= entries.size() || !entries[id].alive) return false;
+    Entry& e = entries[id];
+    byPath.erase(e.path);
+    e = Entry(); // the slot stays reserved; its postings are skipped until compaction
+    penalty[id] = kDeadSlot;
+    --live;
+    ++dead;
+    if (dead > 1024 && dead > live / 4) Compact();
+    return true;
+}
+
+void AppSearchIndex::Compact() {
+    for (Postings* postings : { &nameGrams, &pathGrams }) {
+        for (auto it = postings->begin(); it != postings->end(); ) {
+            auto& ids = it->second;
+            ids.erase(std::remove_if(ids.begin(), ids.end(), [&](std::uint32_t id) { return penalty[id] == kDeadSlot; }), ids.end());
+            it = ids.empty() ? postings->erase(it) : std::next(it);
+        }
+    }
+    dead = 0;
+}
+
+std::vector<AppSearchHit> AppSearchIndex::Search(const std::wstring& query, std::size_t k) {
+    std::vector<AppSearchHit> hits;
+    std::wstring q = Fold(query, false);
+    Trim(q);
+    std::vector<std::uint64_t> grams;
+    QueryGrams(q, grams);
+    if (grams.empty() || k == 0) return hits;
+    const std::size_t need = (grams.size() + 1) / 2;
+
+    // Per-id hit counters: word-start name hits, name trigram hits and path hits, one byte each
+    if (hitCounts.size() < entries.size()) hitCounts.resize(entries.size());
+    touched.clear();
+    for (auto g : grams) {
+        const std::uint32_t nameHit = (g >> 42) == kBoundary ? kWordStartHit : kNameHit;
+        auto n = nameGrams.find(g);
+        if (n != nameGrams.end()) for (auto id : n->second) { if (!hitCounts[id]) touched.push_back(id); hitCounts[id] += nameHit; }
+        auto p = pathGrams.find(g);
+        if (p != pathGrams.end()) for (auto id : p->second) { if (!hitCounts[id]) touched.push_back(id); ++hitCounts[id]; }
+    }
+    // Name hits outweigh path hits: every path shares "c:\" and ".exe"
+    const std::size_t trigrams = grams.size() - 1; // every query has exactly one word-start gram
+    // The best k so far in a heap with the worst on top, so most candidates cost one compare
+    auto better = [](const AppSearchHit& a, const AppSearchHit& b) { return a.score != b.score ? a.score > b.score : a.id < b.id; };
+    hits.reserve(k + 1);
+    for (auto id : touched) {
+        const std::uint32_t c = hitCounts[id];
+        hitCounts[id] = 0;
+        const std::size_t nameTrigrams = (c >> 8) & 0xFF, nh = nameTrigrams + (c >> 16), ph = c & 0xFF;
+        if (penalty[id] == kDeadSlot || std::max(nh, ph) < need) continue;
+        const int count = (int)(nh * 4 + ph);
+        // Shorter names win ties
+        AppSearchHit hit{id, count * kCountWeight - penalty[id]};
+        if (!trigrams) hit.score += nh ? ShortNameBonus(heads[id], q) : 0;
+        else if (nameTrigrams >= trigrams) hit.score += NameBonus(entries[id].name, q);
+        if (hits.size() < k) { hits.push_back(hit); std::push_heap(hits.begin(), hits.end(), better); }
+        else if (better(hit, hits.front())) { std::pop_heap(hits.begin(), hits.end(), better); hits.back() = hit; std::push_heap(hits.begin(), hits.end(), better); }
+    }
+    std::sort_heap(hits.begin(), hits.end(), better);
+    return hits;
+}
@@ -0,0 +1,63 @@
+// AppSearchIndex.h
+// Trigram inverted index over the installed-app inventory for ranked, typo-tolerant
+// type-to-filter search, updated incrementally when the inventory is refreshed
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ApplicationInfo.h"
+
+struct AppSearchHit {
+    std::uint32_t id = 0; // see AppSearchIndex::App
+    int score = 0;
+};
+
+struct AppIndexUpdate {
+    std::size_t added = 0;
+    std::size_t removed = 0;
+};
+
+class AppSearchIndex {
+public:
+    // Replaces the contents with apps
+    void Build(const std::vector<ApplicationInfo>& apps);
+    // Diffs a refreshed inventory against the index by case-folded path: only entries that
+    // appeared, disappeared or changed name/source are touched
+    AppIndexUpdate Update(const std::vector<ApplicationInfo>& apps);
+    std::uint32_t Add(const ApplicationInfo& app);
+    bool Remove(std::uint32_t id);
+
+    // Best k entries, best first. Names and paths are case-folded; a match needs at least
+    // half of the query's trigrams, so small typos still rank. One- and two-character
+    // queries match the start of a word. Not thread-safe: scoring uses member scratch.
+    std::vector<AppSearchHit> Search(const std::wstring& query, std::size_t k);
+
+    const ApplicationInfo& App(std::uint32_t id) const { return entries[id].app; }
+    std::size_t Size() const { return live; }
+
+private:
+    struct Entry {
+        ApplicationInfo app;
+        std::wstring name; // case-folded
+        std::wstring path; // case-folded, backslash-separated
+        bool alive = false;
+    };
+    using Postings = std::unordered_map<std::uint64_t, std::vector<std::uint32_t>>;
+
+    void IndexEntry(std::uint32_t id);
+    void Compact();
+
+    std::vector<Entry> entries;      // ids are positions; removed slots stay dead until Build
+    std::vector<std::uint8_t> penalty; // per id: name-length tie-break, or 0xFF for a dead slot;
+                                       // kept apart from entries so scoring stays in cache
+    std::vector<std::uint64_t> heads;  // per id: packed start of the name, for short queries
+    std::unordered_map<std::wstring, std::uint32_t> byPath; // folded path -> live id
+    Postings nameGrams;              // ascending ids per trigram
+    Postings pathGrams;
+    std::size_t live = 0;
+    std::size_t dead = 0;            // removed ids still present in posting lists
+    std::vector<std::uint32_t> hitCounts; // per-id scratch for Search
+    std::vector<std::uint32_t> touched;
+};
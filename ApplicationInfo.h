@@ -6,6 +6,6 @@
 struct ApplicationInfo {
     std::wstring name;    // Display name of the app
     std::wstring exePath; // Full path to executable (or install path for UWP)
-    std::wstring source;  // "Registry", "UWP", "Filesystem", "Process"
+    std::wstring source;  // "Registry", "StartMenu", "UWP", "Filesystem", "Process"
     bool isUWP = false;   // true if UWP app
 };
@@ -0,0 +1,215 @@
+// ConnectionQuery.cpp
+// Implements query parsing, compiled port bitmaps and CIDR prefix tables
+#include "ConnectionQuery.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+static std::vector<std::string> Split(const std::string& s, char sep) {
+    std::vector<std::string> parts;
+    std::string cur;
+    std::istringstream iss(s);
+    while (std::getline(iss, cur, sep)) if (!cur.empty()) parts.push_back(cur);
+    return parts;
+}
+
+static std::string Lower(std::string s) {
+    for (auto& c : s) c = (char)std::tolower((unsigned char)c);
+    return s;
+}
+
+static bool ParseUint(const std::string& s, unsigned long maxValue, unsigned long& out) {
+    if (s.empty() || s.size() > 10) return false;
+    for (char c : s) if (!std::isdigit((unsigned char)c)) return false;
+    out = std::strtoul(s.c_str(), nullptr, 10);
+    return out <= maxValue;
+}
+
+static bool GlobMatch(const char* pat, const char* str) {
+    const char* star = nullptr; const char* retry = nullptr;
+    while (*str) {
+        if (*pat == '?' || *pat == *str) { ++pat; ++str; continue; }
+        if (*pat == '*') { star = pat++; retry = str; continue; }
+        if (!star) return false;
+        pat = star + 1; str = ++retry;
+    }
+    while (*pat == '*') ++pat;
+    return *pat == 0;
+}
+
+bool ParseIpAddress(const std::string& text, std::uint8_t out[16], bool& ipv6) {
+    std::memset(out, 0, 16);
+    if (text.find(':') == std::string::npos) {
+        auto octets = Split(text, '.');
+        if (octets.size() != 4 || std::count(text.begin(), text.end(), '.') != 3) return false;
+        for (int i = 0; i < 4; ++i) {
+            unsigned long v; if (!ParseUint(octets[(std::size_t)i], 255, v)) return false;
+            out[i] = (std::uint8_t)v;
+        }
+        ipv6 = false;
+        return true;
+    }
+    // IPv6: at most one "::", up to 8 hex groups
+    std::size_t dc = text.find("::");
+    if (dc != std::string::npos && text.find("::", dc + 1) != std::string::npos) return false;
+    auto parseGroups = [](const std::string& s, std::vector<std::uint16_t>& g) {
+        if (s.empty()) return true;
+        std::size_t start = 0;
+        while (true) {
+            std::size_t end = s.find(':', start);
+            std::string h = s.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            if (h.empty() || h.size() > 4) return false;
+            for (char c : h) if (!std::isxdigit((unsigned char)c)) return false;
+            g.push_back((std::uint16_t)std::strtoul(h.c_str(), nullptr, 16));
+            if (end == std::string::npos) return true;
+            start = end + 1;
+        }
+    };
+    std::vector<std::uint16_t> head, tail;
+    if (dc == std::string::npos) {
+        if (!parseGroups(text, head) || head.size() != 8) return false;
+    } else {
+        if (!parseGroups(text.substr(0, dc), head) || !parseGroups(text.substr(dc + 2), tail)) return false;
+        if (head.size() + tail.size() > 7) return false;
+    }
+    for (std::size_t i = 0; i < head.size(); ++i) { out[2*i] = (std::uint8_t)(head[i] >> 8); out[2*i+1] = (std::uint8_t)head[i]; }
+    std::size_t off = 8 - tail.size();
+    for (std::size_t i = 0; i < tail.size(); ++i) { out[2*(off+i)] = (std::uint8_t)(tail[i] >> 8); out[2*(off+i)+1] = (std::uint8_t)tail[i]; }
+    ipv6 = true;
+    return true;
+}
+
+static std::uint64_t LoadBE64(const std::uint8_t* p) {
+    std::uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v = (v << 8) | p[i];
+    return v;
+}
+
+static std::uint64_t HighMask64(int bits) {
+    if (bits <= 0) return 0;
+    if (bits >= 64) return ~0ull;
+    return ~0ull << (64 - bits);
+}
+
+std::uint64_t PrefixTable::V4Key(const std::uint8_t* addr, int len) {
+    std::uint32_t a = ((std::uint32_t)addr[0] << 24) | ((std::uint32_t)addr[1] << 16) | ((std::uint32_t)addr[2] << 8) | addr[3];
+    std::uint32_t mask = len <= 0 ? 0 : (len >= 32 ? 0xFFFFFFFFu : ~0u << (32 - len));
+    return ((std::uint64_t)len << 32) | (a & mask);
+}
+
+PrefixTable::V6Key PrefixTable::MakeV6Key(const std::uint8_t* addr, int len) {
+    return V6Key{ LoadBE64(addr) & HighMask64(len), LoadBE64(addr + 8) & HighMask64(len - 64), len };
+}
+
+void PrefixTable::Add(const std::uint8_t* addr, int prefixLen, bool ipv6) {
+    auto& lengths = ipv6 ? v6Lengths : v4Lengths;
+    if (ipv6) v6.insert(MakeV6Key(addr, prefixLen));
+    else v4.insert(V4Key(addr, prefixLen));
+    if (std::find(lengths.begin(), lengths.end(), prefixLen) == lengths.end()) {
+        lengths.push_back(prefixLen);
+        std::sort(lengths.rbegin(), lengths.rend());
+    }
+}
+
+bool PrefixTable::Contains(const std::uint8_t* addr, bool ipv6) const {
+    if (ipv6) {
+        for (int len : v6Lengths) if (v6.count(MakeV6Key(addr, len))) return true;
+    } else {
+        for (int len : v4Lengths) if (v4.count(V4Key(addr, len))) return true;
+    }
+    return false;
+}
+
+void ConnectionQuery::PortSet::AddRange(std::uint16_t lo, std::uint16_t hi) {
+    if (bits.empty()) bits.assign(65536, false);
+    for (std::uint32_t p = lo; p <= hi; ++p) bits[p] = true;
+}
+
+bool ConnectionQuery::ParsePorts(const std::string& value, PortSet& out) {
+    auto items = Split(value, ',');
+    if (items.empty()) return false;
+    for (const auto& item : items) {
+        std::size_t dash = item.find('-');
+        unsigned long lo, hi;
+        if (dash == std::string::npos) {
+            if (!ParseUint(item, 65535, lo)) return false;
+            hi = lo;
+        } else if (!ParseUint(item.substr(0, dash), 65535, lo) || !ParseUint(item.substr(dash + 1), 65535, hi) || lo > hi) {
+            return false;
+        }
+        out.AddRange((std::uint16_t)lo, (std::uint16_t)hi);
+    }
+    return true;
+}
+
+bool ConnectionQuery::ParseCidrs(const std::string& value, PrefixTable& out) {
+    auto items = Split(value, ',');
+    if (items.empty()) return false;
+    for (const auto& item : items) {
+        std::size_t slash = item.find('/');
+        std::uint8_t addr[16]; bool v6 = false;
+        if (!ParseIpAddress(item.substr(0, slash), addr, v6)) return false;
+        unsigned long len = v6 ? 128 : 32;
+        if (slash != std::string::npos && !ParseUint(item.substr(slash + 1), len, len)) return false;
+        out.Add(addr, (int)len, v6);
+    }
+    return true;
+}
+
+bool ConnectionQuery::Parse(const std::string& text, std::string& error) {
+    *this = ConnectionQuery();
+    std::vector<std::string> seen;
+    for (const auto& term : Split(text, ' ')) {
+        std::size_t eq = term.find('=');
+        if (eq == std::string::npos) { error = "expected key=value: " + term; return false; }
+        std::string key = Lower(term.substr(0, eq)), value = term.substr(eq + 1);
+        // Repeating a key would silently widen (or, for proto, override) the first term
+        if (std::find(seen.begin(), seen.end(), key) != seen.end()) { error = "repeated key: " + key + " (list values with commas)"; return false; }
+        seen.push_back(key);
+        bool ok = true;
+        if (key == "lport") ok = ParsePorts(value, localPorts);
+        else if (key == "rport") ok = ParsePorts(value, remotePorts);
+        else if (key == "port") ok = ParsePorts(value, anyPorts);
+        else if (key == "local") ok = ParseCidrs(value, localNets);
+        else if (key == "remote") ok = ParseCidrs(value, remoteNets);
+        else if (key == "proto") {
+            std::string v = Lower(value);
+            if (v == "tcp4") { allowV4 = true; allowV6 = false; }
+            else if (v == "tcp6") { allowV4 = false; allowV6 = true; }
+            else ok = (v == "tcp");
+        } else if (key == "pid") {
+            for (const auto& item : Split(value, ',')) {
+                unsigned long v; if (!ParseUint(item, 0xFFFFFFFFul, v)) { ok = false; break; }
+                pids.insert((std::uint32_t)v);
+            }
+            ok = ok && !pids.empty();
+        } else if (key == "name") {
+            for (const auto& item : Split(value, ',')) nameGlobs.push_back(Lower(item));
+            ok = !nameGlobs.empty();
+        } else {
+            error = "unknown key: " + key; return false;
+        }
+        if (!ok) { error = "invalid value in: " + term; return false; }
+    }
+    return true;
+}
+
+bool ConnectionQuery::MatchesRow(const ConnRow& row) const {
+    if (row.ipv6 ? !allowV6 : !allowV4) return false;
+    if (!pids.empty() && !pids.count(row.pid)) return false;
+    if (localPorts.Any() && !localPorts.Has(row.localPort)) return false;
+    if (remotePorts.Any() && !remotePorts.Has(row.remotePort)) return false;
+    if (anyPorts.Any() && !anyPorts.Has(row.localPort) && !anyPorts.Has(row.remotePort)) return false;
+    if (!localNets.Empty() && !localNets.Contains(row.localAddr, row.ipv6)) return false;
+    if (!remoteNets.Empty() && !remoteNets.Contains(row.remoteAddr, row.ipv6)) return false;
+    return true;
+}
+
+bool ConnectionQuery::MatchesName(std::string_view processName) const {
+    if (nameGlobs.empty()) return true;
+    std::string lower = Lower(std::string(processName));
+    for (const auto& g : nameGlobs) if (GlobMatch(g.c_str(), lower.c_str())) return true;
+    return false;
+}
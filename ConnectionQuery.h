@@ -0,0 +1,66 @@
+// ConnectionQuery.h
+// Small query language compiled into predicates over raw connection-table rows
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "Models.h"
+
+// Compiled CIDR set: one hash set of masked addresses per distinct prefix length,
+// so a lookup costs one mask + probe per distinct length, not one per CIDR.
+class PrefixTable {
+public:
+    void Add(const std::uint8_t* addr, int prefixLen, bool ipv6);
+    bool Contains(const std::uint8_t* addr, bool ipv6) const;
+    bool Empty() const { return v4Lengths.empty() && v6Lengths.empty(); }
+private:
+    struct V6Key {
+        std::uint64_t hi, lo; int len;
+        bool operator==(const V6Key& o) const { return hi == o.hi && lo == o.lo && len == o.len; }
+    };
+    struct V6Hash {
+        std::size_t operator()(const V6Key& k) const { return (std::size_t)((k.hi * 0x9E3779B97F4A7C15ull) ^ k.lo ^ (std::uint64_t)k.len); }
+    };
+    static std::uint64_t V4Key(const std::uint8_t* addr, int len);
+    static V6Key MakeV6Key(const std::uint8_t* addr, int len);
+    std::vector<int> v4Lengths, v6Lengths; // distinct lengths, longest first
+    std::unordered_set<std::uint64_t> v4;  // (length << 32) | masked address
+    std::unordered_set<V6Key, V6Hash> v6;
+};
+
+// Terms are separated by spaces and must all match; commas inside a term mean "or".
+// A key may appear only once ("pid=1 pid=2" is an error; write "pid=1,2").
+//   lport=443  rport=1000-2000  port=80,443 (either side)
+//   local=127.0.0.0/8  remote=10.0.0.0/8,fd00::/8
+//   proto=tcp4|tcp6|tcp  pid=1,2,3  name=chrome*  (case-insensitive glob)
+class ConnectionQuery {
+public:
+    bool Parse(const std::string& text, std::string& error);
+    // Evaluated on the raw row during the table walk; needs no process lookup
+    bool MatchesRow(const ConnRow& row) const;
+    // Only meaningful for rows that passed MatchesRow
+    bool NeedsName() const { return !nameGlobs.empty(); }
+    bool MatchesName(std::string_view processName) const;
+
+private:
+    struct PortSet {
+        std::vector<bool> bits; // 65536 entries once any range is added
+        bool Any() const { return !bits.empty(); }
+        bool Has(std::uint16_t p) const { return bits[p]; }
+        void AddRange(std::uint16_t lo, std::uint16_t hi);
+    };
+    static bool ParsePorts(const std::string& value, PortSet& out);
+    static bool ParseCidrs(const std::string& value, PrefixTable& out);
+
+    PortSet localPorts, remotePorts, anyPorts;
+    PrefixTable localNets, remoteNets;
+    bool allowV4 = true, allowV6 = true;
+    std::unordered_set<std::uint32_t> pids;
+    std::vector<std::string> nameGlobs; // lower-cased
+};
+
+// Parses dotted IPv4 or RFC 4291 IPv6 text into 16 bytes (IPv4 uses the first 4)
+bool ParseIpAddress(const std::string& text, std::uint8_t out[16], bool& ipv6);
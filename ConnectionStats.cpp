@@ -0,0 +1,199 @@
+// ConnectionStats.cpp
+// Implements sliding-window churn counters and HyperLogLog distinct-remote sketches
+#include "ConnectionStats.h"
+#include <algorithm>
+#include <cmath>
+
+// 64-bit FNV-1a, mixed with a finalizer so the high bits are usable by HyperLogLog
+static std::uint64_t HashBytes(std::uint64_t h, std::string_view s) {
+    for (unsigned char c : s) { h ^= c; h *= 0x100000001B3ull; }
+    h ^= 0xFF; h *= 0x100000001B3ull; // field separator
+    return h;
+}
+
+static std::uint64_t Mix64(std::uint64_t x) {
+    x ^= x >> 33; x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33; x *= 0xC4CEB9FE1A85EC53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+void HyperLogLog::Add(std::uint64_t hash) {
+    std::size_t idx = (std::size_t)(hash >> 56);
+    std::uint64_t rest = (hash << 8) | 0x80; // sentinel bit bounds the rank
+    std::uint8_t rank = 1;
+    while (!(rest & 0x8000000000000000ull)) { rest <<= 1; ++rank; }
+    if (rank > registers[idx]) registers[idx] = rank;
+}
+
+void HyperLogLog::Merge(const HyperLogLog& other) {
+    for (std::size_t i = 0; i < registers.size(); ++i) registers[i] = std::max(registers[i], other.registers[i]);
+}
+
+double HyperLogLog::Estimate() const {
+    const double m = (double)registers.size();
+    // 2^-rank for every possible rank (at most 57 with the sentinel bit)
+    static const std::array<double, 64> inversePowers = [] {
+        std::array<double, 64> t{};
+        for (std::size_t r = 0; r < t.size(); ++r) t[r] = std::ldexp(1.0, -(int)r);
+        return t;
+    }();
+    double sum = 0.0; std::size_t zeros = 0;
+    for (auto r : registers) { sum += inversePowers[r & 63]; if (!r) ++zeros; }
+    double est = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    // Small-range correction (linear counting)
+    if (est <= 2.5 * m && zeros) est = m * std::log(m / (double)zeros);
+    return est;
+}
+
+ConnectionStats::ConnectionStats(std::size_t maxProcesses) : capacity(maxProcesses ? maxProcesses : 1) {
+    slots.reserve(capacity);
+    slotByPid.reserve(capacity);
+}
+
+void ConnectionStats::Clear() {
+    slots.clear();
+    slotByPid.clear();
+    prevConnections.clear();
+    nextGeneration = 1;
+    firstSec = 0;
+    lastSec = 0;
+    snapshots = 0;
+}
+
+ConnectionStats::Bucket& ConnectionStats::BucketAt(Slot& s, std::uint64_t sec) {
+    Bucket& b = s.ring[sec % kWindowSeconds];
+    if (b.second != sec) { b.second = sec; b.opens = 0; b.closes = 0; }
+    return b;
+}
+
+ConnectionStats::Slot* ConnectionStats::SlotFor(int pid, std::string_view name, std::string_view path, std::uint64_t sec) {
+    auto it = slotByPid.find(pid);
+    if (it != slotByPid.end()) {
+        Slot& s = slots[it->second];
+        if (s.path != path) { // PID recycled by a different executable: start over
+            s = Slot();
+            s.pid = pid; s.name = name; s.path = path;
+            s.generation = nextGeneration++;
+        }
+        s.lastSeenSec = sec;
+        return &s;
+    }
+    std::size_t idx;
+    if (slots.size() < capacity) {
+        idx = slots.size();
+        slots.emplace_back();
+    } else {
+        // Evict the least recently seen process to stay within the memory budget
+        idx = 0;
+        for (std::size_t i = 1; i < slots.size(); ++i) {
+            if (slots[i].lastSeenSec < slots[idx].lastSeenSec) idx = i;
+        }
+        slotByPid.erase(slots[idx].pid);
+        slots[idx] = Slot();
+    }
+    Slot& s = slots[idx];
+    s.pid = pid; s.name = name; s.path = path; s.lastSeenSec = sec;
+    s.generation = nextGeneration++;
+    slotByPid[pid] = idx;
+    return &s;
+}
+
+void ConnectionStats::Ingest(const std::vector<ProcessInfo>& snapshot, std::uint64_t nowMs) {
+    IngestRows(snapshot.data(), snapshot.size(), nowMs);
+}
+
+void ConnectionStats::IngestViews(const std::pmr::vector<ProcessInfoView>& snapshot, std::uint64_t nowMs) {
+    IngestRows(snapshot.data(), snapshot.size(), nowMs);
+}
+
+// Row is ProcessInfo or ProcessInfoView: the same fields, owned or borrowed
+template <class Row>
+void ConnectionStats::IngestRows(const Row* rows, std::size_t count, std::uint64_t nowMs) {
+    const std::uint64_t sec = nowMs / 1000;
+    const std::uint64_t epoch = sec / kWindowSeconds;
+    const bool baseline = (snapshots == 0); // first snapshot has nothing to diff against
+    for (auto& s : slots) s.active = 0;
+
+    std::unordered_map<std::uint64_t, Opener> current;
+    current.reserve(count);
+    for (const Row* pi = rows; pi != rows + count; ++pi) {
+        Slot* s = SlotFor(pi->pid, pi->name, pi->path, sec);
+        if (s->epoch != epoch) {
+            if (epoch - s->epoch >= 2) { s->remotes[0].Clear(); s->remotes[1].Clear(); }
+            else s->remotes[epoch & 1].Clear();
+            s->epoch = epoch;
+        }
+        s->remotes[epoch & 1].Add(Mix64(HashBytes(0xCBF29CE484222325ull, pi->remoteAddr)));
+        ++s->active;
+
+        // Keyed by the slot's generation rather than the PID, so a recycled PID's
+        // connections never look like the previous owner's
+        std::uint64_t key = Mix64(0xCBF29CE484222325ull ^ s->generation);
+        key = HashBytes(key, pi->protocol);
+        key = HashBytes(key, pi->localAddr);
+        key = HashBytes(key, pi->remoteAddr);
+        if (!current.emplace(key, Opener{ (std::size_t)(s - slots.data()), s->generation }).second) continue;
+        if (!baseline && prevConnections.find(key) == prevConnections.end()) ++BucketAt(*s, sec).opens;
+    }
+    if (!baseline) {
+        for (const auto& kv : prevConnections) {
+            if (current.find(kv.first) != current.end()) continue;
+            Slot& s = slots[kv.second.slot];
+            if (s.generation == kv.second.generation) ++BucketAt(s, sec).closes;
+        }
+    }
+    prevConnections.swap(current);
+    if (baseline) firstSec = sec;
+    lastSec = sec;
+    ++snapshots;
+}
+
+std::vector<ProcessChurnStats> ConnectionStats::TopK(std::size_t k, SortKey key) const {
+    // Rank on counters alone; names, paths and (unless sorting by it) the distinct-remote
+    // estimate are only produced for the k processes returned
+    struct Candidate { const Slot* slot; std::uint32_t opens; std::uint32_t closes; double metric; };
+    std::vector<Candidate> ranked;
+    ranked.reserve(slots.size());
+    const std::uint64_t oldest = (lastSec >= kWindowSeconds) ? lastSec - kWindowSeconds + 1 : 0;
+    const double span = (double)std::min<std::uint64_t>(kWindowSeconds, lastSec - firstSec + 1);
+    auto distinct = [](const Slot& s) {
+        HyperLogLog merged = s.remotes[0];
+        merged.Merge(s.remotes[1]);
+        return (std::uint64_t)std::llround(merged.Estimate());
+    };
+    for (const auto& s : slots) {
+        if (s.lastSeenSec < oldest && !s.active) continue;
+        Candidate c{ &s, 0, 0, 0.0 };
+        for (const auto& b : s.ring) {
+            if (b.second < oldest || b.second > lastSec) continue;
+            c.opens += b.opens; c.closes += b.closes;
+        }
+        switch (key) {
+            case SortKey::Opens: c.metric = c.opens; break;
+            case SortKey::Closes: c.metric = c.closes; break;
+            case SortKey::Distinct: c.metric = (double)distinct(s); break;
+            case SortKey::Active: c.metric = s.active; break;
+            default: c.metric = (double)c.opens + c.closes; break;
+        }
+        ranked.push_back(c);
+    }
+    k = std::min(k, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + k, ranked.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.metric != b.metric) return a.metric > b.metric;
+        return a.slot->pid < b.slot->pid;
+    });
+    std::vector<ProcessChurnStats> out;
+    out.reserve(k);
+    for (std::size_t i = 0; i < k; ++i) {
+        const Candidate& c = ranked[i];
+        ProcessChurnStats st;
+        st.pid = c.slot->pid; st.name = c.slot->name; st.path = c.slot->path; st.active = c.slot->active;
+        st.opens = c.opens; st.closes = c.closes;
+        st.opensPerSec = st.opens / span;
+        st.closesPerSec = st.closes / span;
+        st.distinctRemotes = key == SortKey::Distinct ? (std::uint64_t)c.metric : distinct(*c.slot);
+        out.push_back(std::move(st));
+    }
+    return out;
+}
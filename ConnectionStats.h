@@ -0,0 +1,81 @@
+// ConnectionStats.h
+// Per-process connection churn and "top talkers" statistics over a sliding window
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Models.h"
+
+// Fixed-size HyperLogLog sketch (256 one-byte registers) for distinct counting
+class HyperLogLog {
+public:
+    void Add(std::uint64_t hash);
+    void Merge(const HyperLogLog& other);
+    double Estimate() const;
+    void Clear() { registers.fill(0); }
+private:
+    std::array<std::uint8_t, 256> registers{};
+};
+
+struct ProcessChurnStats {
+    int pid = 0;
+    std::string name;
+    std::string path;
+    std::uint32_t opens = 0;          // connections opened within the window
+    std::uint32_t closes = 0;         // connections closed within the window
+    double opensPerSec = 0.0;
+    double closesPerSec = 0.0;
+    std::uint32_t active = 0;         // connections in the latest snapshot
+    std::uint64_t distinctRemotes = 0; // HyperLogLog estimate over ~1-2 windows
+};
+
+class ConnectionStats {
+public:
+    static constexpr std::size_t kWindowSeconds = 60;
+    enum class SortKey { Churn, Opens, Closes, Distinct, Active };
+
+    // maxProcesses bounds memory: the least recently seen process is evicted when full
+    explicit ConnectionStats(std::size_t maxProcesses = 1024);
+    // Feed one full connection snapshot (e.g. ProcessManager::ListNetworkProcesses)
+    void Ingest(const std::vector<ProcessInfo>& snapshot, std::uint64_t nowMs);
+    // Same, over rows borrowed from the producer's snapshot arena (ListNetworkProcessViews)
+    void IngestViews(const std::pmr::vector<ProcessInfoView>& snapshot, std::uint64_t nowMs);
+    std::vector<ProcessChurnStats> TopK(std::size_t k, SortKey key) const;
+    std::size_t TrackedProcesses() const { return slotByPid.size(); }
+    std::size_t SnapshotCount() const { return snapshots; }
+    void Clear();
+
+private:
+    struct Bucket { std::uint64_t second = 0; std::uint32_t opens = 0; std::uint32_t closes = 0; };
+    struct Slot {
+        int pid = 0;
+        std::uint64_t generation = 0; // new for every process that takes the slot
+        std::string name;
+        std::string path;
+        std::array<Bucket, kWindowSeconds> ring{};
+        HyperLogLog remotes[2]; // current and previous epoch, alternated every window
+        std::uint64_t epoch = 0;
+        std::uint32_t active = 0;
+        std::uint64_t lastSeenSec = 0;
+    };
+    template <class Row> void IngestRows(const Row* rows, std::size_t count, std::uint64_t nowMs);
+    Slot* SlotFor(int pid, std::string_view name, std::string_view path, std::uint64_t sec);
+    static Bucket& BucketAt(Slot& s, std::uint64_t sec);
+
+    std::size_t capacity;
+    std::vector<Slot> slots;
+    std::unordered_map<int, std::size_t> slotByPid;
+    // Which slot, and which process in it, opened a connection: a close is credited only
+    // while that process still holds the slot, never to a recycled PID or an evictor
+    struct Opener { std::size_t slot = 0; std::uint64_t generation = 0; };
+    std::unordered_map<std::uint64_t, Opener> prevConnections; // connection key hash -> opener
+    std::uint64_t nextGeneration = 1;
+    std::uint64_t firstSec = 0;
+    std::uint64_t lastSec = 0;
+    std::size_t snapshots = 0;
+};
@@ -0,0 +1,260 @@
+// ConnectionTrace.cpp
+// Trace layout: "AGTRACE\0", varint version, varint flags, then frames of
+//   varint payload size | time delta | new strings | pid -> path updates | removed | added
+// Removed rows are gaps between indices into the previous frame's canonical order; added
+// rows are written in full, in canonical order, so replay is a single merge.
+#include "ConnectionTrace.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <thread>
+
+namespace {
+    const char kMagic[8] = { 'A', 'G', 'T', 'R', 'A', 'C', 'E', '\0' };
+    const std::uint64_t kVersion = 1;
+    const std::size_t kMinRowBytes = 13; // IPv4: flags + 2 addresses + 5 one-byte varints
+
+    // Canonical order: family, local endpoint, remote endpoint, pid, state
+    bool RowLess(const ConnRow& a, const ConnRow& b) {
+        if (a.ipv6 != b.ipv6) return a.ipv6 < b.ipv6;
+        if (int c = std::memcmp(a.localAddr, b.localAddr, sizeof(a.localAddr))) return c < 0;
+        if (a.localPort != b.localPort) return a.localPort < b.localPort;
+        if (int c = std::memcmp(a.remoteAddr, b.remoteAddr, sizeof(a.remoteAddr))) return c < 0;
+        if (a.remotePort != b.remotePort) return a.remotePort < b.remotePort;
+        if (a.pid != b.pid) return a.pid < b.pid;
+        return a.state < b.state;
+    }
+
+    void PutVarint(std::string& out, std::uint64_t v) {
+        while (v >= 0x80) { out.push_back((char)(v | 0x80)); v >>= 7; }
+        out.push_back((char)v);
+    }
+
+    bool GetVarint(const std::uint8_t* data, std::size_t& pos, std::size_t end, std::uint64_t& v) {
+        v = 0;
+        for (unsigned shift = 0; shift < 64 && pos < end; shift += 7) {
+            const std::uint8_t b = data[pos++];
+            v |= (std::uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    void PutRow(std::string& out, const ConnRow& r) {
+        const std::size_t addrBytes = r.ipv6 ? 16 : 4;
+        out.push_back(r.ipv6 ? 1 : 0);
+        out.append((const char*)r.localAddr, addrBytes);
+        PutVarint(out, r.localPort);
+        out.append((const char*)r.remoteAddr, addrBytes);
+        PutVarint(out, r.remotePort);
+        PutVarint(out, r.pid);
+        PutVarint(out, r.state);
+    }
+
+    bool GetRow(const std::uint8_t* data, std::size_t& pos, std::size_t end, ConnRow& r) {
+        r = ConnRow();
+        if (pos >= end || data[pos] > 1) return false;
+        r.ipv6 = data[pos++] == 1;
+        const std::size_t addrBytes = r.ipv6 ? 16 : 4;
+        std::uint64_t localPort = 0, remotePort = 0, pid = 0, state = 0;
+        if (end - pos < addrBytes) return false;
+        std::memcpy(r.localAddr, data + pos, addrBytes);
+        pos += addrBytes;
+        if (!GetVarint(data, pos, end, localPort) || end - pos < addrBytes) return false;
+        std::memcpy(r.remoteAddr, data + pos, addrBytes);
+        pos += addrBytes;
+        if (!GetVarint(data, pos, end, remotePort) || !GetVarint(data, pos, end, pid) || !GetVarint(data, pos, end, state)) return false;
+        if (localPort > 0xFFFF || remotePort > 0xFFFF || pid > 0xFFFFFFFFu || state > 0xFFFFFFFFu) return false;
+        r.localPort = (std::uint16_t)localPort;
+        r.remotePort = (std::uint16_t)remotePort;
+        r.pid = (std::uint32_t)pid;
+        r.state = (std::uint32_t)state;
+        return true;
+    }
+}
+
+bool ConnectionTraceWriter::Open(const std::string& file) {
+    if (out.is_open()) out.close();
+    out.clear();
+    previous.clear();
+    stringIds.clear();
+    pidPaths.clear();
+    lastTime = 0;
+    stats = TraceStats();
+    out.open(file, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    frame.assign(kMagic, sizeof(kMagic));
+    PutVarint(frame, kVersion);
+    PutVarint(frame, 0); // flags: none defined yet
+    out.write(frame.data(), (std::streamsize)frame.size());
+    stats.bytes = frame.size();
+    return (bool)out;
+}
+
+bool ConnectionTraceWriter::Append(std::uint64_t timeMicros, const std::vector<ConnRow>& rows, const std::vector<TraceProcess>& processes) {
+    if (!out.is_open()) return false;
+    current.assign(rows.begin(), rows.end());
+    std::sort(current.begin(), current.end(), RowLess);
+
+    // Path changes for the PIDs in this frame: a new PID, a recycled one, or one that
+    // stopped resolving. Paths seen for the first time are appended to the string table.
+    std::unordered_map<std::uint32_t, std::string_view> resolved;
+    for (const auto& p : processes) resolved.emplace(p.pid, p.path);
+    std::vector<std::string_view> newStrings;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> updates;
+    std::unordered_map<std::uint32_t, std::uint32_t> frameRefs;
+    for (const auto& r : current) {
+        if (!frameRefs.emplace(r.pid, 0).second) continue;
+        std::uint32_t ref = 0;
+        auto it = resolved.find(r.pid);
+        if (it != resolved.end() && !it->second.empty()) {
+            auto id = stringIds.emplace(std::string(it->second), (std::uint32_t)stringIds.size());
+            if (id.second) newStrings.push_back(it->second);
+            ref = id.first->second + 1;
+        }
+        auto known = pidPaths.find(r.pid);
+        if (known == pidPaths.end() || known->second != ref) {
+            pidPaths[r.pid] = ref;
+            updates.emplace_back(r.pid, ref);
+        }
+    }
+
+    frame.clear();
+    PutVarint(frame, timeMicros > lastTime ? timeMicros - lastTime : 0);
+    lastTime = std::max(lastTime, timeMicros);
+    PutVarint(frame, newStrings.size());
+    for (auto s : newStrings) { PutVarint(frame, s.size()); frame.append(s.data(), s.size()); }
+    PutVarint(frame, updates.size());
+    for (const auto& u : updates) { PutVarint(frame, u.first); PutVarint(frame, u.second); }
+
+    // Sorted set difference against the previous frame
+    std::vector<std::size_t> removed;
+    std::vector<const ConnRow*> added;
+    std::size_t i = 0, j = 0;
+    while (i < previous.size() || j < current.size()) {
+        if (j == current.size() || (i < previous.size() && RowLess(previous[i], current[j]))) removed.push_back(i++);
+        else if (i == previous.size() || RowLess(current[j], previous[i])) added.push_back(&current[j++]);
+        else { ++i; ++j; }
+    }
+    PutVarint(frame, removed.size());
+    for (std::size_t k = 0; k < removed.size(); ++k) PutVarint(frame, k ? removed[k] - removed[k - 1] - 1 : removed[k]);
+    PutVarint(frame, added.size());
+    for (const ConnRow* r : added) PutRow(frame, *r);
+    previous.swap(current);
+
+    std::string length;
+    PutVarint(length, frame.size());
+    out.write(length.data(), (std::streamsize)length.size());
+    out.write(frame.data(), (std::streamsize)frame.size());
+    out.flush();
+    ++stats.frames;
+    stats.rows += rows.size();
+    stats.changedRows += removed.size() + added.size();
+    stats.strings += newStrings.size();
+    stats.bytes += length.size() + frame.size();
+    return (bool)out;
+}
+
+bool ConnectionTraceWriter::Close() {
+    if (!out.is_open()) return false;
+    out.close();
+    return !out.fail();
+}
+
+ConnectionTraceReader::ConnectionTraceReader(const std::uint8_t* data, std::size_t size) : data(data), size(size) {
+    std::uint64_t version = 0, flags = 0;
+    std::size_t p = sizeof(kMagic);
+    if (size < sizeof(kMagic) || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) return;
+    if (!GetVarint(data, p, size, version) || version != kVersion) return;
+    if (!GetVarint(data, p, size, flags) || flags != 0) return;
+    start = pos = p;
+    valid = true;
+}
+
+void ConnectionTraceReader::Rewind() {
+    pos = start;
+    corrupt = false;
+    time = 0;
+    frames = 0;
+    rows.clear();
+    strings.clear();
+    pidPaths.clear();
+}
+
+std::string_view ConnectionTraceReader::ImagePath(std::uint32_t pid) const {
+    auto it = pidPaths.find(pid);
+    return (it == pidPaths.end() || !it->second) ? std::string_view() : strings[it->second - 1];
+}
+
+bool ConnectionTraceReader::Next() {
+    if (!valid || corrupt || pos >= size) return false;
+    std::size_t p = pos;
+    std::uint64_t length = 0;
+    if (!GetVarint(data, p, size, length) || length > size - p) return false; // interrupted capture
+    if (!Decode(p, p + (std::size_t)length)) { corrupt = true; return false; }
+    pos = p + (std::size_t)length;
+    ++frames;
+    return true;
+}
+
+bool ConnectionTraceReader::Decode(std::size_t p, std::size_t end) {
+    std::uint64_t delta = 0, count = 0;
+    if (!GetVarint(data, p, end, delta)) return false;
+    time += delta;
+
+    if (!GetVarint(data, p, end, count) || count > end - p) return false;
+    for (std::uint64_t k = 0; k < count; ++k) {
+        std::uint64_t length = 0;
+        if (!GetVarint(data, p, end, length) || length > end - p) return false;
+        strings.emplace_back((const char*)data + p, (std::size_t)length);
+        p += (std::size_t)length;
+    }
+
+    if (!GetVarint(data, p, end, count) || count > end - p) return false;
+    for (std::uint64_t k = 0; k < count; ++k) {
+        std::uint64_t pid = 0, ref = 0;
+        if (!GetVarint(data, p, end, pid) || !GetVarint(data, p, end, ref) || pid > 0xFFFFFFFFu || ref > strings.size()) return false;
+        pidPaths[(std::uint32_t)pid] = (std::uint32_t)ref;
+    }
+
+    // Keep everything but the removed rows, then merge the added ones in
+    if (!GetVarint(data, p, end, count) || count > rows.size()) return false;
+    scratch.clear();
+    std::size_t next = 0;
+    for (std::uint64_t k = 0; k < count; ++k) {
+        std::uint64_t gap = 0;
+        if (!GetVarint(data, p, end, gap) || gap >= rows.size() - next) return false;
+        scratch.insert(scratch.end(), rows.begin() + next, rows.begin() + next + (std::size_t)gap);
+        next += (std::size_t)gap + 1;
+    }
+    scratch.insert(scratch.end(), rows.begin() + next, rows.end());
+
+    if (!GetVarint(data, p, end, count) || count > (end - p) / kMinRowBytes) return false;
+    added.resize((std::size_t)count);
+    for (auto& r : added) {
+        if (!GetRow(data, p, end, r)) return false;
+    }
+    if (p != end) return false;
+    rows.clear();
+    std::merge(scratch.begin(), scratch.end(), added.begin(), added.end(), std::back_inserter(rows), RowLess);
+    return true;
+}
+
+TraceReplaySource::TraceReplaySource(const std::uint8_t* data, std::size_t size, double speed)
+    : reader(data, size), speed(speed) {}
+
+bool TraceReplaySource::Capture(std::vector<ConnRow>& out) {
+    if (!finished && reader.Next()) {
+        if (reader.Frames() == 1) {
+            wallStart = std::chrono::steady_clock::now();
+            traceStart = reader.TimeMicros();
+        } else if (speed > 0) {
+            const double offset = (double)(reader.TimeMicros() - traceStart) / speed;
+            std::this_thread::sleep_until(wallStart + std::chrono::microseconds((std::int64_t)offset));
+        }
+    } else {
+        finished = true;
+    }
+    out.assign(reader.Rows().begin(), reader.Rows().end());
+    return reader.Frames() > 0;
+}
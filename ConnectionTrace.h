@@ -0,0 +1,112 @@
+// ConnectionTrace.h
+// Compact binary record/replay of connection snapshots. Each frame stores only the rows
+// added and removed since the previous snapshot, varint-packed, with image paths interned
+// in a string table that grows as new paths appear.
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Models.h"
+
+// Where ProcessManager takes its snapshots from when they are not read live
+class ConnectionSource {
+public:
+    virtual ~ConnectionSource() = default;
+    virtual bool Capture(std::vector<ConnRow>& out) = 0;
+    // Image path of pid as of the last Capture, valid until the next one; empty if unresolved
+    virtual std::string_view ImagePath(std::uint32_t pid) = 0;
+};
+
+struct TraceProcess {
+    std::uint32_t pid = 0;
+    std::string_view path;
+};
+
+struct TraceStats {
+    std::uint64_t frames = 0;
+    std::uint64_t rows = 0;        // rows across all snapshots, as captured
+    std::uint64_t changedRows = 0; // rows actually encoded (added + removed)
+    std::uint64_t strings = 0;     // distinct paths in the string table
+    std::uint64_t bytes = 0;       // trace size so far
+};
+
+class ConnectionTraceWriter {
+public:
+    bool Open(const std::string& file);
+    // rows may be in any order. processes names the PIDs that resolved; the others
+    // replay as unresolved. Each frame is flushed, so an interrupted capture stays readable.
+    bool Append(std::uint64_t timeMicros, const std::vector<ConnRow>& rows, const std::vector<TraceProcess>& processes);
+    bool Close();
+    bool IsOpen() const { return out.is_open(); }
+    const TraceStats& Stats() const { return stats; }
+
+private:
+    std::ofstream out;
+    std::vector<ConnRow> previous; // canonical order
+    std::vector<ConnRow> current;
+    std::unordered_map<std::string, std::uint32_t> stringIds;
+    std::unordered_map<std::uint32_t, std::uint32_t> pidPaths; // pid -> string id + 1, 0 = unresolved
+    std::string frame;                                          // reused encoding buffer
+    std::uint64_t lastTime = 0;
+    TraceStats stats;
+};
+
+// Decodes a trace held in memory (typically a read-only file mapping) without copying it:
+// recorded paths are views into the trace itself
+class ConnectionTraceReader {
+public:
+    ConnectionTraceReader(const std::uint8_t* data, std::size_t size);
+    bool Valid() const { return valid; }
+    // Applies the next frame; false at the end of the trace (a truncated last frame counts
+    // as the end) or when a frame is malformed
+    bool Next();
+    bool Corrupt() const { return corrupt; }
+    void Rewind();
+    std::uint64_t TimeMicros() const { return time; }
+    const std::vector<ConnRow>& Rows() const { return rows; } // canonical order
+    std::string_view ImagePath(std::uint32_t pid) const;
+    std::uint64_t Frames() const { return frames; }
+
+private:
+    bool Decode(std::size_t p, std::size_t end);
+
+    const std::uint8_t* data;
+    std::size_t size;
+    std::size_t start = 0; // first frame
+    std::size_t pos = 0;
+    bool valid = false;
+    bool corrupt = false;
+    std::uint64_t time = 0;
+    std::uint64_t frames = 0;
+    std::vector<ConnRow> rows;
+    std::vector<ConnRow> scratch; // rows kept from the previous frame
+    std::vector<ConnRow> added;
+    std::vector<std::string_view> strings;
+    std::unordered_map<std::uint32_t, std::uint32_t> pidPaths;
+};
+
+// Plays a trace back as a ConnectionSource. speed 1 keeps the recorded pacing, 10 is ten
+// times faster, 0 does not wait at all. Past the last frame it keeps returning that frame.
+class TraceReplaySource : public ConnectionSource {
+public:
+    TraceReplaySource(const std::uint8_t* data, std::size_t size, double speed);
+    bool Capture(std::vector<ConnRow>& out) override;
+    std::string_view ImagePath(std::uint32_t pid) override { return reader.ImagePath(pid); }
+    bool Valid() const { return reader.Valid(); }
+    bool Finished() const { return finished; }
+    bool Corrupt() const { return reader.Corrupt(); }
+    std::uint64_t FrameTimeMicros() const { return reader.TimeMicros(); }
+    std::uint64_t Frames() const { return reader.Frames(); }
+
+private:
+    ConnectionTraceReader reader;
+    double speed;
+    bool finished = false;
+    std::chrono::steady_clock::time_point wallStart;
+    std::uint64_t traceStart = 0;
+};
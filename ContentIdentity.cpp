@@ -0,0 +1,248 @@
+// ContentIdentity.cpp
+// Memory-mapped hashing (fast 64-bit hash + BCrypt SHA-256, Utils::MappedFile) with a
+// size/mtime-keyed cache and a background baseline recorder
+#include "ContentIdentity.h"
+#include "Utils.h"
+#include "Instrumentation.h"
+#include <windows.h>
+#include <bcrypt.h>
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+#pragma comment(lib, "bcrypt.lib")
+
+// Mapped window size; a multiple of both the allocation granularity and 8 bytes
+static const std::uint64_t kViewBytes = 64ull << 20;
+
+namespace {
+    // 64-bit multiply-rotate over 8-byte words, finished with a 64-bit mixer
+    struct FastHasher {
+        std::uint64_t h = 0x9E3779B97F4A7C15ull;
+        static std::uint64_t Rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+        void Word(std::uint64_t w) { h = Rotl(h ^ (w * 0x87C37B91114253D5ull), 31) * 0x4CF5AD432745937Full; }
+        // n must be a multiple of 8 except for the final block of the file
+        void Update(const std::uint8_t* p, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) { std::uint64_t w; std::memcpy(&w, p + i, 8); Word(w); }
+            if (i < n) { std::uint64_t w = 0; std::memcpy(&w, p + i, n - i); Word(w); }
+        }
+        std::uint64_t Final(std::uint64_t totalBytes) {
+            std::uint64_t x = h ^ totalBytes;
+            x ^= x >> 33; x *= 0xFF51AFD7ED558CCDull;
+            x ^= x >> 33; x *= 0xC4CEB9FE1A85EC53ull;
+            x ^= x >> 33;
+            return x;
+        }
+    };
+
+    std::uint64_t ToUInt64(const FILETIME& ft) { return ((std::uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime; }
+
+    // True only when the file or its directory does not exist, not when it cannot be read
+    bool IsMissing(const std::wstring& path) {
+        if (GetFileAttributesW(path.c_str()) != INVALID_FILE_ATTRIBUTES) return false;
+        const DWORD error = GetLastError();
+        return error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND;
+    }
+}
+
+std::string FileIdentity::Sha256Hex() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(64);
+    for (auto b : sha256) { hex += digits[b >> 4]; hex += digits[b & 15]; }
+    return hex;
+}
+
+ContentIdentityCache::ContentIdentityCache(unsigned threads) : threads(threads) {
+    BCRYPT_ALG_HANDLE alg = nullptr;
+    if (BCryptOpenAlgorithmProvider(&alg, BCRYPT_SHA256_ALGORITHM, NULL, 0) >= 0) shaAlgorithm = alg;
+}
+
+ContentIdentityCache::~ContentIdentityCache() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueWake.notify_all();
+    if (baselineWorker.joinable()) baselineWorker.join();
+    if (shaAlgorithm) BCryptCloseAlgorithmProvider((BCRYPT_ALG_HANDLE)shaAlgorithm, 0);
+}
+
+bool ContentIdentityCache::Compute(const std::wstring& path, bool withSha256, FileIdentity& out) {
+    APPGATE_PROBE("ContentIdentity.Compute");
+    if (withSha256 && !shaAlgorithm) return false;
+    // Opened without write sharing: a file open for writing is skipped, and nobody can
+    // truncate it while it is hashed
+    Utils::MappedFile file;
+    if (!file.Open(path, true)) return false;
+    out = FileIdentity();
+    out.size = file.Size();
+    out.writeTime = file.WriteTime();
+
+    BCRYPT_HASH_HANDLE sha = nullptr;
+    bool ok = !withSha256 || BCryptCreateHash((BCRYPT_ALG_HANDLE)shaAlgorithm, &sha, NULL, 0, NULL, 0, 0) >= 0;
+    // Both hashes come from the same pass; large files are mapped one window at a time
+    FastHasher fast;
+    for (std::uint64_t offset = 0; ok && offset < out.size; offset += kViewBytes) {
+        const std::size_t n = (std::size_t)std::min(kViewBytes, out.size - offset);
+        const std::uint8_t* view = file.Map(offset, n);
+        ok = view != nullptr;
+        if (ok) fast.Update(view, n);
+        if (ok && withSha256) ok = BCryptHashData(sha, (PUCHAR)view, (ULONG)n, 0) >= 0;
+    }
+    out.fastHash = fast.Final(out.size);
+    if (withSha256) {
+        ok = ok && BCryptFinishHash(sha, out.sha256.data(), (ULONG)out.sha256.size(), 0) >= 0;
+        out.hasSha256 = ok;
+    }
+    if (sha) BCryptDestroyHash(sha);
+    bytesHashed.fetch_add(out.size, std::memory_order_relaxed);
+    out.valid = ok;
+    return ok;
+}
+
+bool ContentIdentityCache::Identify(const std::wstring& path, FileIdentity& out) {
+    return Lookup(path, true, out);
+}
+
+std::vector<FileIdentity> ContentIdentityCache::IdentifyAll(const std::vector<std::wstring>& paths) {
+    return LookupAll(paths, true);
+}
+
+bool ContentIdentityCache::Lookup(const std::wstring& path, bool withSha256, FileIdentity& out) {
+    WIN32_FILE_ATTRIBUTE_DATA fad{};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &fad) || (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) return false;
+    const std::uint64_t size = ((std::uint64_t)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+    const std::uint64_t writeTime = ToUInt64(fad.ftLastWriteTime);
+    std::wstring key = Utils::CanonicalPathKey(path);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(key);
+        if (it != cache.end() && it->second.size == size && it->second.writeTime == writeTime
+            && (it->second.hasSha256 || !withSha256)) { out = it->second; return true; }
+    }
+    if (!Compute(path, withSha256, out)) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    FileIdentity& cached = cache[key];
+    // A fast-hash-only read never replaces a full identity of the same file version
+    if (out.hasSha256 || !cached.hasSha256 || cached.size != out.size || cached.writeTime != out.writeTime) cached = out;
+    return true;
+}
+
+std::vector<FileIdentity> ContentIdentityCache::LookupAll(const std::vector<std::wstring>& paths, bool withSha256) {
+    std::vector<FileIdentity> result(paths.size());
+    Utils::ParallelFor(paths.size(), threads, [&](std::size_t i) {
+        if (!Lookup(paths[i], withSha256, result[i])) result[i] = FileIdentity();
+    });
+    return result;
+}
+
+std::vector<std::wstring> ContentIdentityCache::FindCopies(const FileIdentity& target, const std::vector<ApplicationInfo>& inventory) {
+    std::vector<std::wstring> copies;
+    if (!target.valid) return copies;
+    // Size check first: a stat per app, no reads
+    std::vector<char> sameSize(inventory.size(), 0);
+    Utils::ParallelFor(inventory.size(), threads, [&](std::size_t i) {
+        if (inventory[i].isUWP || inventory[i].exePath.empty()) return;
+        WIN32_FILE_ATTRIBUTE_DATA fad{};
+        if (!GetFileAttributesExW(inventory[i].exePath.c_str(), GetFileExInfoStandard, &fad)) return;
+        sameSize[i] = ((((std::uint64_t)fad.nFileSizeHigh << 32) | fad.nFileSizeLow) == target.size) ? 1 : 0;
+    });
+    std::vector<std::wstring> candidates;
+    std::unordered_set<std::wstring> seen;
+    for (std::size_t i = 0; i < inventory.size(); ++i) {
+        if (sameSize[i] && seen.insert(Utils::CanonicalPathKey(inventory[i].exePath)).second) candidates.push_back(inventory[i].exePath);
+    }
+    // Same-size files are usually different builds: the fast hash rules them out, and only
+    // the files it cannot tell apart from the target are confirmed with SHA-256
+    auto fast = LookupAll(candidates, false);
+    std::vector<std::wstring> likely;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        if (fast[i].valid && fast[i].size == target.size && fast[i].fastHash == target.fastHash) likely.push_back(candidates[i]);
+    }
+    auto ids = IdentifyAll(likely);
+    for (std::size_t i = 0; i < likely.size(); ++i) {
+        if (ids[i].SameContent(target)) copies.push_back(likely[i]);
+    }
+    return copies;
+}
+
+std::size_t ContentIdentityCache::RecordBaselines(const std::vector<std::wstring>& paths) {
+    auto ids = IdentifyAll(paths);
+    std::size_t recorded = 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        if (!ids[i].valid) continue;
+        baselines[Utils::CanonicalPathKey(paths[i])] = ids[i];
+        ++recorded;
+    }
+    return recorded;
+}
+
+void ContentIdentityCache::QueueBaselines(const std::vector<std::wstring>& paths) {
+    if (paths.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (stopping) return;
+        queued.insert(queued.end(), paths.begin(), paths.end());
+        if (!baselineWorker.joinable()) baselineWorker = std::thread(&ContentIdentityCache::RunBaselines, this);
+    }
+    queueWake.notify_one();
+}
+
+void ContentIdentityCache::RunBaselines() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    for (;;) {
+        queueWake.wait(lock, [&] { return stopping || !queued.empty(); });
+        if (stopping) break; // baselines still queued at exit are not needed
+        std::vector<std::wstring> batch;
+        batch.swap(queued);
+        recording = true;
+        lock.unlock();
+        RecordBaselines(batch);
+        lock.lock();
+        recording = false;
+        queueIdle.notify_all();
+    }
+}
+
+void ContentIdentityCache::WaitForBaselines() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueIdle.wait(lock, [&] { return stopping || (queued.empty() && !recording); });
+}
+
+std::vector<ContentChange> ContentIdentityCache::CheckForChanges(const std::vector<std::wstring>& paths, std::size_t* unreadable) {
+    WaitForBaselines(); // paths blocked just before this call are compared with their block-time content
+    auto ids = IdentifyAll(paths);
+    // A read can fail because the file is gone or because it is locked or access is denied;
+    // only the first is a change
+    std::vector<char> missing(paths.size(), 0);
+    for (std::size_t i = 0; i < paths.size(); ++i) if (!ids[i].valid) missing[i] = IsMissing(paths[i]) ? 1 : 0;
+    std::vector<ContentChange> changes;
+    std::size_t skipped = 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        std::wstring key = Utils::CanonicalPathKey(paths[i]);
+        auto it = baselines.find(key);
+        if (it == baselines.end()) {
+            if (ids[i].valid) baselines.emplace(std::move(key), ids[i]);
+            else if (!missing[i]) ++skipped;
+            continue;
+        }
+        if (!ids[i].valid && !missing[i]) { ++skipped; continue; }
+        if (ids[i].SameContent(it->second)) continue;
+        ContentChange change;
+        change.path = paths[i];
+        change.missing = !ids[i].valid;
+        change.baseline = it->second;
+        if (ids[i].valid) it->second = ids[i];
+        changes.push_back(std::move(change));
+    }
+    if (unreadable) *unreadable = skipped;
+    return changes;
+}
+
+std::size_t ContentIdentityCache::CachedFiles() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.size();
+}
@@ -0,0 +1,90 @@
+// ContentIdentity.h
+// SHA-256 content identities for executables, with a fast hash as the first comparison,
+// cached by (path, size, last-write time) so unchanged files are never re-read
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ApplicationInfo.h"
+
+struct FileIdentity {
+    bool valid = false;
+    std::uint64_t size = 0;
+    std::uint64_t writeTime = 0; // FILETIME of the last write
+    std::uint64_t fastHash = 0;  // not collision resistant: a mismatch proves a change, a match proves nothing
+    bool hasSha256 = false;
+    std::array<std::uint8_t, 32> sha256{};
+    // Different fast hashes settle it; equal ones are confirmed with SHA-256
+    bool SameContent(const FileIdentity& other) const {
+        return valid && other.valid && size == other.size && fastHash == other.fastHash
+            && hasSha256 && other.hasSha256 && sha256 == other.sha256;
+    }
+    std::string Sha256Hex() const;
+};
+
+struct ContentChange {
+    std::wstring path;     // checked path whose content changed or disappeared
+    bool missing = false;  // the file no longer exists; false: its content was replaced
+    FileIdentity baseline; // content recorded before the change
+};
+
+class ContentIdentityCache {
+public:
+    // threads = 0 hashes with one worker per hardware thread
+    explicit ContentIdentityCache(unsigned threads = 0);
+    ~ContentIdentityCache();
+    ContentIdentityCache(const ContentIdentityCache&) = delete;
+    ContentIdentityCache& operator=(const ContentIdentityCache&) = delete;
+
+    // A file whose size and mtime match the cache is answered without being opened;
+    // any other file is read and its SHA-256 recomputed
+    bool Identify(const std::wstring& path, FileIdentity& out);
+    // Hashes in parallel; result[i] belongs to paths[i] and is invalid if unreadable
+    std::vector<FileIdentity> IdentifyAll(const std::vector<std::wstring>& paths);
+    // Inventory executables with the same content as target. Sizes are compared first and
+    // same-size files are read for the fast hash; only fast-hash matches get a SHA-256.
+    std::vector<std::wstring> FindCopies(const FileIdentity& target, const std::vector<ApplicationInfo>& inventory);
+    // Records the current content of paths as their baselines (call when they are blocked,
+    // so a replacement before the first check is still caught); returns how many were read
+    std::size_t RecordBaselines(const std::vector<std::wstring>& paths);
+    // RecordBaselines on a background thread, for callers that must not wait for hashing
+    // (e.g. the firewall's blocked-paths callback)
+    void QueueBaselines(const std::vector<std::wstring>& paths);
+    // Compares each path with its baseline, after any queued baselines are recorded. A path
+    // without one (never recorded) gets the current content as baseline. Replaced content
+    // becomes the new baseline; a missing file keeps its old one. A file that exists but
+    // cannot be read (locked, access denied) is not reported and keeps its baseline; such
+    // files are counted in *unreadable.
+    std::vector<ContentChange> CheckForChanges(const std::vector<std::wstring>& paths, std::size_t* unreadable = nullptr);
+    std::size_t CachedFiles() const;
+    std::uint64_t BytesHashed() const { return bytesHashed.load(std::memory_order_relaxed); }
+
+private:
+    // withSha256 = false reads the file for the fast hash alone
+    bool Compute(const std::wstring& path, bool withSha256, FileIdentity& out);
+    bool Lookup(const std::wstring& path, bool withSha256, FileIdentity& out);
+    std::vector<FileIdentity> LookupAll(const std::vector<std::wstring>& paths, bool withSha256);
+    void RunBaselines();
+    void WaitForBaselines();
+
+    unsigned threads;
+    void* shaAlgorithm = nullptr; // BCRYPT_ALG_HANDLE, shared by all workers
+    mutable std::mutex mutex;
+    std::unordered_map<std::wstring, FileIdentity> cache;     // canonical path -> latest identity
+    std::unordered_map<std::wstring, FileIdentity> baselines; // canonical path -> identity being watched
+    std::atomic<std::uint64_t> bytesHashed{0};
+
+    std::mutex queueMutex; // guards the baseline queue below
+    std::condition_variable queueWake, queueIdle;
+    std::vector<std::wstring> queued;
+    bool recording = false; // the worker is hashing a batch taken from queued
+    bool stopping = false;
+    std::thread baselineWorker; // started by the first QueueBaselines
+};
@@ -0,0 +1,84 @@
+// EndpointIndex.cpp
+// Implements the flat hash tables and the two row indexes
+#include "EndpointIndex.h"
+#include <cstring>
+#include <utility>
+
+static std::uint64_t Mix64(std::uint64_t x) {
+    x ^= x >> 33; x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33; x *= 0xC4CEB9FE1A85EC53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+static std::uint64_t HashAddr(std::uint64_t h, const std::uint8_t* addr, bool ipv6) {
+    std::uint64_t a = 0, b = 0;
+    std::memcpy(&a, addr, 8);
+    if (ipv6) std::memcpy(&b, addr + 8, 8);
+    else a &= 0xFFFFFFFFull; // IPv4 uses the first 4 bytes only
+    return Mix64(h ^ Mix64(a ^ Mix64(b + (ipv6 ? 1 : 0))));
+}
+
+static bool SameAddr(const std::uint8_t* a, const std::uint8_t* b, bool ipv6) {
+    return std::memcmp(a, b, ipv6 ? 16 : 4) == 0;
+}
+
+void FlatChainIndex::Reset(std::size_t expectedKeys) {
+    std::size_t cap = 16;
+    while (cap < expectedKeys * 2) cap <<= 1; // load factor <= 0.5
+    slots.assign(cap, Slot());
+    mask = cap - 1;
+}
+
+void FlatChainIndex::Insert(std::uint64_t key, std::uint32_t row, std::vector<std::uint32_t>& next) {
+    for (std::size_t i = (std::size_t)Mix64(key) & mask;; i = (i + 1) & mask) {
+        Slot& s = slots[i];
+        if (s.head == kNone) { s.key = key; s.head = row; next[row] = kNone; return; }
+        if (s.key == key) { next[row] = s.head; s.head = row; return; }
+    }
+}
+
+std::uint32_t FlatChainIndex::Head(std::uint64_t key) const {
+    if (slots.empty()) return kNone;
+    for (std::size_t i = (std::size_t)Mix64(key) & mask;; i = (i + 1) & mask) {
+        const Slot& s = slots[i];
+        if (s.head == kNone) return kNone;
+        if (s.key == key) return s.head;
+    }
+}
+
+std::uint64_t EndpointIndex::RemoteKey(const ConnRow& r) {
+    return HashAddr(r.remotePort, r.remoteAddr, r.ipv6);
+}
+
+void EndpointIndex::Build(std::vector<ConnRow> snapshot) {
+    rows = std::move(snapshot);
+    const std::size_t n = rows.size();
+    byLocalPort.Reset(n); byRemote.Reset(n);
+    nextLocal.assign(n, FlatChainIndex::kNone);
+    nextRemote.assign(n, FlatChainIndex::kNone);
+    for (std::uint32_t i = 0; i < (std::uint32_t)n; ++i) {
+        const ConnRow& r = rows[i];
+        byLocalPort.Insert(r.localPort, i, nextLocal);
+        byRemote.Insert(RemoteKey(r), i, nextRemote);
+    }
+}
+
+std::vector<const ConnRow*> EndpointIndex::ByLocalPort(std::uint16_t port) const {
+    std::vector<const ConnRow*> out;
+    for (std::uint32_t i = byLocalPort.Head(port); i != FlatChainIndex::kNone; i = nextLocal[i]) out.push_back(&rows[i]);
+    return out;
+}
+
+std::vector<const ConnRow*> EndpointIndex::ByRemote(const std::uint8_t addr[16], bool ipv6, std::uint16_t port) const {
+    ConnRow key;
+    key.ipv6 = ipv6; key.remotePort = port;
+    std::memcpy(key.remoteAddr, addr, 16);
+    std::vector<const ConnRow*> out;
+    for (std::uint32_t i = byRemote.Head(RemoteKey(key)); i != FlatChainIndex::kNone; i = nextRemote[i]) {
+        const ConnRow& r = rows[i];
+        // 64-bit keys can collide; confirm on the row itself
+        if (r.ipv6 == ipv6 && r.remotePort == port && SameAddr(r.remoteAddr, addr, ipv6)) out.push_back(&r);
+    }
+    return out;
+}
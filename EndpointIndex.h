@@ -0,0 +1,36 @@
+// EndpointIndex.h
+// Reverse indexes from local port and remote endpoint to connection rows
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Models.h"
+
+// Flat open-addressing table from a 64-bit key to the head of a row chain.
+// Rows sharing a key are linked through a caller-owned next[] array, so one
+// probe sequence yields every match without per-key allocations.
+class FlatChainIndex {
+public:
+    static constexpr std::uint32_t kNone = 0xFFFFFFFFu;
+    void Reset(std::size_t expectedKeys);
+    void Insert(std::uint64_t key, std::uint32_t row, std::vector<std::uint32_t>& next);
+    std::uint32_t Head(std::uint64_t key) const;
+private:
+    struct Slot { std::uint64_t key = 0; std::uint32_t head = kNone; };
+    std::vector<Slot> slots;
+    std::size_t mask = 0;
+};
+
+class EndpointIndex {
+public:
+    void Build(std::vector<ConnRow> rows);
+    std::vector<const ConnRow*> ByLocalPort(std::uint16_t port) const;
+    std::vector<const ConnRow*> ByRemote(const std::uint8_t addr[16], bool ipv6, std::uint16_t port) const;
+    const std::vector<ConnRow>& Rows() const { return rows; }
+
+private:
+    static std::uint64_t RemoteKey(const ConnRow& r);
+    std::vector<ConnRow> rows;
+    FlatChainIndex byLocalPort, byRemote;
+    std::vector<std::uint32_t> nextLocal, nextRemote;
+};
@@ -0,0 +1,163 @@
+// FirewallCommandQueue.cpp
+// Worker loop: wait for work, let the burst settle for one window, flush it as one transaction
+#include "FirewallCommandQueue.h"
+#include "FirewallManager.h"
+#include "Utils.h"
+#include <algorithm>
+
+FirewallCommandQueue::FirewallCommandQueue(unsigned flushWindowMs, EngineFactory engineFactory)
+    : flushWindow(flushWindowMs), engineFactory(std::move(engineFactory)) {}
+
+FirewallCommandQueue::~FirewallCommandQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        accepting = false;
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+bool FirewallCommandQueue::Start() {
+    if (worker.joinable()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return accepting;
+    }
+    std::promise<bool> ready;
+    std::future<bool> started = ready.get_future();
+    worker = std::thread(&FirewallCommandQueue::Run, this, std::move(ready));
+    return started.get();
+}
+
+std::future<bool> FirewallCommandQueue::Block(const std::wstring& path) { return Submit(path, true); }
+
+std::future<bool> FirewallCommandQueue::Unblock(const std::wstring& path) { return Submit(path, false); }
+
+std::future<bool> FirewallCommandQueue::Submit(const std::wstring& path, bool block) {
+    std::promise<bool> promise;
+    std::future<bool> result = promise.get_future();
+    std::wstring key = Utils::CanonicalPathKey(path);
+    std::vector<std::promise<bool>> superseded;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!accepting || key.empty()) { promise.set_value(false); return result; }
+        ++metrics.submitted;
+        auto it = pending.find(key);
+        if (it == pending.end()) {
+            it = pending.emplace(std::move(key), Pending()).first;
+        } else {
+            ++metrics.coalesced;
+            // The earlier requests asked for the opposite state and will never be applied
+            if (it->second.block != block) {
+                metrics.superseded += it->second.waiters.size();
+                superseded.swap(it->second.waiters);
+            }
+        }
+        it->second.path = path;
+        it->second.block = block;
+        it->second.waiters.push_back(std::move(promise));
+        metrics.depth = pending.size();
+        metrics.maxDepth = std::max(metrics.maxDepth, metrics.depth);
+    }
+    for (auto& w : superseded) w.set_value(false);
+    wake.notify_one();
+    return result;
+}
+
+std::future<bool> FirewallCommandQueue::DeleteAll() {
+    std::promise<bool> promise;
+    std::future<bool> result = promise.get_future();
+    std::vector<std::promise<bool>> superseded;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!accepting) { promise.set_value(false); return result; }
+        ++metrics.submitted;
+        // Everything queued so far folds into the wipe: pending unblocks are carried out by
+        // it, pending blocks are reversed by it
+        metrics.coalesced += pending.size();
+        for (auto& kv : pending) {
+            auto& into = kv.second.block ? superseded : deleteWaiters;
+            for (auto& w : kv.second.waiters) into.push_back(std::move(w));
+        }
+        metrics.superseded += superseded.size();
+        pending.clear();
+        metrics.depth = 0;
+        deleteAll = true;
+        deleteWaiters.push_back(std::move(promise));
+    }
+    for (auto& w : superseded) w.set_value(false);
+    wake.notify_one();
+    return result;
+}
+
+FirewallQueueMetrics FirewallCommandQueue::Metrics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return metrics;
+}
+
+void FirewallCommandQueue::Run(std::promise<bool> ready) {
+    FirewallManager manager(engineFactory()); // the engine never leaves this thread
+    manager.SetVerbose(false); // results go to the futures; stdout belongs to the caller
+    bool initialized = manager.Initialize();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        accepting = initialized && !stopping;
+    }
+    ready.set_value(initialized);
+    if (!initialized) return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [&] { return stopping || deleteAll || !pending.empty(); });
+        if (!deleteAll && pending.empty()) break; // stopping with nothing left to flush
+        // Let the rest of a burst arrive so it lands in the same transaction
+        if (!stopping) wake.wait_for(lock, flushWindow, [&] { return stopping; });
+
+        std::unordered_map<std::wstring, Pending> batch;
+        batch.swap(pending);
+        std::vector<std::promise<bool>> wiped;
+        wiped.swap(deleteWaiters);
+        bool wipe = deleteAll;
+        deleteAll = false;
+        metrics.depth = 0;
+        lock.unlock();
+
+        std::vector<std::wstring> add, remove;
+        std::vector<Pending*> added;
+        if (wipe) {
+            // The wipe is part of the same transaction: every rule goes, then the requests
+            // made after the wipe are applied on top
+            const std::string* prev = nullptr;
+            for (const auto& r : manager.ListRules()) {
+                if (prev && *prev == r.processPath) continue;
+                remove.push_back(Utils::Utf8ToWide(r.processPath));
+                prev = &r.processPath;
+            }
+        }
+        for (auto& kv : batch) {
+            if (kv.second.block) { add.push_back(kv.second.path); added.push_back(&kv.second); }
+            else remove.push_back(kv.second.path);
+        }
+        std::vector<BatchOutcome> outcomes;
+        const bool committed = manager.ApplyBatch(add, remove, &outcomes) >= 0;
+        std::size_t failedPaths = 0;
+        for (std::size_t i = 0; i < added.size(); ++i) failedPaths += committed && outcomes[i] == BatchOutcome::Failed;
+
+        // Metrics first, so a caller whose future is ready sees this batch counted
+        lock.lock();
+        ++metrics.batches;
+        if (!committed) ++metrics.failedBatches;
+        metrics.failedPaths += failedPaths;
+        metrics.lastBatchSize = batch.size();
+        metrics.maxBatchSize = std::max(metrics.maxBatchSize, batch.size());
+        lock.unlock();
+        for (auto& w : wiped) w.set_value(committed);
+        for (auto& kv : batch) {
+            if (!kv.second.block) for (auto& w : kv.second.waiters) w.set_value(committed);
+        }
+        for (std::size_t i = 0; i < added.size(); ++i) {
+            for (auto& w : added[i]->waiters) w.set_value(outcomes[i] != BatchOutcome::Failed);
+        }
+        lock.lock();
+    }
+}
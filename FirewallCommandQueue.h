@@ -0,0 +1,78 @@
+// FirewallCommandQueue.h
+// Asynchronous, coalescing front end for FirewallManager driven by one worker thread
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "FirewallEngine.h"
+
+struct FirewallQueueMetrics {
+    std::size_t depth = 0;          // distinct paths waiting for the next flush
+    std::size_t maxDepth = 0;
+    std::uint64_t submitted = 0;    // block/unblock/delete requests accepted
+    std::uint64_t coalesced = 0;    // requests folded into one already pending for the same path
+    std::uint64_t superseded = 0;   // requests resolved false because a later one reversed them
+    std::uint64_t batches = 0;      // transactions flushed
+    std::uint64_t failedBatches = 0; // aborted transactions: every request in them failed
+    std::uint64_t failedPaths = 0;   // block requests whose filters could not be added
+    std::size_t lastBatchSize = 0;  // paths in the most recent transaction
+    std::size_t maxBatchSize = 0;
+};
+
+class FirewallCommandQueue {
+public:
+    using EngineFactory = std::function<std::unique_ptr<FirewallEngine>()>;
+    // Requests arriving within flushWindowMs of the first pending one share a transaction.
+    // The worker creates its engine with engineFactory, on its own thread.
+    explicit FirewallCommandQueue(unsigned flushWindowMs = 50, EngineFactory engineFactory = CreateWfpEngine);
+    // Flushes whatever is still pending, then stops the worker
+    ~FirewallCommandQueue();
+    FirewallCommandQueue(const FirewallCommandQueue&) = delete;
+    FirewallCommandQueue& operator=(const FirewallCommandQueue&) = delete;
+
+    // Starts the worker, which opens and owns the WFP engine; false if that failed
+    bool Start();
+    // Thread-safe. Only the last request per path before a flush is applied, so a block
+    // followed by an unblock of a path that was not blocked costs nothing.
+    // The future yields true once the transaction carrying the request commits with that
+    // path in the requested state (a block whose filters could not be added yields false).
+    // A pending request reversed by a later one for the same path never reaches the engine
+    // and yields false at once; repeats of the same request share one result.
+    std::future<bool> Block(const std::wstring& path);
+    std::future<bool> Unblock(const std::wstring& path);
+    // Drops pending requests and removes every rule in the next transaction, together with
+    // requests made after it. Dropped blocks are superseded and yield false; dropped unblocks
+    // yield that transaction's result, since the wipe removes their rules too.
+    std::future<bool> DeleteAll();
+    FirewallQueueMetrics Metrics() const;
+
+private:
+    struct Pending {
+        std::wstring path;   // latest spelling submitted for this canonical path
+        bool block = false;  // desired final state
+        std::vector<std::promise<bool>> waiters;
+    };
+    std::future<bool> Submit(const std::wstring& path, bool block);
+    void Run(std::promise<bool> ready);
+
+    std::chrono::milliseconds flushWindow;
+    EngineFactory engineFactory;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::unordered_map<std::wstring, Pending> pending; // canonical path -> request
+    bool deleteAll = false;
+    std::vector<std::promise<bool>> deleteWaiters;
+    bool accepting = false;
+    bool stopping = false;
+    FirewallQueueMetrics metrics;
+    std::thread worker;
+};
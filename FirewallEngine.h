@@ -0,0 +1,30 @@
+// FirewallEngine.h
+// The filter engine behind FirewallManager: WFP on Windows, an in-memory fake in tests/
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Which of the 8 per-path block filters: direction, IP version and protocol
+struct FilterSlot {
+    bool outbound = true;      // ALE_AUTH_CONNECT (true) or ALE_AUTH_RECV_ACCEPT (false)
+    bool ipv6 = false;
+    std::uint8_t protocol = 0; // IPPROTO_TCP (6) / IPPROTO_UDP (17)
+};
+
+class FirewallEngine {
+public:
+    virtual ~FirewallEngine() = default;
+    // Opens the session and makes sure AppGate's sublayer exists
+    virtual bool Open() = 0;
+    virtual bool BeginTransaction() = 0;
+    virtual bool CommitTransaction() = 0;
+    virtual void AbortTransaction() = 0;
+    // Blocks the executable at path in one slot; name labels the filter in the engine
+    virtual bool AddBlockFilter(const std::wstring& path, const std::wstring& name, const FilterSlot& slot, std::uint64_t& filterId) = 0;
+    virtual bool DeleteFilter(std::uint64_t filterId) = 0;
+};
+
+// Windows Filtering Platform engine with a dynamic session: its filters go away when the
+// process exits. Defined in WfpEngine.cpp, which only Windows builds compile.
+std::unique_ptr<FirewallEngine> CreateWfpEngine();
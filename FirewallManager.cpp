@@ -1,102 +1,47 @@
 // FirewallManager.cpp
-// AppGate - Implements WFP engine, sublayer, and filter management
+// AppGate - Implements filter management over a FirewallEngine (WFP by default)
 #include "FirewallManager.h"
 #include "Utils.h"
-#include <windows.h>
-#include <fwpmu.h>
 #include <vector>
 #include <string>
 #include <iostream>
-#pragma comment(lib, "fwpuclnt.lib")
+#include <algorithm>
+#include <unordered_set>
 
-// Helper: Convert std::string to wide string
-static std::wstring s2ws(const std::string& s) {
-    int slength = (int)s.length();
-    if (slength == 0) return std::wstring();
-    int len = MultiByteToWideChar(CP_UTF8, 0, s.c_str(), slength, 0, 0);
-    std::wstring r(len, L'\0');
-    MultiByteToWideChar(CP_UTF8, 0, s.c_str(), slength, &r[0], len);
-    return r;
-}
+FirewallManager::FirewallManager(std::unique_ptr<FirewallEngine> engine) : engine(std::move(engine)), open(false) {}
 
-FirewallManager::FirewallManager() : engineHandle(nullptr) {}
+FirewallManager::~FirewallManager() = default;
 
-FirewallManager::~FirewallManager() {
-    if (engineHandle) {
-        FwpmEngineClose0((HANDLE)engineHandle);
-        engineHandle = nullptr;
-    }
+bool FirewallManager::Initialize() {
+    open = engine && engine->Open();
+    return open;
 }
 
-bool FirewallManager::Initialize() {
-    FWPM_SESSION0 session = {0};
-    session.displayData.name = const_cast<wchar_t*>(L"AppGate Session");
-    session.flags = FWPM_SESSION_FLAG_DYNAMIC;
-    if (FwpmEngineOpen0(NULL, RPC_C_AUTHN_WINNT, NULL, &session, (HANDLE*)&engineHandle) != ERROR_SUCCESS) {
-        engineHandle = nullptr;
-        return false;
-    }
-    return AddSublayer();
-}
-
-bool FirewallManager::AddSublayer() {
-    FWPM_SUBLAYER0 sublayer = {0};
-    sublayer.subLayerKey = Utils::GetSublayerGuid();
-    sublayer.displayData.name = const_cast<wchar_t*>(L"AppGateSublayer");
-    sublayer.displayData.description = const_cast<wchar_t*>(L"Custom sublayer for AppGate");
-    sublayer.flags = 0;
-    sublayer.weight = 0x100;
-    DWORD status = FwpmSubLayerAdd0((HANDLE)engineHandle, &sublayer, NULL);
-    return status == ERROR_SUCCESS || status == FWP_E_ALREADY_EXISTS;
-}
-
-// Helper to add a filter for a given layer and protocol
-static bool AddBlockFilter(HANDLE engineHandle, const std::wstring& wpath, const GUID& subLayer, UINT8 protocol, const GUID& layer, UINT64& outFilterId, const std::string& programName, bool isOutbound) {
-    std::wstring ruleName = std::wstring(programName.begin(), programName.end()) + (isOutbound ? L"-Outbound" : L"-Inbound");
-    FWPM_FILTER0 filter = {0};
-    filter.displayData.name = const_cast<wchar_t*>(ruleName.c_str());
-    filter.layerKey = layer;
-    filter.subLayerKey = subLayer;
-    filter.weight.type = FWP_EMPTY;
-    filter.action.type = FWP_ACTION_BLOCK;
-    filter.numFilterConditions = 2;
-    filter.filterCondition = new FWPM_FILTER_CONDITION0[2];
-    // AppID condition
-    FWP_BYTE_BLOB* appIdBlob = nullptr;
-    if (FwpmGetAppIdFromFileName0(wpath.c_str(), &appIdBlob) != ERROR_SUCCESS) {
-        delete[] filter.filterCondition;
-        return false;
-    }
-    filter.filterCondition[0].fieldKey = FWPM_CONDITION_ALE_APP_ID;
-    filter.filterCondition[0].matchType = FWP_MATCH_EQUAL;
-    filter.filterCondition[0].conditionValue.type = FWP_BYTE_BLOB_TYPE;
-    filter.filterCondition[0].conditionValue.byteBlob = appIdBlob;
-    // Protocol condition
-    filter.filterCondition[1].fieldKey = FWPM_CONDITION_IP_PROTOCOL;
-    filter.filterCondition[1].matchType = FWP_MATCH_EQUAL;
-    filter.filterCondition[1].conditionValue.type = FWP_UINT8;
-    filter.filterCondition[1].conditionValue.uint8 = protocol;
-    UINT64 filterId = 0;
-    DWORD status = FwpmFilterAdd0(engineHandle, &filter, NULL, &filterId);
-    if (appIdBlob) CoTaskMemFree(appIdBlob);
-    delete[] filter.filterCondition;
-    if (status == ERROR_SUCCESS) { outFilterId = filterId; return true; }
-    return false;
-}
-
-bool FirewallManager::BlockProcessByPID(int pid, const std::string& path) {
+bool FirewallManager::BlockProcessByPID(int /*pid*/, const std::string& path) {
     return BlockProcessByPath(path);
 }
 
 bool FirewallManager::BlockProcessByPath(const std::string& path) {
-    if (!engineHandle) return false;
-    std::wstring wpath = s2ws(path);
-    return BlockProcessByPathW(wpath);
+    if (!open) return false;
+    return BlockProcessByPathW(Utils::Utf8ToWide(path));
 }
 
 bool FirewallManager::BlockProcessByPathW(const std::wstring& wpath) {
-    if (!engineHandle) return false;
-    const GUID subLayer = Utils::GetSublayerGuid();
+    if (!open) return false;
+    if (prefixRules.Release(wpath)) { // a prefix rule's filters: keep them, now as an explicit block
+        if (verbose) std::cout << "[+] Blocked " << Utils::WideToUtf8(wpath) << " (already filtered by a prefix rule)\n";
+        return true;
+    }
+    std::vector<RuleEntry> added;
+    if (!AddPathFilters(wpath, (int)rules.size() + 1, added)) return false;
+    rules.insert(rules.end(), added.begin(), added.end());
+    if (verbose) std::cout << "[+] Blocked " << added.front().processName << " (" << added.front().processPath << ")\n";
+    if (onBlocked) onBlocked({wpath});
+    return true;
+}
+
+// Adds the 8 layer/protocol block filters for one path; entries are returned, not stored
+bool FirewallManager::AddPathFilters(const std::wstring& wpath, int firstSerial, std::vector<RuleEntry>& added) {
     std::string programName;
     // Derive program name from path for rule naming (best-effort)
     {
@@ -105,40 +50,36 @@ bool FirewallManager::BlockProcessByPathW(const std::wstring& wpath) {
         std::wstring base = (pos != std::wstring::npos) ? file.substr(pos+1) : file;
         programName.assign(base.begin(), base.end());
     }
-    struct LayerProto { const GUID* layer; UINT8 proto; bool isOutbound; } layers[] = {
-        { &FWPM_LAYER_ALE_AUTH_CONNECT_V4, IPPROTO_TCP, true },
-        { &FWPM_LAYER_ALE_AUTH_CONNECT_V4, IPPROTO_UDP, true },
-        { &FWPM_LAYER_ALE_AUTH_CONNECT_V6, IPPROTO_TCP, true },
-        { &FWPM_LAYER_ALE_AUTH_CONNECT_V6, IPPROTO_UDP, true },
-        { &FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V4, IPPROTO_TCP, false },
-        { &FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V4, IPPROTO_UDP, false },
-        { &FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V6, IPPROTO_TCP, false },
-        { &FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V6, IPPROTO_UDP, false },
+    const std::wstring filterName(programName.begin(), programName.end());
+    // Outbound (ALE_AUTH_CONNECT) and inbound (ALE_AUTH_RECV_ACCEPT), V4 and V6, TCP and UDP
+    static const FilterSlot slots[] = {
+        { true, false, kProtoTcp }, { true, false, kProtoUdp }, { true, true, kProtoTcp }, { true, true, kProtoUdp },
+        { false, false, kProtoTcp }, { false, false, kProtoUdp }, { false, true, kProtoTcp }, { false, true, kProtoUdp },
     };
     bool anySuccess = false;
-    for (const auto& lp : layers) {
-        UINT64 filterId = 0;
-        if (AddBlockFilter((HANDLE)engineHandle, wpath, subLayer, lp.proto, *lp.layer, filterId, programName, lp.isOutbound)) {
+    for (const auto& slot : slots) {
+        std::uint64_t filterId = 0;
+        if (engine->AddBlockFilter(wpath, filterName, slot, filterId)) {
             RuleEntry entry;
-            entry.serial = (int)rules.size() + 1;
+            entry.serial = firstSerial++;
             entry.processName = programName;
             entry.processPath = Utils::WideToUtf8(wpath);
             entry.filterId = filterId;
-            rules.push_back(entry);
+            entry.outbound = slot.outbound;
+            entry.ipv6 = slot.ipv6;
+            entry.protocol = slot.protocol;
+            added.push_back(entry);
             anySuccess = true;
         }
     }
-    if (anySuccess) {
-        std::cout << "[+] Blocked " << programName << " (" << Utils::WideToUtf8(wpath) << ")\n";
-    }
     return anySuccess;
 }
 
 bool FirewallManager::UnblockProcessByPID(int pid) {
     for (auto it = rules.begin(); it != rules.end(); ) {
         if (it->serial == pid) {
-            FwpmFilterDeleteById0((HANDLE)engineHandle, it->filterId);
-            std::cout << "[-] Rule removed\n";
+            engine->DeleteFilter(it->filterId);
+            if (verbose) std::cout << "[-] Rule removed\n";
             it = rules.erase(it);
         } else {
             ++it;
@@ -148,10 +89,11 @@ bool FirewallManager::UnblockProcessByPID(int pid) {
 }
 
 bool FirewallManager::UnblockProcessByPath(const std::string& path) {
+    prefixRules.Release(Utils::Utf8ToWide(path)); // an explicit unblock also overrides a prefix rule
     for (auto it = rules.begin(); it != rules.end(); ) {
         if (it->processPath == path) {
-            FwpmFilterDeleteById0((HANDLE)engineHandle, it->filterId);
-            std::cout << "[-] Rule removed\n";
+            engine->DeleteFilter(it->filterId);
+            if (verbose) std::cout << "[-] Rule removed\n";
             it = rules.erase(it);
         } else {
             ++it;
@@ -169,8 +111,8 @@ std::vector<RuleEntry> FirewallManager::ListRules() { return rules; }
 bool FirewallManager::DeleteRuleBySerial(int serial) {
     for (auto it = rules.begin(); it != rules.end(); ) {
         if (it->serial == serial) {
-            FwpmFilterDeleteById0((HANDLE)engineHandle, it->filterId);
-            std::cout << "[-] Rule removed\n";
+            engine->DeleteFilter(it->filterId);
+            if (verbose) std::cout << "[-] Rule removed\n";
             it = rules.erase(it);
         } else {
             ++it;
@@ -181,8 +123,135 @@ bool FirewallManager::DeleteRuleBySerial(int serial) {
 
 void FirewallManager::DeleteAllRules() {
     for (auto& entry : rules) {
-        FwpmFilterDeleteById0((HANDLE)engineHandle, entry.filterId);
+        engine->DeleteFilter(entry.filterId);
     }
     rules.clear();
-    std::cout << "[-] All rules removed\n";
+    prefixRules.Clear();
+    if (verbose) std::cout << "[-] All rules removed\n";
+}
+
+int FirewallManager::BlockPrefixW(const std::wstring& pattern, const std::vector<ApplicationInfo>& inventory) {
+    if (!open) return -1;
+    // Validate first: a rejected pattern must not consume the inventory's new paths
+    if (!prefixRules.AddRule(pattern)) return -1;
+    int blocked = BlockPrefixMatches(prefixRules.ExpandNew(inventory));
+    if (verbose) std::cout << "[+] Prefix rule " << Utils::WideToUtf8(pattern) << " covers " << blocked << " new executable(s)\n";
+    return blocked;
+}
+
+int FirewallManager::UnblockPrefixW(const std::wstring& pattern) {
+    // Only paths the prefix rules blocked themselves; explicit blocks under the prefix stay
+    std::vector<std::wstring> orphaned;
+    if (!prefixRules.RemoveRule(pattern, orphaned)) return -1;
+    if (!orphaned.empty() && ApplyBatch({}, orphaned) < 0) return 0; // aborted: those filters stay
+    return (int)orphaned.size();
+}
+
+int FirewallManager::ExpandPrefixRules(const std::vector<ApplicationInfo>& inventory) {
+    if (!open || !prefixRules.RuleCount()) return 0;
+    return BlockPrefixMatches(prefixRules.ExpandNew(inventory));
+}
+
+// Blocks pending prefix matches in one transaction. A path belongs to the prefix rules only
+// once its filters exist; one that was already blocked stays an explicit block, and a
+// failed one stays pending for the next expansion.
+int FirewallManager::BlockPrefixMatches(const std::vector<std::wstring>& paths) {
+    if (paths.empty()) return 0;
+    std::vector<BatchOutcome> outcomes;
+    int blocked = ApplyBatch(paths, {}, &outcomes);
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        if (outcomes[i] == BatchOutcome::Blocked) prefixRules.MarkExpanded(paths[i]);
+        else if (outcomes[i] == BatchOutcome::AlreadyBlocked) prefixRules.Release(paths[i]);
+    }
+    return std::max(blocked, 0);
+}
+
+bool FirewallManager::ApplyPolicy(const PolicyDocument& policy, const std::vector<ApplicationInfo>& inventory, PolicyDiff& diff, bool dryRun) {
+    if (!open) return false;
+    PrefixRuleSet desiredPrefixes;
+    for (const auto& p : policy.prefixes) {
+        if (!desiredPrefixes.AddRule(p) && verbose) std::cout << "[!] Skipping invalid or duplicate prefix " << Utils::WideToUtf8(p) << "\n";
+    }
+    std::vector<std::wstring> desired = policy.paths;
+    auto expanded = desiredPrefixes.ExpandNew(inventory);
+    desired.insert(desired.end(), expanded.begin(), expanded.end());
+    std::vector<std::wstring> current;
+    const std::string* prev = nullptr;
+    for (const auto& r : rules) {
+        // Filters of one path are stored consecutively; convert each path once
+        if (prev && *prev == r.processPath) continue;
+        current.push_back(Utils::Utf8ToWide(r.processPath));
+        prev = &r.processPath;
+    }
+    diff = ComputePolicyDiff(desired, current);
+    if (dryRun) return true;
+
+    std::vector<BatchOutcome> outcomes;
+    if (ApplyBatch(diff.addPaths, diff.removePaths, &outcomes) < 0) return false;
+    // Prefix matches the policy does not also list explicitly now belong to the prefix rules,
+    // except those whose block failed: they stay pending and are retried on the next expansion
+    std::unordered_set<std::wstring> failed, explicitKeys;
+    for (std::size_t i = 0; i < outcomes.size(); ++i) {
+        if (outcomes[i] == BatchOutcome::Failed) failed.insert(Utils::CanonicalPathKey(diff.addPaths[i]));
+    }
+    for (const auto& p : policy.paths) explicitKeys.insert(Utils::CanonicalPathKey(p));
+    for (const auto& p : expanded) {
+        const std::wstring key = Utils::CanonicalPathKey(p);
+        if (explicitKeys.count(key)) desiredPrefixes.Release(p);
+        else if (!failed.count(key)) desiredPrefixes.MarkExpanded(p);
+    }
+    prefixRules = std::move(desiredPrefixes);
+    if (verbose) std::cout << "[+] Policy applied: " << diff.addPaths.size() << " added, " << diff.removePaths.size() << " removed, " << diff.unchanged << " unchanged\n";
+    return true;
+}
+
+int FirewallManager::BlockPathsW(const std::vector<std::wstring>& paths) {
+    int blocked = ApplyBatch(paths, {});
+    if (blocked >= 0 && verbose) std::cout << "[+] Blocked " << blocked << " executable(s) in one transaction\n";
+    return blocked;
+}
+
+int FirewallManager::ApplyBatch(const std::vector<std::wstring>& add, const std::vector<std::wstring>& remove, std::vector<BatchOutcome>* outcomes) {
+    if (outcomes) outcomes->assign(add.size(), BatchOutcome::Failed);
+    if (!open) return -1;
+    std::unordered_set<std::wstring> removeKeys;
+    for (const auto& p : remove) removeKeys.insert(Utils::CanonicalPathKey(p));
+    std::unordered_set<std::wstring> present; // paths that stay blocked after the removals
+    std::vector<RuleEntry> kept;
+    kept.reserve(rules.size());
+    if (!engine->BeginTransaction()) return -1;
+    bool ok = true;
+    const std::string* prev = nullptr;
+    std::wstring key;
+    for (const auto& r : rules) {
+        // Filters of one path are stored consecutively; canonicalize each path once
+        if (!prev || *prev != r.processPath) { key = Utils::CanonicalPathKey(Utils::Utf8ToWide(r.processPath)); prev = &r.processPath; }
+        if (!removeKeys.count(key)) { kept.push_back(r); present.insert(key); continue; }
+        if (!engine->DeleteFilter(r.filterId)) { ok = false; break; }
+    }
+    std::vector<RuleEntry> added;
+    std::vector<BatchOutcome> results(add.size(), BatchOutcome::Failed);
+    int blocked = 0;
+    for (std::size_t i = 0; ok && i < add.size(); ++i) {
+        const auto& p = add[i];
+        if (p.empty()) continue;
+        if (!present.insert(Utils::CanonicalPathKey(p)).second) { results[i] = BatchOutcome::AlreadyBlocked; continue; } // or repeated
+        if (AddPathFilters(p, (int)(kept.size() + added.size()) + 1, added)) { results[i] = BatchOutcome::Blocked; ++blocked; }
+        else if (verbose) std::cout << "[!] Could not block " << Utils::WideToUtf8(p) << "\n";
+    }
+    if (!ok || !engine->CommitTransaction()) {
+        engine->AbortTransaction();
+        if (verbose) std::cout << "[!] Transaction aborted; no rules were changed.\n";
+        return -1;
+    }
+    kept.insert(kept.end(), added.begin(), added.end());
+    rules.swap(kept);
+    std::vector<std::wstring> newlyBlocked;
+    if (onBlocked && blocked) {
+        newlyBlocked.reserve(blocked);
+        for (std::size_t i = 0; i < add.size(); ++i) if (results[i] == BatchOutcome::Blocked) newlyBlocked.push_back(add[i]);
+    }
+    if (outcomes) outcomes->swap(results);
+    if (!newlyBlocked.empty()) onBlocked(newlyBlocked);
+    return blocked;
 }
@@ -1,15 +1,31 @@
 // FirewallManager.h
-// AppGate - Manages WFP engine, sublayer, and filter rules
+// AppGate - Manages the filter rules AppGate creates through a FirewallEngine
 #pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <string>
 #include "Models.h"
+#include "FirewallEngine.h"
+#include "ApplicationInfo.h"
+#include "PrefixRules.h"
+#include "PolicyFile.h"
+
+// What ApplyBatch did with one path of its add list
+enum class BatchOutcome : std::uint8_t { Blocked, AlreadyBlocked, Failed };
 
 class FirewallManager {
 public:
-    FirewallManager();
+    explicit FirewallManager(std::unique_ptr<FirewallEngine> engine = CreateWfpEngine());
     ~FirewallManager();
     bool Initialize();
+    // Progress and failure messages on stdout (on by default); results are returned either way
+    void SetVerbose(bool on) { verbose = on; }
+    // Called after each successful change with the paths that just got filters (not those
+    // that were already blocked), e.g. to record their content while it is still trusted
+    using BlockedCallback = std::function<void(const std::vector<std::wstring>& paths)>;
+    void SetBlockedCallback(BlockedCallback cb) { onBlocked = std::move(cb); }
     bool BlockProcessByPID(int pid, const std::string& path);
     bool BlockProcessByPath(const std::string& path);
     // Wide path overloads for Unicode-safe operations
@@ -20,9 +36,30 @@ public:
     std::vector<RuleEntry> ListRules();
     bool DeleteRuleBySerial(int serial);
     void DeleteAllRules();
+    // Directory-prefix / glob rules, expanded to AppID filters from the app inventory.
+    // Return the number of executables newly blocked (or unblocked), -1 for an invalid pattern.
+    int BlockPrefixW(const std::wstring& pattern, const std::vector<ApplicationInfo>& inventory);
+    int UnblockPrefixW(const std::wstring& pattern);
+    int ExpandPrefixRules(const std::vector<ApplicationInfo>& inventory);
+    std::vector<std::wstring> ListPrefixRules() const { return prefixRules.Rules(); }
+    // Blocks every distinct path in one WFP transaction; returns the number of paths blocked
+    int BlockPathsW(const std::vector<std::wstring>& paths);
+    // Removes, then adds, in one WFP transaction. Paths already blocked are not re-added.
+    // Returns the number of paths newly blocked, or -1 if the transaction was aborted.
+    // outcomes, if given, receives one entry per add path (all Failed when aborted).
+    int ApplyBatch(const std::vector<std::wstring>& add, const std::vector<std::wstring>& remove, std::vector<BatchOutcome>* outcomes = nullptr);
+    // Brings the rule store to the policy's desired state by applying only the add/remove
+    // diff inside one WFP transaction. With dryRun the diff is computed but not applied.
+    bool ApplyPolicy(const PolicyDocument& policy, const std::vector<ApplicationInfo>& inventory, PolicyDiff& diff, bool dryRun = false);
 private:
-    void* engineHandle; // FWPM_SESSION0*
+    static constexpr std::uint8_t kProtoTcp = 6;  // IPPROTO_TCP
+    static constexpr std::uint8_t kProtoUdp = 17; // IPPROTO_UDP
+    std::unique_ptr<FirewallEngine> engine;
+    bool open;
+    bool verbose = true;
+    BlockedCallback onBlocked;
     std::vector<RuleEntry> rules;
-    bool AddSublayer();
-    bool LoadRulesFromWFP();
+    PrefixRuleSet prefixRules;
+    bool AddPathFilters(const std::wstring& wpath, int firstSerial, std::vector<RuleEntry>& added);
+    int BlockPrefixMatches(const std::vector<std::wstring>& paths);
 };
@@ -3,8 +3,10 @@
 #include "InstalledAppsManager.h"
 #include "ApplicationInfo.h"
 #include "Utils.h"
+#include "LnkParser.h"
+#include "PeVersion.h"
+#include "Instrumentation.h"
 #include <windows.h>
-#include <winver.h>
 #include <shlwapi.h>
 #include <shlobj.h>
 #include <psapi.h>
@@ -12,9 +14,12 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cstdint>
+#include <numeric>
 #include <filesystem>
 #include <cstdio>
 #include <fstream>
+#include <iterator>
 #pragma comment(lib, "Shlwapi.lib")
 
 namespace fs = std::filesystem;
@@ -51,20 +56,6 @@ static std::wstring NormalizePathW(std::wstring p) {
     return (m > 0 && m < _countof(full)) ? std::wstring(full) : std::wstring(src);
 }
 
-static std::wstring GetFileProductName(const std::wstring& path) {
-    DWORD handle = 0; DWORD size = GetFileVersionInfoSizeW(path.c_str(), &handle);
-    if (!size) return L"";
-    std::vector<BYTE> data(size);
-    if (!GetFileVersionInfoW(path.c_str(), handle, size, data.data())) return L"";
-    struct LANGANDCODEPAGE { WORD wLanguage; WORD wCodePage; } *lpTranslate;
-    UINT cbTranslate = 0;
-    if (!VerQueryValueW(data.data(), L"\\VarFileInfo\\Translation", (LPVOID*)&lpTranslate, &cbTranslate) || !cbTranslate) return L"";
-    wchar_t subblock[256]; swprintf_s(subblock, L"\\StringFileInfo\\%04x%04x\\ProductName", lpTranslate[0].wLanguage, lpTranslate[0].wCodePage);
-    LPVOID lpBuffer = nullptr; UINT dwBytes = 0;
-    if (VerQueryValueW(data.data(), subblock, &lpBuffer, &dwBytes) && dwBytes) { return std::wstring((wchar_t*)lpBuffer); }
-    return L"";
-}
-
 static std::wstring FindExeInDir(const std::wstring& dir, const std::wstring& preferredName) {
     std::wstring best;
     if (!PathFileExistsW(dir.c_str())) return best;
@@ -83,49 +74,159 @@ static std::wstring FindExeInDir(const std::wstring& dir, const std::wstring& pr
     return best;
 }
 
-void InstalledAppsManager::FromRegistry(std::vector<ApplicationInfo>& out) {
-    struct Key { HKEY root; const wchar_t* sub; } keys[] = {
+// Reads a REG_SZ / REG_EXPAND_SZ value of any length (unexpanded); empty if absent
+static void ReadRegString(HKEY key, const wchar_t* name, std::wstring& out) {
+    out.clear();
+    const DWORD flags = RRF_RT_REG_SZ | RRF_RT_REG_EXPAND_SZ | RRF_NOEXPAND;
+    DWORD bytes = 0;
+    if (APPGATE_TIMED("RegGetValueW", RegGetValueW(key, NULL, name, flags, NULL, NULL, &bytes)) != ERROR_SUCCESS || bytes < sizeof(wchar_t)) return;
+    out.resize(bytes / sizeof(wchar_t));
+    if (APPGATE_TIMED("RegGetValueW", RegGetValueW(key, NULL, name, flags, NULL, &out[0], &bytes)) != ERROR_SUCCESS) { out.clear(); return; }
+    out.resize(wcsnlen(out.c_str(), out.size()));
+}
+
+namespace {
+    struct UninstallRoot { HKEY hive; const wchar_t* sub; };
+    const UninstallRoot kRoots[] = {
         { HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall" },
         { HKEY_LOCAL_MACHINE, L"SOFTWARE\\WOW6432Node\\Microsoft\\Windows\\CurrentVersion\\Uninstall" },
         { HKEY_CURRENT_USER,  L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall" },
     };
-    for (auto& k : keys) {
-        HKEY hKey; if (RegOpenKeyExW(k.root, k.sub, 0, KEY_READ, &hKey) != ERROR_SUCCESS) continue;
-        DWORD idx = 0; wchar_t subName[256]; DWORD subLen;
-        while (true) {
-            subLen = _countof(subName); FILETIME ft{};
-            if (RegEnumKeyExW(hKey, idx++, subName, &subLen, NULL, NULL, NULL, &ft) != ERROR_SUCCESS) break;
-            HKEY hApp; if (RegOpenKeyExW(hKey, subName, 0, KEY_READ, &hApp) != ERROR_SUCCESS) continue;
-            wchar_t displayName[1024] = L""; DWORD dnSize = sizeof(displayName);
-            wchar_t displayIcon[2048] = L""; DWORD diSize = sizeof(displayIcon);
-            wchar_t installLocation[2048] = L""; DWORD ilSize = sizeof(installLocation);
-            wchar_t uninstallStr[2048] = L""; DWORD usSize = sizeof(uninstallStr);
-            RegQueryValueExW(hApp, L"DisplayName", NULL, NULL, (LPBYTE)displayName, &dnSize);
-            RegQueryValueExW(hApp, L"DisplayIcon", NULL, NULL, (LPBYTE)displayIcon, &diSize);
-            RegQueryValueExW(hApp, L"InstallLocation", NULL, NULL, (LPBYTE)installLocation, &ilSize);
-            RegQueryValueExW(hApp, L"UninstallString", NULL, NULL, (LPBYTE)uninstallStr, &usSize);
-
-            std::wstring exeCandidate;
-            if (displayIcon[0]) { exeCandidate = NormalizePathW(displayIcon); }
-            if (exeCandidate.empty() && uninstallStr[0]) { exeCandidate = NormalizePathW(uninstallStr); }
-            if (!exeCandidate.empty() && !IsExePathW(exeCandidate)) exeCandidate.clear();
-            if (exeCandidate.empty() && installLocation[0]) {
-                std::wstring dir = NormalizePathW(installLocation);
-                std::wstring guess;
-                if (displayName[0]) guess = dir + L"\\" + displayName + L".exe";
-                if (!guess.empty() && PathFileExistsW(guess.c_str())) exeCandidate = guess;
-                if (exeCandidate.empty()) exeCandidate = FindExeInDir(dir, displayName);
-            }
-            if (displayName[0] && !exeCandidate.empty() && PathFileExistsW(exeCandidate.c_str())) {
-                out.push_back({displayName, exeCandidate, L"Registry", false});
+
+    // The uninstall roots, read through the live registry
+    class Win32UninstallSource : public RegistryKeySource {
+    public:
+        std::size_t RootCount() const override { return _countof(kRoots); }
+        bool ListSubkeys(std::size_t root, std::vector<RegistrySubkey>& out) override {
+            HKEY hKey;
+            if (APPGATE_TIMED("RegOpenKeyExW", RegOpenKeyExW(kRoots[root].hive, kRoots[root].sub, 0, KEY_READ, &hKey)) != ERROR_SUCCESS) return false;
+            wchar_t name[256]; // registry key names are at most 255 characters
+            for (DWORD idx = 0; ; ++idx) {
+                DWORD len = _countof(name); FILETIME ft{};
+                LSTATUS status = APPGATE_TIMED("RegEnumKeyExW", RegEnumKeyExW(hKey, idx, name, &len, NULL, NULL, NULL, &ft));
+                if (status == ERROR_MORE_DATA) continue;
+                if (status != ERROR_SUCCESS) break;
+                out.push_back({std::wstring(name, len), ((std::uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime});
             }
+            RegCloseKey(hKey);
+            return true;
+        }
+        bool ReadValues(std::size_t root, const std::wstring& subkey, UninstallValues& out) override {
+            std::wstring path = std::wstring(kRoots[root].sub) + L"\\" + subkey;
+            HKEY hApp;
+            if (APPGATE_TIMED("RegOpenKeyExW", RegOpenKeyExW(kRoots[root].hive, path.c_str(), 0, KEY_READ, &hApp)) != ERROR_SUCCESS) return false;
+            ReadRegString(hApp, L"DisplayName", out.displayName);
+            ReadRegString(hApp, L"DisplayIcon", out.displayIcon);
+            ReadRegString(hApp, L"InstallLocation", out.installLocation);
+            ReadRegString(hApp, L"UninstallString", out.uninstallString);
             RegCloseKey(hApp);
+            return true;
         }
-        RegCloseKey(hKey);
+    };
+}
+
+// Picks the executable for one uninstall entry: DisplayIcon, then UninstallString,
+// then <InstallLocation>\<DisplayName>.exe or the best .exe under InstallLocation
+static bool ResolveUninstallEntry(const UninstallValues& v, ApplicationInfo& app) {
+    if (v.displayName.empty()) return false;
+    std::wstring exeCandidate;
+    if (!v.displayIcon.empty()) { exeCandidate = NormalizePathW(v.displayIcon); }
+    if (exeCandidate.empty() && !v.uninstallString.empty()) { exeCandidate = NormalizePathW(v.uninstallString); }
+    if (!exeCandidate.empty() && !IsExePathW(exeCandidate)) exeCandidate.clear();
+    if (exeCandidate.empty() && !v.installLocation.empty()) {
+        std::wstring dir = NormalizePathW(v.installLocation);
+        std::wstring guess = dir + L"\\" + v.displayName + L".exe";
+        if (PathFileExistsW(guess.c_str())) exeCandidate = guess;
+        if (exeCandidate.empty()) exeCandidate = FindExeInDir(dir, v.displayName);
     }
+    if (exeCandidate.empty() || !PathFileExistsW(exeCandidate.c_str())) return false;
+    app = {v.displayName, exeCandidate, L"Registry", false};
+    return true;
+}
+
+// Last-write time of an InstallLocation directory, 0 if it is missing. It moves when an
+// installer adds or removes files directly in it.
+static std::uint64_t InstallDirWriteTime(const std::wstring& installLocation) {
+    const std::wstring dir = NormalizePathW(installLocation);
+    WIN32_FILE_ATTRIBUTE_DATA fad{};
+    if (dir.empty() || !GetFileAttributesExW(dir.c_str(), GetFileExInfoStandard, &fad) || !(fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) return 0;
+    return ((std::uint64_t)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+}
+
+InstalledAppsManager::InstalledAppsManager()
+    : registrySource(std::make_unique<Win32UninstallSource>()),
+      registryScan(*registrySource, ResolveUninstallEntry, [](const std::wstring& p) { return PathFileExistsW(p.c_str()) != FALSE; }, InstallDirWriteTime) {}
+
+void InstalledAppsManager::FromRegistry(std::vector<ApplicationInfo>& out) {
+    APPGATE_PROBE("FromRegistry.Refresh");
+    registryScan.Refresh(out);
+}
+
+// Maps a file read-only for the duration of fn(data, size); false if it cannot be mapped
+template <class Fn>
+static bool WithMappedFile(const std::wstring& path, std::uint64_t maxSize, Fn fn) {
+    Utils::MappedFile file;
+    if (!file.Open(path) || file.Size() > maxSize) return false;
+    const std::uint8_t* data = file.MapAll();
+    if (!data) return false;
+    fn(data, (std::size_t)file.Size());
+    return true;
+}
+
+// ProductName from the version resource, read in place: only the headers and the
+// resource pages of the mapping are ever touched
+static std::wstring GetFileProductName(const std::wstring& path) {
+    std::wstring name;
+    WithMappedFile(path, UINT64_MAX, [&](const std::uint8_t* data, std::size_t size) {
+        PeVersionStrings strings;
+        if (APPGATE_TIMED("ReadPeVersionStrings", ReadPeVersionStrings(data, size, strings))) name = strings.productName.ToWide();
+    });
+    return name;
+}
+
+// Maps one .lnk read-only and returns its target with environment variables expanded
+static std::wstring ReadShortcutTarget(const std::wstring& lnkPath) {
+    std::wstring target;
+    // Real shortcuts are a few KB; anything huge is not worth mapping
+    WithMappedFile(lnkPath, 1 << 20, [&](const std::uint8_t* data, std::size_t size) {
+        ShellLink link;
+        // Advertised (MSI) shortcuts have no usable path; the installer resolves them
+        if (ParseShellLink(data, size, link) && !link.advertised) target = link.Target();
+    });
+    if (target.find(L'%') != std::wstring::npos) {
+        wchar_t exp[4096]; DWORD n = ExpandEnvironmentStringsW(target.c_str(), exp, _countof(exp));
+        if (n > 0 && n < _countof(exp)) target = exp;
+    }
+    return target;
+}
+
+void InstalledAppsManager::FromStartMenu(std::vector<ApplicationInfo>& out) {
+    APPGATE_PROBE("FromStartMenu.Scan");
+    const int roots[] = { CSIDL_COMMON_PROGRAMS, CSIDL_PROGRAMS };
+    std::vector<std::vector<std::wstring>> perRoot(_countof(roots));
+    Utils::ParallelFor(_countof(roots), 0, [&](std::size_t r) {
+        wchar_t dir[MAX_PATH];
+        if (FAILED(SHGetFolderPathW(NULL, roots[r], NULL, SHGFP_TYPE_CURRENT, dir)) || !PathFileExistsW(dir)) return;
+        try {
+            for (const auto& entry : fs::recursive_directory_iterator(dir, fs::directory_options::skip_permission_denied)) {
+                if (entry.is_regular_file() && PathMatchSpecW(entry.path().c_str(), L"*.lnk")) perRoot[r].push_back(entry.path().wstring());
+            }
+        } catch (...) { /* ignore permission errors */ }
+    });
+    std::vector<std::wstring> links;
+    for (auto& v : perRoot) links.insert(links.end(), std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()));
+
+    std::vector<ApplicationInfo> found(links.size());
+    Utils::ParallelFor(links.size(), 0, [&](std::size_t i) {
+        std::wstring exe = ReadShortcutTarget(links[i]);
+        if (exe.empty() || !IsExePathW(exe) || !PathFileExistsW(exe.c_str())) return;
+        found[i] = {fs::path(links[i]).stem().wstring(), exe, L"StartMenu", false};
+    });
+    for (auto& app : found) if (!app.exePath.empty()) out.push_back(std::move(app));
 }
 
 void InstalledAppsManager::FromUWP(std::vector<ApplicationInfo>& out) {
+    APPGATE_PROBE("FromUWP.PowerShell");
     // Use a temporary PowerShell script to avoid cmd parsing issues (UTF-16 path safe)
     wchar_t tempPath[MAX_PATH]; GetTempPathW(_countof(tempPath), tempPath);
     wchar_t tmpFile[MAX_PATH]; GetTempFileNameW(tempPath, L"apx", 0, tmpFile);
@@ -152,63 +253,82 @@ void InstalledAppsManager::FromUWP(std::vector<ApplicationInfo>& out) {
     DeleteFileW(scriptPath.c_str());
 }
 
+// Version resources are read in parallel; each name falls back to the file stem
+static void AppendWithProductNames(const std::vector<std::wstring>& exes, const wchar_t* source, std::vector<ApplicationInfo>& out) {
+    std::vector<std::wstring> names(exes.size());
+    Utils::ParallelFor(exes.size(), 0, [&](std::size_t i) { names[i] = GetFileProductName(exes[i]); });
+    out.reserve(out.size() + exes.size());
+    for (std::size_t i = 0; i < exes.size(); ++i) {
+        if (names[i].empty()) names[i] = fs::path(exes[i]).stem().wstring();
+        out.push_back({std::move(names[i]), exes[i], source, false});
+    }
+}
+
 void InstalledAppsManager::FromFilesystem(std::vector<ApplicationInfo>& out) {
+    APPGATE_PROBE("FromFilesystem.Scan");
     std::vector<std::wstring> roots;
     wchar_t pf[MAX_PATH]; if (SUCCEEDED(SHGetFolderPathW(NULL, CSIDL_PROGRAM_FILES, NULL, SHGFP_TYPE_CURRENT, pf))) roots.push_back(pf);
     wchar_t pfx86[MAX_PATH]; if (SUCCEEDED(SHGetFolderPathW(NULL, CSIDL_PROGRAM_FILESX86, NULL, SHGFP_TYPE_CURRENT, pfx86))) roots.push_back(pfx86);
     wchar_t lad[MAX_PATH]; if (SUCCEEDED(SHGetFolderPathW(NULL, CSIDL_LOCAL_APPDATA, NULL, SHGFP_TYPE_CURRENT, lad))) { roots.push_back(std::wstring(lad) + L"\\Programs"); roots.push_back(lad); }
     wchar_t rad[MAX_PATH]; if (SUCCEEDED(SHGetFolderPathW(NULL, CSIDL_APPDATA, NULL, SHGFP_TYPE_CURRENT, rad))) roots.push_back(rad);
+    std::vector<std::wstring> exes;
     for (const auto& root : roots) {
         if (!PathFileExistsW(root.c_str())) continue;
         try {
             for (const auto& entry : fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied)) {
                 if (!entry.is_regular_file()) continue;
                 auto p = entry.path().wstring();
-                if (!IsExePathW(p)) continue;
-                auto name = GetFileProductName(p);
-                if (name.empty()) name = entry.path().stem().wstring();
-                out.push_back({name, p, L"Filesystem", false});
+                if (IsExePathW(p)) exes.push_back(std::move(p));
             }
         } catch (...) { /* ignore permission errors */ }
     }
+    AppendWithProductNames(exes, L"Filesystem", out);
 }
 
 void InstalledAppsManager::FromProcesses(std::vector<ApplicationInfo>& out) {
     DWORD pids[8192]; DWORD needed = 0;
-    if (!EnumProcesses(pids, sizeof(pids), &needed)) return;
+    if (!APPGATE_TIMED("EnumProcesses", EnumProcesses(pids, sizeof(pids), &needed))) return;
     DWORD count = needed / sizeof(DWORD);
+    std::vector<std::wstring> exes;
     for (DWORD i = 0; i < count; ++i) {
         DWORD pid = pids[i]; if (!pid) continue;
-        HANDLE h = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
+        HANDLE h = APPGATE_TIMED("OpenProcess", OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid));
         if (!h) continue;
         wchar_t path[MAX_PATH] = L"";
-        if (GetModuleFileNameExW(h, NULL, path, _countof(path))) {
-            std::wstring wpath(path);
-            std::wstring name = GetFileProductName(wpath);
-            if (name.empty()) name = fs::path(wpath).stem().wstring();
-            out.push_back({name, wpath, L"Process", false});
-        }
+        if (APPGATE_TIMED("GetModuleFileNameExW", GetModuleFileNameExW(h, NULL, path, _countof(path)))) exes.push_back(path);
         CloseHandle(h);
     }
+    AppendWithProductNames(exes, L"Process", out);
 }
 
 std::vector<ApplicationInfo> InstalledAppsManager::EnumerateAll() {
     std::vector<ApplicationInfo> all;
     FromRegistry(all);
+    FromStartMenu(all);
     FromUWP(all);
     FromFilesystem(all);
     FromProcesses(all);
 
     auto rank = [](const std::wstring& src){
-        if (src == L"UWP") return 3; if (src == L"Registry") return 2; if (src == L"Filesystem") return 1; return 0;
+        if (src == L"UWP") return 4; if (src == L"Registry") return 3; if (src == L"StartMenu") return 2; if (src == L"Filesystem") return 1; return 0;
     };
-    std::sort(all.begin(), all.end(), [&](const ApplicationInfo& a, const ApplicationInfo& b){
-        int c = _wcsicmp(a.exePath.c_str(), b.exePath.c_str());
-        if (c == 0) return rank(a.source) > rank(b.source);
+    // Sort an index rather than shuffling the records, then move each path's best-ranked
+    // record out once
+    std::vector<std::uint32_t> order(all.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::vector<int> ranks;
+    ranks.reserve(all.size());
+    for (const auto& app : all) ranks.push_back(rank(app.source));
+    std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b){
+        int c = _wcsicmp(all[a].exePath.c_str(), all[b].exePath.c_str());
+        if (c == 0) return ranks[a] > ranks[b];
         return c < 0;
     });
-    all.erase(std::unique(all.begin(), all.end(), [](const ApplicationInfo& a, const ApplicationInfo& b){
-        return _wcsicmp(a.exePath.c_str(), b.exePath.c_str()) == 0;
-    }), all.end());
-    return all;
+    std::vector<ApplicationInfo> result;
+    result.reserve(all.size());
+    for (auto i : order) {
+        if (!result.empty() && _wcsicmp(result.back().exePath.c_str(), all[i].exePath.c_str()) == 0) continue;
+        result.push_back(std::move(all[i]));
+    }
+    return result;
 }
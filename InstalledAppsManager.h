@@ -1,17 +1,23 @@
 #pragma once
+#include <memory>
 #include <vector>
 #include <string>
 #include "ApplicationInfo.h"
+#include "RegistryScan.h"
 
 // Aggregates installed applications from multiple sources
 class InstalledAppsManager {
 public:
+    InstalledAppsManager();
     // Enumerate registry (Win32), Start Menu shortcuts, UWP, filesystem, and running processes
     std::vector<ApplicationInfo> EnumerateAll();
 
 private:
-    void FromRegistry(std::vector<ApplicationInfo>& out);
+    void FromRegistry(std::vector<ApplicationInfo>& out); // incremental: unchanged uninstall keys come from cache
+    void FromStartMenu(std::vector<ApplicationInfo>& out); // .lnk files parsed natively, in parallel
     void FromUWP(std::vector<ApplicationInfo>& out); // Uses PackageManager if available, falls back to PowerShell
     void FromFilesystem(std::vector<ApplicationInfo>& out);
     void FromProcesses(std::vector<ApplicationInfo>& out);
+    std::unique_ptr<RegistryKeySource> registrySource;
+    RegistryScan registryScan; // keeps resolved uninstall entries between enumerations
 };
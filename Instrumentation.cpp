@@ -0,0 +1,188 @@
+// Instrumentation.cpp
+// Per-thread histogram blocks merged on demand; the hot path takes no locks
+#include "Instrumentation.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace Instrumentation {
+
+namespace {
+    struct ProbeHistogram {
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> totalNs{0};
+        std::atomic<std::uint64_t> maxNs{0};
+        std::array<std::atomic<std::uint64_t>, kBuckets> buckets{};
+    };
+
+    // One block per thread. Only the owning thread writes (plain load/store, no RMW);
+    // Snapshot() reads with relaxed loads, so a merge may lag by an in-flight sample.
+    struct ThreadBlock {
+        std::array<ProbeHistogram, kMaxProbes> probes;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::array<const char*, kMaxProbes> names{};
+        std::atomic<int> probeCount{0};
+        std::vector<std::unique_ptr<ThreadBlock>> threads; // every block ever handed out
+        std::vector<ThreadBlock*> idle;                    // blocks of exited threads, for reuse
+    };
+
+    // Intentionally leaked so it is still alive when DumpOnExit runs from atexit
+    Registry& GetRegistry() {
+        static Registry* r = new Registry();
+        return *r;
+    }
+
+    // A thread's claim on a block. On thread exit the block goes back to the idle list with
+    // its counts intact (Snapshot still sums it), and the next new thread keeps adding to it,
+    // so short-lived worker threads cost no memory beyond the peak number of live threads.
+    struct BlockLease {
+        ThreadBlock* block = nullptr;
+        ~BlockLease() {
+            if (!block) return;
+            Registry& r = GetRegistry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.idle.push_back(block);
+        }
+    };
+
+    ThreadBlock* LocalBlock() {
+        thread_local BlockLease lease;
+        if (!lease.block) {
+            Registry& r = GetRegistry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            if (!r.idle.empty()) {
+                lease.block = r.idle.back(); // the mutex orders the previous owner's writes before ours
+                r.idle.pop_back();
+            } else {
+                r.threads.push_back(std::make_unique<ThreadBlock>());
+                lease.block = r.threads.back().get();
+            }
+        }
+        return lease.block;
+    }
+
+    std::size_t BucketIndex(std::uint64_t ns) {
+        if (ns < 8) return (std::size_t)ns;
+        int e = 63;
+        while (!(ns >> e)) --e;
+        std::size_t sub = (std::size_t)((ns >> (e - 3)) & 7);
+        return (std::size_t)(e - 2) * 8 + sub;
+    }
+
+    std::uint64_t BucketLowerBound(std::size_t idx) {
+        if (idx < 8) return idx;
+        int e = (int)(idx / 8) + 2;
+        return (std::uint64_t)(8 + idx % 8) << (e - 3);
+    }
+
+    void Bump(std::atomic<std::uint64_t>& a, std::uint64_t by) {
+        a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+}
+
+int RegisterProbe(const char* name) {
+    Registry& r = GetRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    int n = r.probeCount.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; ++i) {
+        if (std::strcmp(r.names[(std::size_t)i], name) == 0) return i;
+    }
+    if ((std::size_t)n >= kMaxProbes) return -1;
+    r.names[(std::size_t)n] = name;
+    r.probeCount.store(n + 1, std::memory_order_release);
+    return n;
+}
+
+void Record(int probe, std::uint64_t ns) {
+    if (probe < 0) return;
+    ProbeHistogram& h = LocalBlock()->probes[(std::size_t)probe];
+    Bump(h.count, 1);
+    Bump(h.totalNs, ns);
+    if (ns > h.maxNs.load(std::memory_order_relaxed)) h.maxNs.store(ns, std::memory_order_relaxed);
+    Bump(h.buckets[BucketIndex(ns)], 1);
+}
+
+std::size_t ThreadBlocks() {
+    Registry& r = GetRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.threads.size();
+}
+
+std::vector<ProbeSummary> Snapshot() {
+    std::vector<ProbeSummary> out;
+    Registry& r = GetRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    int n = r.probeCount.load(std::memory_order_acquire);
+    for (int p = 0; p < n; ++p) {
+        ProbeSummary s;
+        s.name = r.names[(std::size_t)p];
+        std::vector<std::uint64_t> merged(kBuckets, 0);
+        for (const auto& t : r.threads) {
+            const ProbeHistogram& h = t->probes[(std::size_t)p];
+            s.count += h.count.load(std::memory_order_relaxed);
+            s.totalNs += h.totalNs.load(std::memory_order_relaxed);
+            s.maxNs = std::max(s.maxNs, h.maxNs.load(std::memory_order_relaxed));
+            for (std::size_t b = 0; b < kBuckets; ++b) merged[b] += h.buckets[b].load(std::memory_order_relaxed);
+        }
+        if (!s.count) continue;
+        std::uint64_t total = 0;
+        for (auto c : merged) total += c;
+        auto percentile = [&](double q) {
+            std::uint64_t target = (std::uint64_t)(q * (double)total), seen = 0;
+            for (std::size_t b = 0; b < kBuckets; ++b) {
+                seen += merged[b];
+                if (seen > target) return BucketLowerBound(b);
+            }
+            return s.maxNs;
+        };
+        s.p50Ns = percentile(0.50);
+        s.p90Ns = percentile(0.90);
+        s.p99Ns = percentile(0.99);
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+std::string ToJson() {
+    std::ostringstream oss;
+    oss << "{\n  \"enabled\": " << (kEnabled ? "true" : "false") << ",\n  \"probes\": [";
+    bool first = true;
+    for (const auto& s : Snapshot()) {
+        oss << (first ? "\n" : ",\n");
+        first = false;
+        oss << "    {\"name\": \"";
+        for (char c : s.name) { if (c == '"' || c == '\\') oss << '\\'; oss << c; }
+        oss << "\", \"count\": " << s.count
+            << ", \"total_ns\": " << s.totalNs
+            << ", \"max_ns\": " << s.maxNs
+            << ", \"p50_ns\": " << s.p50Ns
+            << ", \"p90_ns\": " << s.p90Ns
+            << ", \"p99_ns\": " << s.p99Ns << "}";
+    }
+    oss << (first ? "]\n}\n" : "\n  ]\n}\n");
+    return oss.str();
+}
+
+bool WriteJson(const std::string& path) {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) return false;
+    ofs << ToJson();
+    return (bool)ofs;
+}
+
+void DumpOnExit() {
+    if (!kEnabled) return;
+    const char* env = std::getenv("APPGATE_STATS_FILE");
+    WriteJson(env && *env ? env : "appgate-stats.json");
+}
+
+}
@@ -0,0 +1,72 @@
+// Instrumentation.h
+// Scoped timers, per-thread latency histograms and call counters for OS boundaries
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Instrumentation {
+#ifdef APPGATE_INSTRUMENTATION
+    constexpr bool kEnabled = true;
+#else
+    constexpr bool kEnabled = false;
+#endif
+    constexpr std::size_t kMaxProbes = 64;
+    // Log-linear (HDR-style) buckets: 8 linear sub-buckets per power of two, ~12.5% precision
+    constexpr std::size_t kBuckets = 512;
+
+    struct ProbeSummary {
+        std::string name;
+        std::uint64_t count = 0;
+        std::uint64_t totalNs = 0;
+        std::uint64_t maxNs = 0;
+        std::uint64_t p50Ns = 0;
+        std::uint64_t p90Ns = 0;
+        std::uint64_t p99Ns = 0;
+    };
+
+    // Returns a stable id for the probe name (same name -> same id), or -1 when full
+    int RegisterProbe(const char* name);
+    // Lock-free on the hot path: each thread writes only its own histogram block
+    void Record(int probe, std::uint64_t ns);
+    // Merges every thread's histograms; probes never hit are omitted
+    std::vector<ProbeSummary> Snapshot();
+    // Histogram blocks allocated so far (about 264 KB each): one per thread recording at the
+    // same time, reused after a thread exits
+    std::size_t ThreadBlocks();
+    std::string ToJson();
+    bool WriteJson(const std::string& path);
+    // Writes the JSON dump to %APPGATE_STATS_FILE% or appgate-stats.json (no-op when disabled)
+    void DumpOnExit();
+
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(int probe) : probe(probe), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            Record(probe, (std::uint64_t)ns);
+        }
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+    private:
+        int probe;
+        std::chrono::steady_clock::time_point start;
+    };
+}
+
+// APPGATE_PROBE(name): time the rest of the enclosing scope.
+// APPGATE_TIMED(name, expr): time a single expression and yield its value.
+// Both expand to nothing (or to the bare expression) unless APPGATE_INSTRUMENTATION is defined.
+#ifdef APPGATE_INSTRUMENTATION
+#define APPGATE_CONCAT_INNER(a, b) a##b
+#define APPGATE_CONCAT(a, b) APPGATE_CONCAT_INNER(a, b)
+#define APPGATE_PROBE(name) \
+    static const int APPGATE_CONCAT(appgateProbe_, __LINE__) = Instrumentation::RegisterProbe(name); \
+    Instrumentation::ScopedTimer APPGATE_CONCAT(appgateTimer_, __LINE__)(APPGATE_CONCAT(appgateProbe_, __LINE__))
+#define APPGATE_TIMED(name, ...) ([&]() { APPGATE_PROBE(name); return __VA_ARGS__; }())
+#else
+#define APPGATE_PROBE(name) ((void)0)
+#define APPGATE_TIMED(name, ...) (__VA_ARGS__)
+#endif
@@ -0,0 +1,151 @@
+// LnkParser.cpp
+// Walks header, IDList, LinkInfo, StringData and ExtraData with every offset checked
+#include "LnkParser.h"
+#include <cstring>
+
+namespace {
+    const std::uint32_t kHeaderSize = 0x4C;
+    // {00021401-0000-0000-C000-000000000046} as stored on disk
+    const std::uint8_t kLinkClsid[16] = { 0x01, 0x14, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 };
+
+    enum LinkFlags : std::uint32_t {
+        HasLinkTargetIDList = 0x1,
+        HasLinkInfo = 0x2,
+        HasName = 0x4,
+        HasRelativePath = 0x8,
+        HasWorkingDir = 0x10,
+        HasArguments = 0x20,
+        HasIconLocation = 0x40,
+        IsUnicode = 0x80,
+        HasDarwinID = 0x1000,
+    };
+    const std::uint32_t kVolumeIdAndLocalBasePath = 0x1;
+    const std::uint32_t kCommonNetworkRelativeLink = 0x2;
+    const std::uint32_t kEnvironmentBlock = 0xA0000001;
+    const std::uint32_t kDarwinBlock = 0xA0000006;
+
+    struct Reader {
+        const std::uint8_t* data;
+        std::size_t size;
+        bool U16(std::size_t off, std::uint32_t& v) const {
+            if (off > size || size - off < 2) return false;
+            v = (std::uint32_t)data[off] | ((std::uint32_t)data[off + 1] << 8);
+            return true;
+        }
+        bool U32(std::size_t off, std::uint32_t& v) const {
+            if (off > size || size - off < 4) return false;
+            v = (std::uint32_t)data[off] | ((std::uint32_t)data[off + 1] << 8) | ((std::uint32_t)data[off + 2] << 16) | ((std::uint32_t)data[off + 3] << 24);
+            return true;
+        }
+        // NUL-terminated string at off that must end before `end`
+        bool CString(std::size_t off, std::size_t end, bool unicode, LnkText& out) const {
+            if (end > size) end = size;
+            const std::size_t unit = unicode ? 2 : 1;
+            for (std::size_t p = off; p < end && end - p >= unit; p += unit) {
+                if (data[p] == 0 && (!unicode || data[p + 1] == 0)) {
+                    out.data = data + off;
+                    out.length = (std::uint32_t)((p - off) / unit);
+                    out.unicode = unicode;
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    void ParseLinkInfo(const Reader& r, std::size_t pos, std::size_t end, ShellLink& out) {
+        std::uint32_t headerSize = 0, flags = 0, localBase = 0, networkLink = 0, suffix = 0;
+        if (!r.U32(pos + 4, headerSize) || !r.U32(pos + 8, flags) || !r.U32(pos + 16, localBase)
+            || !r.U32(pos + 20, networkLink) || !r.U32(pos + 24, suffix)) return;
+        std::uint32_t localBaseUnicode = 0, suffixUnicode = 0;
+        if (headerSize >= 0x24) { r.U32(pos + 28, localBaseUnicode); r.U32(pos + 32, suffixUnicode); }
+
+        if ((flags & kVolumeIdAndLocalBasePath) && (localBaseUnicode || localBase)) {
+            if (localBaseUnicode) r.CString(pos + localBaseUnicode, end, true, out.basePath);
+            else r.CString(pos + localBase, end, false, out.basePath);
+        } else if ((flags & kCommonNetworkRelativeLink) && networkLink) {
+            const std::size_t link = pos + networkLink;
+            std::uint32_t linkSize = 0, netName = 0, netNameUnicode = 0;
+            if (r.U32(link, linkSize) && link + linkSize <= end && r.U32(link + 8, netName)) {
+                if (netName > 0x14) r.U32(link + 20, netNameUnicode);
+                if (netNameUnicode) r.CString(link + netNameUnicode, link + linkSize, true, out.basePath);
+                else if (netName) r.CString(link + netName, link + linkSize, false, out.basePath);
+                out.networkPath = !out.basePath.Empty();
+            }
+        }
+        if (suffixUnicode) r.CString(pos + suffixUnicode, end, true, out.pathSuffix);
+        else if (suffix) r.CString(pos + suffix, end, false, out.pathSuffix);
+    }
+}
+
+void LnkText::AppendTo(std::wstring& out) const {
+    out.reserve(out.size() + length);
+    for (std::uint32_t i = 0; i < length; ++i) {
+        out += unicode ? (wchar_t)(data[2 * i] | (data[2 * i + 1] << 8)) : (wchar_t)data[i];
+    }
+}
+
+std::wstring ShellLink::Target() const {
+    std::wstring target;
+    if (basePath.Empty()) { envTarget.AppendTo(target); return target; }
+    basePath.AppendTo(target);
+    if (!pathSuffix.Empty()) {
+        if (networkPath && target.back() != L'\\') target += L'\\';
+        pathSuffix.AppendTo(target);
+    }
+    return target;
+}
+
+bool ParseShellLink(const std::uint8_t* data, std::size_t size, ShellLink& out) {
+    out = ShellLink();
+    const Reader r{data, size};
+    std::uint32_t headerSize = 0;
+    if (!r.U32(0, headerSize) || headerSize != kHeaderSize || size < kHeaderSize) return false;
+    if (std::memcmp(data + 4, kLinkClsid, sizeof(kLinkClsid)) != 0) return false;
+    r.U32(20, out.flags);
+    out.advertised = (out.flags & HasDarwinID) != 0;
+    std::size_t pos = kHeaderSize;
+
+    if (out.flags & HasLinkTargetIDList) {
+        std::uint32_t idListSize = 0;
+        if (!r.U16(pos, idListSize) || idListSize > size - pos - 2) return false;
+        pos += 2 + idListSize; // shell item IDs are not needed: LinkInfo carries the path
+    }
+    if (out.flags & HasLinkInfo) {
+        std::uint32_t infoSize = 0;
+        if (!r.U32(pos, infoSize) || infoSize < 0x1C || infoSize > size - pos) return false;
+        ParseLinkInfo(r, pos, pos + infoSize, out);
+        pos += infoSize;
+    }
+
+    const bool unicode = (out.flags & IsUnicode) != 0;
+    const std::uint32_t stringFlags[] = { HasName, HasRelativePath, HasWorkingDir, HasArguments, HasIconLocation };
+    LnkText* strings[] = { &out.name, &out.relativePath, &out.workingDir, &out.arguments, &out.iconLocation };
+    for (std::size_t i = 0; i < 5; ++i) {
+        if (!(out.flags & stringFlags[i])) continue;
+        std::uint32_t count = 0;
+        if (!r.U16(pos, count)) return false;
+        const std::size_t bytes = (std::size_t)count * (unicode ? 2 : 1);
+        if (bytes > size - pos - 2) return false;
+        strings[i]->data = data + pos + 2;
+        strings[i]->length = count;
+        strings[i]->unicode = unicode;
+        pos += 2 + bytes;
+    }
+
+    // ExtraData: size-prefixed blocks until the terminal block (size < 4)
+    for (;;) {
+        std::uint32_t blockSize = 0, signature = 0;
+        if (!r.U32(pos, blockSize) || blockSize < 8 || blockSize > size - pos || !r.U32(pos + 4, signature)) break;
+        if (signature == kEnvironmentBlock && blockSize >= 0x314) {
+            // TargetAnsi[260] at +8, TargetUnicode[520 bytes] at +268
+            if (!r.CString(pos + 268, pos + 788, true, out.envTarget) || out.envTarget.Empty()) {
+                r.CString(pos + 8, pos + 268, false, out.envTarget);
+            }
+        } else if (signature == kDarwinBlock) {
+            out.advertised = true;
+        }
+        pos += blockSize;
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+// LnkParser.h
+// Bounds-checked MS-SHLLINK (.lnk) parser over an in-memory file image
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A string inside the parsed buffer; valid only as long as that buffer
+struct LnkText {
+    const std::uint8_t* data = nullptr;
+    std::uint32_t length = 0; // characters, without terminator
+    bool unicode = false;     // UTF-16LE when true, otherwise ANSI (widened byte by byte)
+    bool Empty() const { return length == 0; }
+    void AppendTo(std::wstring& out) const;
+    std::wstring ToWide() const { std::wstring w; AppendTo(w); return w; }
+};
+
+struct ShellLink {
+    std::uint32_t flags = 0;   // LinkFlags from the header
+    LnkText basePath;          // LinkInfo local base path, or network share name
+    LnkText pathSuffix;        // LinkInfo common path suffix
+    bool networkPath = false;  // basePath is a share; a separator goes before the suffix
+    LnkText envTarget;         // EnvironmentVariableDataBlock target, unexpanded
+    LnkText name;              // StringData
+    LnkText relativePath;
+    LnkText workingDir;
+    LnkText arguments;
+    LnkText iconLocation;
+    bool advertised = false;   // MSI (Darwin) shortcut: the real target is resolved by the installer
+
+    // LinkInfo path if present, otherwise the environment-variable target (still unexpanded)
+    std::wstring Target() const;
+};
+
+// Parses a whole .lnk image without allocating; the result points into data.
+// Returns false for anything that is not a well-formed shell link.
+bool ParseShellLink(const std::uint8_t* data, std::size_t size, ShellLink& out);
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <string_view>
 
 struct ProcessInfo {
     int pid = 0;
@@ -14,9 +15,35 @@ struct ProcessInfo {
     std::string remoteAddr;
 };
 
+// ProcessInfo whose strings live elsewhere, typically in ProcessManager's snapshot arena:
+// valid only until that producer takes its next snapshot
+struct ProcessInfoView {
+    int pid = 0;
+    std::string_view name;
+    std::string_view path;
+    std::string_view protocol;
+    std::string_view localAddr;
+    std::string_view remoteAddr;
+};
+
+// Raw connection-table row: addresses in network byte order (IPv4 in the first 4 bytes),
+// ports in host byte order
+struct ConnRow {
+    std::uint32_t pid = 0;
+    bool ipv6 = false;
+    std::uint8_t localAddr[16] = {};
+    std::uint8_t remoteAddr[16] = {};
+    std::uint16_t localPort = 0;
+    std::uint16_t remotePort = 0;
+    std::uint32_t state = 0; // MIB_TCP_STATE
+};
+
 struct RuleEntry {
     int serial = 0;
     std::string processName;
     std::string processPath;
     std::uint64_t filterId = 0; // WFP filter ID
+    bool outbound = true;       // ALE_AUTH_CONNECT (true) or ALE_AUTH_RECV_ACCEPT (false)
+    bool ipv6 = false;          // V6 layer variant
+    std::uint8_t protocol = 0;  // IPPROTO_TCP / IPPROTO_UDP
 };
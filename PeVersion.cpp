@@ -0,0 +1,232 @@
+// PeVersion.cpp
+// DOS/PE headers -> section table -> resource directory (type 16) -> VS_VERSIONINFO blocks
+#include "PeVersion.h"
+
+namespace {
+    const std::uint32_t kRtVersion = 16;
+    const std::uint32_t kResourceDirectoryIndex = 2;
+    const std::uint32_t kSubdirectoryBit = 0x80000000u;
+
+    struct Reader {
+        const std::uint8_t* data;
+        std::size_t size;
+        bool U16(std::size_t off, std::uint32_t& v) const {
+            if (off > size || size - off < 2) return false;
+            v = (std::uint32_t)data[off] | ((std::uint32_t)data[off + 1] << 8);
+            return true;
+        }
+        bool U32(std::size_t off, std::uint32_t& v) const {
+            if (off > size || size - off < 4) return false;
+            v = (std::uint32_t)data[off] | ((std::uint32_t)data[off + 1] << 8) | ((std::uint32_t)data[off + 2] << 16) | ((std::uint32_t)data[off + 3] << 24);
+            return true;
+        }
+        // NUL-terminated UTF-16 string at off that must end before `end`; returns the
+        // offset just past the terminator, or 0 if there is none
+        std::size_t Utf16(std::size_t off, std::size_t end, Utf16View& out) const {
+            if (end > size) end = size;
+            for (std::size_t p = off; p < end && end - p >= 2; p += 2) {
+                if (data[p] == 0 && data[p + 1] == 0) {
+                    out.data = data + off;
+                    out.length = (std::uint32_t)((p - off) / 2);
+                    return p + 2;
+                }
+            }
+            return 0;
+        }
+    };
+
+    struct Section { std::uint32_t va, virtualSize, rawSize, rawPtr; };
+
+    struct Image {
+        Reader r;
+        std::size_t optionalHeader = 0;
+        std::size_t sectionTable = 0;
+        std::uint32_t sectionCount = 0;
+        bool SectionAt(std::uint32_t i, Section& s) const {
+            const std::size_t off = sectionTable + (std::size_t)i * 40;
+            return r.U32(off + 8, s.virtualSize) && r.U32(off + 12, s.va) && r.U32(off + 16, s.rawSize) && r.U32(off + 20, s.rawPtr);
+        }
+        // File offset of an RVA whose bytes are physically present in a section
+        bool RvaToOffset(std::uint32_t rva, std::size_t& off) const {
+            for (std::uint32_t i = 0; i < sectionCount; ++i) {
+                Section s;
+                if (!SectionAt(i, s)) return false;
+                if (rva < s.va || rva - s.va >= s.rawSize) continue;
+                off = (std::size_t)s.rawPtr + (rva - s.va);
+                return off < r.size;
+            }
+            return false;
+        }
+    };
+
+    bool OpenImage(const Reader& r, Image& img) {
+        std::uint32_t mz = 0, peOffset = 0, signature = 0, sections = 0, optionalSize = 0;
+        if (!r.U16(0, mz) || mz != 0x5A4D || !r.U32(0x3C, peOffset)) return false;
+        if (!r.U32(peOffset, signature) || signature != 0x00004550) return false;
+        if (!r.U16((std::size_t)peOffset + 6, sections) || !r.U16((std::size_t)peOffset + 20, optionalSize)) return false;
+        img.r = r;
+        img.sectionCount = sections;
+        img.optionalHeader = (std::size_t)peOffset + 24;
+        img.sectionTable = img.optionalHeader + optionalSize;
+        return true;
+    }
+
+    // Resource directory entry to follow: type 16 at the top level, then the first entry
+    bool FindEntry(const Reader& r, std::size_t dir, bool matchId, std::uint32_t id, std::uint32_t& target) {
+        std::uint32_t named = 0, ids = 0;
+        if (!r.U16(dir + 12, named) || !r.U16(dir + 14, ids)) return false;
+        const std::uint32_t total = named + ids;
+        // Named entries come first; only ID entries can match a numeric type
+        for (std::uint32_t i = matchId ? named : 0; i < total; ++i) {
+            std::uint32_t name = 0;
+            if (!r.U32(dir + 16 + (std::size_t)i * 8, name) || !r.U32(dir + 20 + (std::size_t)i * 8, target)) return false;
+            if (!matchId || name == id) return true;
+        }
+        return false;
+    }
+
+    bool FindVersionResource(const Image& img, std::size_t& off, std::size_t& size) {
+        const Reader& r = img.r;
+        const std::size_t opt = img.optionalHeader;
+        std::uint32_t magic = 0;
+        if (!r.U16(opt, magic)) return false;
+        std::size_t dirs, countField;
+        if (magic == 0x10B) { countField = opt + 92; dirs = opt + 96; }
+        else if (magic == 0x20B) { countField = opt + 108; dirs = opt + 112; }
+        else return false;
+        std::uint32_t dirCount = 0, rsrcRva = 0, rsrcSize = 0;
+        if (!r.U32(countField, dirCount) || dirCount <= kResourceDirectoryIndex) return false;
+        if (!r.U32(dirs + kResourceDirectoryIndex * 8, rsrcRva) || !r.U32(dirs + kResourceDirectoryIndex * 8 + 4, rsrcSize) || !rsrcRva) return false;
+        std::size_t rsrc = 0;
+        if (!img.RvaToOffset(rsrcRva, rsrc)) return false;
+
+        // type -> name -> language -> data entry
+        std::uint32_t entry = 0;
+        if (!FindEntry(r, rsrc, true, kRtVersion, entry) || !(entry & kSubdirectoryBit)) return false;
+        if (!FindEntry(r, rsrc + (entry & ~kSubdirectoryBit), false, 0, entry) || !(entry & kSubdirectoryBit)) return false;
+        if (!FindEntry(r, rsrc + (entry & ~kSubdirectoryBit), false, 0, entry) || (entry & kSubdirectoryBit)) return false;
+        std::uint32_t dataRva = 0, dataSize = 0;
+        if (!r.U32(rsrc + entry, dataRva) || !r.U32(rsrc + entry + 4, dataSize)) return false;
+        if (!img.RvaToOffset(dataRva, off) || dataSize > r.size - off) return false;
+        size = dataSize;
+        return true;
+    }
+
+    // One VS_VERSIONINFO-style block: wLength, wValueLength, wType, szKey, Value, Children.
+    // Padding is to 32-bit boundaries relative to the start of the version resource.
+    struct Block {
+        std::size_t end = 0;
+        Utf16View key;
+        std::size_t value = 0;
+        std::uint32_t valueLength = 0;
+        std::uint32_t type = 0;
+        std::size_t children = 0;
+    };
+
+    std::size_t Align4(std::size_t base, std::size_t off) { return base + ((off - base + 3) & ~(std::size_t)3); }
+
+    bool ReadBlock(const Reader& r, std::size_t base, std::size_t off, std::size_t limit, Block& b) {
+        std::uint32_t length = 0;
+        if (!r.U16(off, length) || length < 6 || length > limit - off) return false;
+        b.end = off + length;
+        r.U16(off + 2, b.valueLength);
+        r.U16(off + 4, b.type);
+        std::size_t keyEnd = r.Utf16(off + 6, b.end, b.key);
+        if (!keyEnd) return false;
+        b.value = Align4(base, keyEnd);
+        const std::size_t valueBytes = (std::size_t)b.valueLength * (b.type == 1 ? 2 : 1); // text lengths are in WORDs
+        b.children = (b.value > b.end || valueBytes > b.end - b.value) ? b.end : Align4(base, b.value + valueBytes);
+        if (b.children > b.end) b.children = b.end;
+        return true;
+    }
+
+    bool KeyIs(const Utf16View& key, const char* ascii) {
+        std::uint32_t i = 0;
+        for (; ascii[i]; ++i) {
+            if (i >= key.length || key.data[2 * i] != (std::uint8_t)ascii[i] || key.data[2 * i + 1] != 0) return false;
+        }
+        return i == key.length;
+    }
+
+    // Calls fn(child) for each child block of parent; stops early when fn returns false
+    template <class Fn>
+    void ForEachChild(const Reader& r, std::size_t base, const Block& parent, Fn fn) {
+        for (std::size_t c = parent.children; c < parent.end && parent.end - c >= 6; ) {
+            Block child;
+            if (!ReadBlock(r, base, c, parent.end, child) || !fn(child)) return;
+            c = Align4(base, child.end);
+        }
+    }
+
+    // "040904b0" style table key for a Translation DWORD (language in the low word)
+    bool TableMatches(const Utf16View& key, std::uint32_t translation) {
+        if (key.length != 8) return false;
+        const std::uint32_t want = ((translation & 0xFFFF) << 16) | (translation >> 16);
+        std::uint32_t got = 0;
+        for (std::uint32_t i = 0; i < 8; ++i) {
+            if (key.data[2 * i + 1]) return false;
+            char c = (char)key.data[2 * i];
+            std::uint32_t digit;
+            if (c >= '0' && c <= '9') digit = (std::uint32_t)(c - '0');
+            else if (c >= 'a' && c <= 'f') digit = (std::uint32_t)(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') digit = (std::uint32_t)(c - 'A' + 10);
+            else return false;
+            got = (got << 4) | digit;
+        }
+        return got == want;
+    }
+}
+
+std::wstring Utf16View::ToWide() const {
+    std::wstring w;
+    w.reserve(length);
+    for (std::uint32_t i = 0; i < length; ++i) w += (wchar_t)(data[2 * i] | (data[2 * i + 1] << 8));
+    return w;
+}
+
+bool ReadPeVersionStrings(const std::uint8_t* data, std::size_t size, PeVersionStrings& out) {
+    out = PeVersionStrings();
+    const Reader r{data, size};
+    Image img{r};
+    std::size_t base = 0, length = 0;
+    if (!OpenImage(r, img) || !FindVersionResource(img, base, length)) return false;
+    Block root;
+    if (!ReadBlock(r, base, base, base + length, root) || !KeyIs(root.key, "VS_VERSION_INFO")) return false;
+
+    // Translation first, so the matching string table can be chosen
+    bool haveTranslation = false;
+    std::uint32_t translation = 0;
+    ForEachChild(r, base, root, [&](const Block& b) {
+        if (!KeyIs(b.key, "VarFileInfo")) return true;
+        ForEachChild(r, base, b, [&](const Block& var) {
+            if (KeyIs(var.key, "Translation") && var.valueLength >= 4) haveTranslation = r.U32(var.value, translation);
+            return !haveTranslation;
+        });
+        return !haveTranslation;
+    });
+
+    bool found = false;
+    ForEachChild(r, base, root, [&](const Block& b) {
+        if (!KeyIs(b.key, "StringFileInfo")) return true;
+        Block chosen;
+        bool haveTable = false;
+        ForEachChild(r, base, b, [&](const Block& table) {
+            if (!haveTable || (haveTranslation && TableMatches(table.key, translation))) { chosen = table; haveTable = true; }
+            return !(haveTranslation && TableMatches(table.key, translation));
+        });
+        if (!haveTable) return true;
+        ForEachChild(r, base, chosen, [&](const Block& s) {
+            Utf16View value;
+            // wValueLength is unreliable across resource compilers; use the terminator instead
+            if (s.value >= s.end || !r.Utf16(s.value, s.end, value)) return true;
+            if (KeyIs(s.key, "ProductName")) out.productName = value;
+            else if (KeyIs(s.key, "FileDescription")) out.fileDescription = value;
+            else if (KeyIs(s.key, "CompanyName")) out.companyName = value;
+            else if (KeyIs(s.key, "FileVersion")) out.fileVersion = value;
+            return true;
+        });
+        found = true;
+        return false;
+    });
+    return found;
+}
@@ -0,0 +1,26 @@
+// PeVersion.h
+// Bounds-checked reader for the RT_VERSION string table of a PE image held in memory
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// UTF-16LE string inside the parsed buffer; valid only as long as that buffer
+struct Utf16View {
+    const std::uint8_t* data = nullptr;
+    std::uint32_t length = 0; // UTF-16 code units, without terminator
+    bool Empty() const { return length == 0; }
+    std::wstring ToWide() const;
+};
+
+struct PeVersionStrings {
+    Utf16View productName;
+    Utf16View fileDescription;
+    Utf16View companyName;
+    Utf16View fileVersion;
+};
+
+// Goes from the section table straight to the RT_VERSION resource and reads the string
+// table matching the first Translation entry (or the first table). Nothing is copied or
+// allocated; every offset is checked against size. False when there is no version table.
+bool ReadPeVersionStrings(const std::uint8_t* data, std::size_t size, PeVersionStrings& out);
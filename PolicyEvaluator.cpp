@@ -0,0 +1,57 @@
+// PolicyEvaluator.cpp
+// Implements verdict lookups over the compiled rule tables
+#include "PolicyEvaluator.h"
+#include "Utils.h"
+
+static constexpr std::uint8_t kProtoTcp = 6;
+static constexpr std::uint8_t kProtoUdp = 17;
+
+int PolicyEvaluator::SlotBit(bool outbound, bool ipv6, std::uint8_t protocol) {
+    int proto;
+    if (protocol == kProtoTcp) proto = 0;
+    else if (protocol == kProtoUdp) proto = 1;
+    else return -1;
+    return (outbound ? 0 : 4) | (ipv6 ? 2 : 0) | proto;
+}
+
+void PolicyEvaluator::Compile(const std::vector<RuleEntry>& rules) {
+    masks.clear();
+    masks.reserve(rules.size() / 8 + 1); // typically one app per 8 filters
+    ruleCount = 0;
+    for (const auto& r : rules) {
+        int bit = SlotBit(r.outbound, r.ipv6, r.protocol);
+        if (bit < 0) continue;
+        masks[Utils::CanonicalPathKey(Utils::Utf8ToWide(r.processPath))] |= (std::uint8_t)(1u << bit);
+        ++ruleCount;
+    }
+}
+
+std::uint8_t PolicyEvaluator::BlockMask(const std::wstring& path) const {
+    auto it = masks.find(Utils::CanonicalPathKey(path));
+    return it == masks.end() ? 0 : it->second;
+}
+
+bool PolicyEvaluator::IsBlocked(const std::wstring& path, bool outbound, bool ipv6, std::uint8_t protocol) const {
+    int bit = SlotBit(outbound, ipv6, protocol);
+    if (bit < 0) return false;
+    return (BlockMask(path) >> bit) & 1u;
+}
+
+BlockCoverage PolicyEvaluator::Coverage(const std::wstring& path) const {
+    std::uint8_t m = BlockMask(path);
+    if (m == kFullMask) return BlockCoverage::Full;
+    return m ? BlockCoverage::Partial : BlockCoverage::None;
+}
+
+std::vector<AppVerdict> PolicyEvaluator::Audit(const std::vector<ApplicationInfo>& apps) const {
+    std::vector<AppVerdict> out;
+    out.reserve(apps.size());
+    for (const auto& a : apps) {
+        AppVerdict v;
+        v.app = &a;
+        v.mask = masks.empty() ? 0 : BlockMask(a.exePath);
+        v.coverage = (v.mask == kFullMask) ? BlockCoverage::Full : (v.mask ? BlockCoverage::Partial : BlockCoverage::None);
+        out.push_back(v);
+    }
+    return out;
+}
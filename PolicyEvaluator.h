@@ -0,0 +1,41 @@
+// PolicyEvaluator.h
+// Compiles the active rule set into hashed lookup tables for "what-if" verdict queries
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Models.h"
+#include "ApplicationInfo.h"
+
+enum class BlockCoverage { None, Partial, Full };
+
+struct AppVerdict {
+    const ApplicationInfo* app = nullptr;
+    BlockCoverage coverage = BlockCoverage::None;
+    std::uint8_t mask = 0; // one bit per (direction, IP version, protocol) slot
+};
+
+class PolicyEvaluator {
+public:
+    static constexpr std::uint8_t kFullMask = 0xFF;
+
+    // Rebuilds the tables; one hash entry per canonical app path, 8 slot bits per entry
+    void Compile(const std::vector<RuleEntry>& rules);
+    // O(1): one hash lookup plus a bit test. protocol is IPPROTO_TCP (6) or IPPROTO_UDP (17).
+    bool IsBlocked(const std::wstring& path, bool outbound, bool ipv6, std::uint8_t protocol) const;
+    std::uint8_t BlockMask(const std::wstring& path) const;
+    BlockCoverage Coverage(const std::wstring& path) const;
+    // Verdicts for a whole inventory; apps with no matching rule are reported as None
+    std::vector<AppVerdict> Audit(const std::vector<ApplicationInfo>& apps) const;
+
+    // Bit index for a slot, or -1 for protocols AppGate never filters
+    static int SlotBit(bool outbound, bool ipv6, std::uint8_t protocol);
+    std::size_t RuleCount() const { return ruleCount; }
+    std::size_t AppCount() const { return masks.size(); }
+
+private:
+    std::unordered_map<std::wstring, std::uint8_t> masks;
+    std::size_t ruleCount = 0;
+};
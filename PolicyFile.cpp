@@ -0,0 +1,69 @@
+// PolicyFile.cpp
+// Implements policy parsing and the sorted-merge diff
+#include "PolicyFile.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <utility>
+
+static std::string Trim(const std::string& s) {
+    std::size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return {};
+    std::size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+// A bare path has to look like one, so a mistyped verb ("blok C:\x") is an error instead
+// of a block rule for the path "blok C:\x"
+static bool LooksLikePath(const std::string& t) {
+    if (t[0] == '"' || t.compare(0, 2, "\\\\") == 0) return true;
+    return t.size() >= 2 && std::isalpha((unsigned char)t[0]) && t[1] == ':';
+}
+
+bool LoadPolicyFile(const std::string& file, PolicyDocument& out, std::string& error) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) { error = "cannot open " + file; return false; }
+    std::string line;
+    std::size_t lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        if (lineNo == 1 && line.compare(0, 3, "\xEF\xBB\xBF") == 0) line.erase(0, 3); // UTF-8 BOM
+        std::string t = Trim(line);
+        if (t.empty() || t[0] == '#') continue;
+        std::size_t sp = t.find_first_of(" \t");
+        std::string verb = t.substr(0, sp);
+        std::string arg = (sp == std::string::npos) ? std::string() : Trim(t.substr(sp));
+        if (verb == "block" || verb == "prefix") {
+            if (arg.empty()) { error = file + ":" + std::to_string(lineNo) + ": missing path"; return false; }
+        } else if (LooksLikePath(t)) {
+            verb = "block"; arg = t; // bare path
+        } else {
+            error = file + ":" + std::to_string(lineNo) + ": unknown verb '" + verb + "'";
+            return false;
+        }
+        if (arg.size() > 1 && arg.front() == '"' && arg.back() == '"') arg = arg.substr(1, arg.size() - 2);
+        (verb == "prefix" ? out.prefixes : out.paths).push_back(Utils::Utf8ToWide(arg));
+    }
+    return true;
+}
+
+PolicyDiff ComputePolicyDiff(const std::vector<std::wstring>& desired, const std::vector<std::wstring>& current) {
+    using Keyed = std::vector<std::pair<std::wstring, const std::wstring*>>;
+    auto keyed = [](const std::vector<std::wstring>& in) {
+        Keyed k; k.reserve(in.size());
+        for (const auto& p : in) k.emplace_back(Utils::CanonicalPathKey(p), &p);
+        std::sort(k.begin(), k.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+        k.erase(std::unique(k.begin(), k.end(), [](const auto& a, const auto& b){ return a.first == b.first; }), k.end());
+        return k;
+    };
+    Keyed d = keyed(desired), c = keyed(current);
+    PolicyDiff diff;
+    std::size_t i = 0, j = 0;
+    while (i < d.size() || j < c.size()) {
+        if (j == c.size() || (i < d.size() && d[i].first < c[j].first)) { diff.addPaths.push_back(*d[i++].second); }
+        else if (i == d.size() || c[j].first < d[i].first) { diff.removePaths.push_back(*c[j++].second); }
+        else { ++diff.unchanged; ++i; ++j; }
+    }
+    return diff;
+}
@@ -0,0 +1,27 @@
+// PolicyFile.h
+// Declarative desired-state policy (blocked paths and prefixes) and its diff against the rule store
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One entry per line, UTF-8:
+//   # comment
+//   block C:\Tools\app.exe       (a bare path means the same if it starts with a drive
+//                                letter, \\ or a quote; any other first word must be a verb)
+//   prefix C:\Games\             (directory prefix or last-component glob, see PrefixRules.h)
+struct PolicyDocument {
+    std::vector<std::wstring> paths;
+    std::vector<std::wstring> prefixes;
+};
+
+struct PolicyDiff {
+    std::vector<std::wstring> addPaths;     // desired but not blocked yet
+    std::vector<std::wstring> removePaths;  // blocked but no longer desired
+    std::size_t unchanged = 0;
+};
+
+// Streams the file line by line; on failure error names the file or line
+bool LoadPolicyFile(const std::string& file, PolicyDocument& out, std::string& error);
+// Sorted merge on canonical path keys; duplicates on either side are collapsed
+PolicyDiff ComputePolicyDiff(const std::vector<std::wstring>& desired, const std::vector<std::wstring>& current);
@@ -0,0 +1,149 @@
+// PrefixRules.cpp
+// Implements the path trie and incremental expansion of prefix rules
+#include "PrefixRules.h"
+#include "Utils.h"
+#include <algorithm>
+#include <iterator>
+
+std::vector<std::wstring> PrefixRuleSet::SplitComponents(const std::wstring& canonical) {
+    std::vector<std::wstring> parts;
+    std::size_t start = 0;
+    while (start <= canonical.size()) {
+        std::size_t end = canonical.find(L'\\', start);
+        if (end == std::wstring::npos) end = canonical.size();
+        if (end > start) parts.emplace_back(canonical, start, end - start);
+        start = end + 1;
+    }
+    return parts;
+}
+
+bool PrefixRuleSet::GlobMatch(const wchar_t* pat, const wchar_t* str) {
+    const wchar_t* star = nullptr; const wchar_t* retry = nullptr;
+    while (*str) {
+        if (*pat == L'?' || *pat == *str) { ++pat; ++str; continue; }
+        if (*pat == L'*') { star = pat++; retry = str; continue; }
+        if (!star) return false;
+        pat = star + 1; str = ++retry;
+    }
+    while (*pat == L'*') ++pat;
+    return *pat == 0;
+}
+
+std::uint32_t PrefixRuleSet::NodeFor(const std::vector<std::wstring>& parts, std::size_t count, bool create) {
+    std::uint32_t cur = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        auto it = nodes[cur].children.find(parts[i]);
+        if (it != nodes[cur].children.end()) { cur = it->second; continue; }
+        if (!create) return UINT32_MAX;
+        std::uint32_t idx = (std::uint32_t)nodes.size();
+        nodes.emplace_back();
+        nodes[cur].children.emplace(parts[i], idx);
+        cur = idx;
+    }
+    return cur;
+}
+
+bool PrefixRuleSet::MatchesKey(const std::wstring& key) const {
+    auto parts = SplitComponents(key);
+    std::uint32_t cur = 0;
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        const Node& n = nodes[cur];
+        if (n.prefix) return true;
+        if (i + 1 == parts.size()) {
+            for (const auto& g : n.globs) if (GlobMatch(g.c_str(), parts[i].c_str())) return true;
+        }
+        auto it = n.children.find(parts[i]);
+        if (it == n.children.end()) return false;
+        cur = it->second;
+    }
+    return false; // the path is the rule directory itself, not something under it
+}
+
+bool PrefixRuleSet::Matches(const std::wstring& path) const {
+    return MatchesKey(Utils::CanonicalPathKey(path));
+}
+
+bool PrefixRuleSet::AddRule(const std::wstring& pattern) {
+    std::wstring key = Utils::CanonicalPathKey(pattern);
+    auto parts = SplitComponents(key);
+    if (parts.empty()) return false;
+    const std::wstring& last = parts.back();
+    bool isGlob = last.find_first_of(L"*?") != std::wstring::npos;
+    for (std::size_t i = 0; i + 1 < parts.size(); ++i) {
+        if (parts[i].find_first_of(L"*?") != std::wstring::npos) return false; // globs only in the last component
+    }
+    if (isGlob) {
+        if (parts.size() < 2) return false;
+        Node& n = nodes[NodeFor(parts, parts.size() - 1, true)];
+        if (std::find(n.globs.begin(), n.globs.end(), last) != n.globs.end()) return false;
+        n.globs.push_back(last);
+    } else {
+        Node& n = nodes[NodeFor(parts, parts.size(), true)];
+        if (n.prefix) return false;
+        n.prefix = true;
+    }
+    patterns.push_back(pattern);
+
+    // Only the new rule needs checking against paths seen so far
+    PrefixRuleSet single;
+    if (isGlob) { single.nodes[single.NodeFor(parts, parts.size() - 1, true)].globs.push_back(last); }
+    else { single.nodes[single.NodeFor(parts, parts.size(), true)].prefix = true; }
+    for (const auto& kv : seen) {
+        if (expanded.count(kv.first) || !single.MatchesKey(kv.first)) continue;
+        pending.emplace(kv.first, kv.second);
+    }
+    return true;
+}
+
+bool PrefixRuleSet::RemoveRule(const std::wstring& pattern, std::vector<std::wstring>& orphaned) {
+    std::wstring key = Utils::CanonicalPathKey(pattern);
+    auto it = std::find_if(patterns.begin(), patterns.end(), [&](const std::wstring& p){ return Utils::CanonicalPathKey(p) == key; });
+    if (it == patterns.end()) return false;
+    auto parts = SplitComponents(key);
+    const std::wstring& last = parts.back();
+    if (last.find_first_of(L"*?") != std::wstring::npos) {
+        Node& n = nodes[NodeFor(parts, parts.size() - 1, false)];
+        n.globs.erase(std::remove(n.globs.begin(), n.globs.end(), last), n.globs.end());
+    } else {
+        nodes[NodeFor(parts, parts.size(), false)].prefix = false;
+    }
+    patterns.erase(it);
+    for (auto p = pending.begin(); p != pending.end(); ) p = MatchesKey(p->first) ? std::next(p) : pending.erase(p);
+    for (auto e = expanded.begin(); e != expanded.end(); ) {
+        if (MatchesKey(*e)) { ++e; continue; }
+        orphaned.push_back(seen[*e]);
+        e = expanded.erase(e);
+    }
+    return true;
+}
+
+std::vector<std::wstring> PrefixRuleSet::ExpandNew(const std::vector<ApplicationInfo>& inventory) {
+    std::vector<std::wstring> out;
+    for (const auto& app : inventory) {
+        if (app.exePath.empty()) continue;
+        std::wstring key = Utils::CanonicalPathKey(app.exePath);
+        if (!seen.emplace(key, app.exePath).second) continue; // evaluated on an earlier refresh
+        if (!patterns.empty() && MatchesKey(key)) pending.emplace(std::move(key), app.exePath);
+    }
+    out.reserve(pending.size());
+    for (const auto& kv : pending) out.push_back(kv.second);
+    return out;
+}
+
+void PrefixRuleSet::MarkExpanded(const std::wstring& path) {
+    std::wstring key = Utils::CanonicalPathKey(path);
+    if (pending.erase(key)) expanded.insert(std::move(key));
+}
+
+bool PrefixRuleSet::Release(const std::wstring& path) {
+    std::wstring key = Utils::CanonicalPathKey(path);
+    pending.erase(key);
+    return expanded.erase(key) > 0;
+}
+
+void PrefixRuleSet::Clear() {
+    nodes.assign(1, Node());
+    patterns.clear();
+    pending.clear();
+    expanded.clear();
+}
@@ -0,0 +1,55 @@
+// PrefixRules.h
+// Directory-prefix and glob rules stored in a case-folded path trie
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "ApplicationInfo.h"
+
+// Patterns:
+//   C:\Games\          every executable anywhere under C:\Games
+//   C:\Games\*.exe     glob on the last component only (* and ? wildcards)
+// Matching walks one trie node per path component, so cost is O(path length)
+// regardless of how many rules exist.
+// Expansion is two-phase: matches are pending until the caller has actually blocked them
+// (MarkExpanded), so a failed block is offered again on the next ExpandNew instead of
+// being lost, and only paths whose filters a rule created are reported as orphaned.
+class PrefixRuleSet {
+public:
+    // Adds a rule (false if invalid or a duplicate); known executables it matches become pending
+    bool AddRule(const std::wstring& pattern);
+    // Removes a rule and returns expanded executables no longer covered by any rule
+    bool RemoveRule(const std::wstring& pattern, std::vector<std::wstring>& orphaned);
+    bool Matches(const std::wstring& path) const;
+    // Evaluates only inventory paths not seen before; returns every pending match, i.e. the
+    // new ones plus earlier ones that were never marked expanded
+    std::vector<std::wstring> ExpandNew(const std::vector<ApplicationInfo>& inventory);
+    // The path's filters now exist and belong to the prefix rules
+    void MarkExpanded(const std::wstring& path);
+    // The prefix rules stop tracking the path: it is (or was already) blocked explicitly, or
+    // was unblocked by hand. Returns true if the rules owned its filters.
+    bool Release(const std::wstring& path);
+    std::vector<std::wstring> Rules() const { return patterns; }
+    std::size_t RuleCount() const { return patterns.size(); }
+    void Clear();
+
+private:
+    struct Node {
+        std::unordered_map<std::wstring, std::uint32_t> children;
+        bool prefix = false;               // a directory-prefix rule ends here
+        std::vector<std::wstring> globs;   // last-component globs for direct children
+    };
+    static std::vector<std::wstring> SplitComponents(const std::wstring& canonical);
+    static bool GlobMatch(const wchar_t* pat, const wchar_t* str);
+    bool MatchesKey(const std::wstring& key) const;
+    std::uint32_t NodeFor(const std::vector<std::wstring>& parts, std::size_t count, bool create);
+
+    std::vector<Node> nodes{ Node() }; // node 0 is the root
+    std::vector<std::wstring> patterns;
+    std::unordered_map<std::wstring, std::wstring> seen;   // canonical key -> original path
+    std::unordered_map<std::wstring, std::wstring> pending; // matched, not yet blocked
+    std::unordered_set<std::wstring> expanded;             // canonical keys blocked by a rule
+};
@@ -9,16 +9,18 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cstring>
 #include <unordered_set>
 #include <unordered_map>
+#include <memory_resource>
+#include <string_view>
 #include <shlwapi.h>
 #include <shlobj.h>
-#include <shobjidl.h>
-#include <objbase.h>
 #include <winreg.h>
 #include "Models.h"
 #include "Utils.h"
 #include "ProcessManager.h"
+#include "Instrumentation.h"
 #pragma comment(lib, "iphlpapi.lib")
 #pragma comment(lib, "psapi.lib")
 #pragma comment(lib, "Shlwapi.lib")
@@ -63,143 +65,292 @@ static std::wstring NormalizePath(const std::wstring& in) {
     return src;
 }
 
-// Resolve .lnk shortcut target path using raw COM pointers
-static std::wstring ResolveShortcut(const std::wstring& lnkPath) {
-    std::wstring result;
-    IShellLinkW* psl = nullptr;
-    HRESULT hr = CoCreateInstance(CLSID_ShellLink, NULL, CLSCTX_INPROC_SERVER, IID_IShellLinkW, (void**)&psl);
-    if (FAILED(hr) || !psl) return result;
-    IPersistFile* ppf = nullptr;
-    hr = psl->QueryInterface(IID_IPersistFile, (void**)&ppf);
-    if (SUCCEEDED(hr) && ppf) {
-        if (SUCCEEDED(ppf->Load(lnkPath.c_str(), STGM_READ))) {
-            wchar_t target[MAX_PATH] = {}; WIN32_FIND_DATAW wfd{};
-            if (SUCCEEDED(psl->GetPath(target, _countof(target), &wfd, SLGP_UNCPRIORITY))) {
-                result = target;
+// Helper to get a process image path into a caller buffer; returns its length, 0 on failure
+static DWORD GetProcessImagePath(DWORD pid, char* buffer, DWORD size) {
+    HANDLE hProcess = APPGATE_TIMED("OpenProcess", OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid));
+    if (!hProcess) return 0;
+    DWORD len = APPGATE_TIMED("GetModuleFileNameExA", GetModuleFileNameExA(hProcess, NULL, buffer, size));
+    CloseHandle(hProcess);
+    return len;
+}
+
+static std::string_view FileNamePart(std::string_view path) {
+    size_t pos = path.find_last_of("\\/");
+    return (pos != std::string_view::npos) ? path.substr(pos + 1) : path;
+}
+
+ProcessManager::ProcessManager() {
+    pidCache.emplace(&arena);
+    views.emplace(&arena);
+}
+
+static std::string FormatEndpoint(const std::uint8_t* addr, std::uint16_t port, bool ipv6) {
+    char buffer[Utils::kEndpointChars];
+    return std::string(buffer, Utils::FormatEndpoint(addr, port, ipv6, buffer));
+}
+
+// Resolves name/path once per PID per snapshot; failed lookups are cached as pid 0
+const ProcessManager::CachedProcess* ProcessManager::ResolvePid(std::uint32_t pid) {
+    auto inserted = pidCache->try_emplace(pid);
+    CachedProcess& proc = inserted.first->second;
+    if (inserted.second) {
+        if (connectionSource) {
+            std::string_view path = connectionSource->ImagePath(pid);
+            if (!path.empty()) {
+                proc.pid = (int)pid;
+                proc.path.assign(path);
+                proc.name.assign(FileNamePart(proc.path));
             }
+            return proc.pid ? &proc : nullptr;
+        }
+        char buffer[MAX_PATH] = {0};
+        DWORD len = GetProcessImagePath(pid, buffer, MAX_PATH);
+        if (len) {
+            proc.pid = (int)pid;
+            proc.path.assign(buffer, len);
+            proc.name.assign(FileNamePart(proc.path));
         }
-        ppf->Release();
     }
-    psl->Release();
-    return result;
+    return proc.pid ? &proc : nullptr;
 }
 
-// Helper to get process name and path
-static bool GetProcessNameAndPath(DWORD pid, std::string& name, std::string& path) {
-    HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
-    if (!hProcess) return false;
-    char buffer[MAX_PATH] = {0};
-    if (GetModuleFileNameExA(hProcess, NULL, buffer, MAX_PATH)) {
-        path = buffer;
-        size_t pos = path.find_last_of("\\/");
-        name = (pos != std::string::npos) ? path.substr(pos+1) : path;
-        CloseHandle(hProcess);
-        return true;
+const std::vector<ConnRow>& ProcessManager::Snapshot(bool forceRefresh) {
+    auto now = std::chrono::steady_clock::now();
+    if (forceRefresh || !hasSnapshot || now - snapshotTime > snapshotMaxAge) {
+        std::vector<ConnRow> conns;
+        CaptureConnections(conns);
+        index.Build(std::move(conns));
+        // PIDs may have been recycled since the last snapshot. The cache and the views
+        // live in the arena, so they are destroyed first and the whole snapshot is
+        // released at once.
+        views.reset();
+        pidCache.reset();
+        arena.Reset();
+        pidCache.emplace(&arena);
+        views.emplace(&arena);
+        snapshotTime = now;
+        hasSnapshot = true;
+        if (recorder) RecordSnapshot();
     }
-    CloseHandle(hProcess);
-    return false;
+    return index.Rows();
 }
 
-ProcessManager::ProcessManager() {}
+// Resolves every PID of the fresh snapshot (the results stay cached for the listing that
+// follows) and appends rows and paths to the trace
+void ProcessManager::RecordSnapshot() {
+    std::vector<TraceProcess> processes;
+    for (const auto& c : index.Rows()) {
+        const CachedProcess* proc = ResolvePid(c.pid);
+        // Repeated PIDs are harmless: the writer keys paths by PID
+        if (proc && (processes.empty() || processes.back().pid != c.pid)) processes.push_back({c.pid, proc->path});
+    }
+    const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (!recorder->Append((std::uint64_t)micros, index.Rows(), processes)) recorder = nullptr; // see Recording()
+}
 
-std::vector<ProcessInfo> ProcessManager::ListNetworkProcesses() {
-    std::vector<ProcessInfo> result;
+ProcessInfo ProcessManager::MakeInfo(const ConnRow& c, const CachedProcess& proc) {
+    ProcessInfo pi; pi.pid = proc.pid; pi.name.assign(proc.name); pi.path.assign(proc.path); pi.protocol = c.ipv6 ? "TCPv6" : "TCPv4";
+    pi.localAddr = FormatEndpoint(c.localAddr, c.localPort, c.ipv6);
+    pi.remoteAddr = FormatEndpoint(c.remoteAddr, c.remotePort, c.ipv6);
+    return pi;
+}
+
+bool ProcessManager::CaptureConnections(std::vector<ConnRow>& out) {
+    out.clear();
+    if (connectionSource) return connectionSource->Capture(out);
+    bool any = false;
 
     // IPv4 TCP
     PMIB_TCPTABLE_OWNER_PID pTcp4 = nullptr; DWORD sz4 = 0;
-    if (GetExtendedTcpTable(NULL, &sz4, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0) == ERROR_INSUFFICIENT_BUFFER) {
+    if (APPGATE_TIMED("GetExtendedTcpTable", GetExtendedTcpTable(NULL, &sz4, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0)) == ERROR_INSUFFICIENT_BUFFER) {
         pTcp4 = (PMIB_TCPTABLE_OWNER_PID)malloc(sz4);
-        if (pTcp4 && GetExtendedTcpTable(pTcp4, &sz4, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0) == NO_ERROR) {
+        if (pTcp4 && APPGATE_TIMED("GetExtendedTcpTable", GetExtendedTcpTable(pTcp4, &sz4, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0)) == NO_ERROR) {
+            out.reserve(pTcp4->dwNumEntries);
             for (DWORD i = 0; i < pTcp4->dwNumEntries; ++i) {
-                DWORD pid = pTcp4->table[i].dwOwningPid;
-                std::string name, path; if (!GetProcessNameAndPath(pid, name, path)) continue;
-                ProcessInfo pi; pi.pid = (int)pid; pi.name = name; pi.path = path; pi.protocol = "TCPv4";
-                pi.localAddr = Utils::SockaddrToString(pTcp4->table[i].dwLocalAddr, pTcp4->table[i].dwLocalPort);
-                pi.remoteAddr = Utils::SockaddrToString(pTcp4->table[i].dwRemoteAddr, pTcp4->table[i].dwRemotePort);
-                result.push_back(pi);
+                const auto& t = pTcp4->table[i];
+                ConnRow row;
+                row.pid = t.dwOwningPid;
+                memcpy(row.localAddr, &t.dwLocalAddr, 4);
+                memcpy(row.remoteAddr, &t.dwRemoteAddr, 4);
+                row.localPort = ntohs((u_short)t.dwLocalPort);
+                row.remotePort = ntohs((u_short)t.dwRemotePort);
+                row.state = t.dwState;
+                out.push_back(row);
             }
+            any = true;
         }
         if (pTcp4) free(pTcp4);
     }
 
     // IPv6 TCP
     PMIB_TCP6TABLE_OWNER_PID pTcp6 = nullptr; DWORD sz6 = 0;
-    if (GetExtendedTcpTable(NULL, &sz6, FALSE, AF_INET6, TCP_TABLE_OWNER_PID_ALL, 0) == ERROR_INSUFFICIENT_BUFFER) {
+    if (APPGATE_TIMED("GetExtendedTcpTable", GetExtendedTcpTable(NULL, &sz6, FALSE, AF_INET6, TCP_TABLE_OWNER_PID_ALL, 0)) == ERROR_INSUFFICIENT_BUFFER) {
         pTcp6 = (PMIB_TCP6TABLE_OWNER_PID)malloc(sz6);
-        if (pTcp6 && GetExtendedTcpTable(pTcp6, &sz6, FALSE, AF_INET6, TCP_TABLE_OWNER_PID_ALL, 0) == NO_ERROR) {
+        if (pTcp6 && APPGATE_TIMED("GetExtendedTcpTable", GetExtendedTcpTable(pTcp6, &sz6, FALSE, AF_INET6, TCP_TABLE_OWNER_PID_ALL, 0)) == NO_ERROR) {
+            out.reserve(out.size() + pTcp6->dwNumEntries);
             for (DWORD i = 0; i < pTcp6->dwNumEntries; ++i) {
-                DWORD pid = pTcp6->table[i].dwOwningPid;
-                std::string name, path; if (!GetProcessNameAndPath(pid, name, path)) continue;
-                ProcessInfo pi; pi.pid = (int)pid; pi.name = name; pi.path = path; pi.protocol = "TCPv6";
-                pi.localAddr = Utils::Sockaddr6ToString(pTcp6->table[i].ucLocalAddr, pTcp6->table[i].dwLocalPort);
-                pi.remoteAddr = Utils::Sockaddr6ToString(pTcp6->table[i].ucRemoteAddr, pTcp6->table[i].dwRemotePort);
-                result.push_back(pi);
+                const auto& t = pTcp6->table[i];
+                ConnRow row;
+                row.pid = t.dwOwningPid;
+                row.ipv6 = true;
+                memcpy(row.localAddr, t.ucLocalAddr, 16);
+                memcpy(row.remoteAddr, t.ucRemoteAddr, 16);
+                row.localPort = ntohs((u_short)t.dwLocalPort);
+                row.remotePort = ntohs((u_short)t.dwRemotePort);
+                row.state = t.dwState;
+                out.push_back(row);
             }
+            any = true;
         }
         if (pTcp6) free(pTcp6);
     }
+    return any;
+}
 
+std::vector<ProcessInfo> ProcessManager::ListNetworkProcesses() {
+    std::vector<ProcessInfo> result;
+    for (const auto& c : Snapshot(true)) {
+        const CachedProcess* proc = ResolvePid(c.pid);
+        if (!proc) continue;
+        result.push_back(MakeInfo(c, *proc));
+    }
+    return result;
+}
+
+const std::pmr::vector<ProcessInfoView>& ProcessManager::ListNetworkProcessViews() {
+    const auto& conns = Snapshot(true);
+    views->clear();
+    views->reserve(conns.size());
+    char buffer[Utils::kEndpointChars];
+    for (const auto& c : conns) {
+        const CachedProcess* proc = ResolvePid(c.pid);
+        if (!proc) continue;
+        ProcessInfoView v;
+        v.pid = proc->pid;
+        v.name = proc->name; // cache nodes never move, so the views stay put
+        v.path = proc->path;
+        v.protocol = c.ipv6 ? "TCPv6" : "TCPv4";
+        v.localAddr = arena.Copy({ buffer, Utils::FormatEndpoint(c.localAddr, c.localPort, c.ipv6, buffer) });
+        v.remoteAddr = arena.Copy({ buffer, Utils::FormatEndpoint(c.remoteAddr, c.remotePort, c.ipv6, buffer) });
+        views->push_back(v);
+    }
+    return *views;
+}
+
+std::vector<ProcessInfo> ProcessManager::QueryConnections(const ConnectionQuery& query) {
+    std::vector<ProcessInfo> result;
+    for (const auto& c : Snapshot(true)) {
+        // Cheap predicates first: rejected rows never pay for OpenProcess or formatting
+        if (!query.MatchesRow(c)) continue;
+        const CachedProcess* proc = ResolvePid(c.pid);
+        if (!proc) continue;
+        if (query.NeedsName() && !query.MatchesName(proc->name)) continue;
+        result.push_back(MakeInfo(c, *proc));
+    }
     return result;
 }
 
 ProcessInfo ProcessManager::GetProcessByPID(int pid) {
-    std::string name, path;
-    if (GetProcessNameAndPath((DWORD)pid, name, path)) {
+    char buffer[MAX_PATH] = {0};
+    DWORD len = GetProcessImagePath((DWORD)pid, buffer, MAX_PATH);
+    if (len) {
         ProcessInfo pi;
         pi.pid = pid;
-        pi.name = name;
-        pi.path = path;
+        pi.path.assign(buffer, len);
+        pi.name = std::string(FileNamePart(pi.path));
         return pi;
     }
     return ProcessInfo();
 }
 
+// Appends the distinct values of ports in numeric order
+static void AppendDistinctPorts(std::pmr::vector<std::uint16_t>& ports, std::vector<std::uint16_t>& out) {
+    std::sort(ports.begin(), ports.end());
+    ports.erase(std::unique(ports.begin(), ports.end()), ports.end());
+    out.assign(ports.begin(), ports.end());
+}
+
 std::vector<NetProcRow> ProcessManager::ListNetworkProcessesGrouped() {
-    std::unordered_map<int, NetProcRow> map;
+    const auto& conns = Snapshot(true);
+    // Scratch lives in the snapshot arena and is released with it on the next refresh
+    struct Hit { std::uint32_t pid; std::uint16_t localPort; std::uint16_t remotePort; bool ipv6; const CachedProcess* proc; };
+    std::pmr::vector<Hit> hits(&arena);
+    hits.reserve(conns.size());
+    for (const auto& c : conns) {
+        if (!c.pid) continue;
+        const CachedProcess* proc = ResolvePid(c.pid);
+        if (!proc) continue;
+        hits.push_back({c.pid, c.localPort, c.remotePort, c.ipv6, proc});
+    }
+    // Stable, so each PID's protocol is still taken from its first row
+    std::stable_sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b){ return a.pid < b.pid; });
 
-    // IPv4 TCP
-    PMIB_TCPTABLE_OWNER_PID pTcp4 = nullptr; DWORD sz4 = 0;
-    if (GetExtendedTcpTable(NULL, &sz4, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0) == ERROR_INSUFFICIENT_BUFFER) {
-        pTcp4 = (PMIB_TCPTABLE_OWNER_PID)malloc(sz4);
-        if (pTcp4 && GetExtendedTcpTable(pTcp4, &sz4, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0) == NO_ERROR) {
-            for (DWORD i = 0; i < pTcp4->dwNumEntries; ++i) {
-                DWORD pid = pTcp4->table[i].dwOwningPid; if (!pid) continue;
-                std::string name, path; if (!GetProcessNameAndPath(pid, name, path)) continue;
-                auto& row = map[(int)pid];
-                if (row.pid == 0) { row.pid = (int)pid; row.name = name; row.path = path; row.protocol = "TCPv4"; }
-                row.localPorts.push_back(std::to_string(ntohs((u_short)pTcp4->table[i].dwLocalPort)));
-                row.remotePorts.push_back(std::to_string(ntohs((u_short)pTcp4->table[i].dwRemotePort)));
-            }
+    std::vector<NetProcRow> rows;
+    std::pmr::vector<std::uint16_t> localPorts(&arena), remotePorts(&arena);
+    for (std::size_t i = 0, j; i < hits.size(); i = j) {
+        localPorts.clear();
+        remotePorts.clear();
+        for (j = i; j < hits.size() && hits[j].pid == hits[i].pid; ++j) {
+            localPorts.push_back(hits[j].localPort);
+            remotePorts.push_back(hits[j].remotePort);
         }
-        if (pTcp4) free(pTcp4);
+        NetProcRow row;
+        row.pid = (int)hits[i].pid;
+        row.name.assign(hits[i].proc->name);
+        row.path.assign(hits[i].proc->path);
+        row.protocol = hits[i].ipv6 ? "TCPv6" : "TCPv4";
+        AppendDistinctPorts(localPorts, row.localPorts);
+        AppendDistinctPorts(remotePorts, row.remotePorts);
+        rows.push_back(std::move(row));
     }
+    return rows;
+}
 
-    // IPv6 TCP
-    PMIB_TCP6TABLE_OWNER_PID pTcp6 = nullptr; DWORD sz6 = 0;
-    if (GetExtendedTcpTable(NULL, &sz6, FALSE, AF_INET6, TCP_TABLE_OWNER_PID_ALL, 0) == ERROR_INSUFFICIENT_BUFFER) {
-        pTcp6 = (PMIB_TCP6TABLE_OWNER_PID)malloc(sz6);
-        if (pTcp6 && GetExtendedTcpTable(pTcp6, &sz6, FALSE, AF_INET6, TCP_TABLE_OWNER_PID_ALL, 0) == NO_ERROR) {
-            for (DWORD i = 0; i < pTcp6->dwNumEntries; ++i) {
-                DWORD pid = pTcp6->table[i].dwOwningPid; if (!pid) continue;
-                std::string name, path; if (!GetProcessNameAndPath(pid, name, path)) continue;
-                auto& row = map[(int)pid];
-                if (row.pid == 0) { row.pid = (int)pid; row.name = name; row.path = path; row.protocol = "TCPv6"; }
-                row.localPorts.push_back(std::to_string(ntohs((u_short)pTcp6->table[i].dwLocalPort)));
-                row.remotePorts.push_back(std::to_string(ntohs((u_short)pTcp6->table[i].dwRemotePort)));
+std::vector<ProcessNode> ProcessManager::SnapshotProcesses() {
+    std::vector<ProcessNode> result;
+    HANDLE snap = APPGATE_TIMED("CreateToolhelp32Snapshot", CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0));
+    if (snap == INVALID_HANDLE_VALUE) return result;
+    PROCESSENTRY32W pe{}; pe.dwSize = sizeof(pe);
+    for (BOOL ok = Process32FirstW(snap, &pe); ok; ok = Process32NextW(snap, &pe)) {
+        ProcessNode node;
+        node.pid = (int)pe.th32ProcessID;
+        node.parentPid = (int)pe.th32ParentProcessID;
+        node.name = WToU8(pe.szExeFile);
+        // Limited access is enough for times and image path, and works for more processes
+        HANDLE h = APPGATE_TIMED("OpenProcess", OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pe.th32ProcessID));
+        if (h) {
+            FILETIME created{}, exited{}, kernel{}, user{};
+            if (GetProcessTimes(h, &created, &exited, &kernel, &user)) {
+                node.createTime = ((std::uint64_t)created.dwHighDateTime << 32) | created.dwLowDateTime;
             }
+            wchar_t path[MAX_PATH * 2] = L""; DWORD len = _countof(path);
+            if (APPGATE_TIMED("QueryFullProcessImageNameW", QueryFullProcessImageNameW(h, 0, path, &len))) node.path = WToU8(path);
+            CloseHandle(h);
         }
-        if (pTcp6) free(pTcp6);
+        result.push_back(std::move(node));
     }
+    CloseHandle(snap);
+    return result;
+}
 
-    std::vector<NetProcRow> rows;
-    rows.reserve(map.size());
-    for (auto& kv : map) {
-        auto& r = kv.second;
-        auto dedup = [](std::vector<std::string>& v){ std::sort(v.begin(), v.end()); v.erase(std::unique(v.begin(), v.end()), v.end()); };
-        dedup(r.localPorts);
-        dedup(r.remotePorts);
-        rows.push_back(r);
-    }
-    std::sort(rows.begin(), rows.end(), [](const NetProcRow& a, const NetProcRow& b){ return a.pid < b.pid; });
-    return rows;
+std::vector<ProcessInfo> ProcessManager::FindByLocalPort(std::uint16_t port) {
+    Snapshot(false);
+    std::vector<ProcessInfo> result;
+    for (const ConnRow* c : index.ByLocalPort(port)) {
+        const CachedProcess* proc = ResolvePid(c->pid);
+        if (proc) result.push_back(MakeInfo(*c, *proc));
+    }
+    return result;
+}
+
+std::vector<ProcessInfo> ProcessManager::FindByRemote(const std::string& host, std::uint16_t port) {
+    std::vector<ProcessInfo> result;
+    std::uint8_t addr[16]; bool ipv6 = false;
+    if (!ParseIpAddress(host, addr, ipv6)) return result;
+    Snapshot(false);
+    for (const ConnRow* c : index.ByRemote(addr, ipv6, port)) {
+        const CachedProcess* proc = ResolvePid(c->pid);
+        if (proc) result.push_back(MakeInfo(*c, *proc));
+    }
+    return result;
 }
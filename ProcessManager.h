@@ -1,24 +1,80 @@
 // ProcessManager.h
 // Enumerates processes and their network connections
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include "Models.h"
+#include "ProcessTree.h"
+#include "ConnectionQuery.h"
+#include "EndpointIndex.h"
+#include "SnapshotArena.h"
+#include "ConnectionTrace.h"
 
 struct NetProcRow {
     int pid;
     std::string name;
     std::string path;
     std::string protocol; // TCPv4/TCPv6
-    std::vector<std::string> localPorts; // as strings
-    std::vector<std::string> remotePorts; // as strings
+    std::vector<std::uint16_t> localPorts;  // distinct, ascending
+    std::vector<std::uint16_t> remotePorts; // distinct, ascending
 };
 
 class ProcessManager {
 public:
     ProcessManager();
     std::vector<ProcessInfo> ListNetworkProcesses(); // legacy flat listing
+    // The same rows without per-row heap strings: name/path point into the PID cache and
+    // endpoints are formatted into the snapshot arena. Valid until the next snapshot.
+    const std::pmr::vector<ProcessInfoView>& ListNetworkProcessViews();
     std::vector<NetProcRow> ListNetworkProcessesGrouped(); // grouped by PID with CSV ports
+    // Only rows passing the query's raw-row predicates are resolved and formatted
+    std::vector<ProcessInfo> QueryConnections(const ConnectionQuery& query);
+    // Raw IPv4 + IPv6 TCP table rows (or the connection source's); false if neither table could be read
+    bool CaptureConnections(std::vector<ConnRow>& out);
     ProcessInfo GetProcessByPID(int pid);
+    // O(1) reverse lookups served from the latest snapshot while it is younger than
+    // the staleness bound; an older snapshot is recaptured first
+    std::vector<ProcessInfo> FindByLocalPort(std::uint16_t port);
+    std::vector<ProcessInfo> FindByRemote(const std::string& host, std::uint16_t port);
+    void SetSnapshotMaxAge(std::chrono::milliseconds maxAge) { snapshotMaxAge = maxAge; }
+    // One Toolhelp snapshot of every process with parent PID, creation time and image path
+    std::vector<ProcessNode> SnapshotProcesses();
+    // Allocation counters of the per-snapshot arena (name/path cache, row views, scratch)
+    const ArenaStats& SnapshotArenaStats() const { return arena.Stats(); }
+    // Take connection snapshots and image paths from source instead of the live tables
+    // (nullptr goes back to live); the source must outlive its use here
+    void SetConnectionSource(ConnectionSource* source) { connectionSource = source; hasSnapshot = false; }
+    // Append every snapshot taken from now on to an open trace (nullptr stops recording)
+    void SetRecorder(ConnectionTraceWriter* writer) { recorder = writer; }
+    // False when no recorder is set, or once a trace write failed (recording stops there)
+    bool Recording() const { return recorder != nullptr; }
+private:
+    // Name/path of one PID, allocated from the snapshot arena
+    struct CachedProcess {
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+        explicit CachedProcess(const allocator_type& alloc = {}) : name(alloc), path(alloc) {}
+        int pid = 0; // 0 when the lookup failed
+        std::pmr::string name;
+        std::pmr::string path;
+    };
+    using PidCache = std::pmr::unordered_map<std::uint32_t, CachedProcess>;
+
+    const std::vector<ConnRow>& Snapshot(bool forceRefresh);
+    const CachedProcess* ResolvePid(std::uint32_t pid);
+    void RecordSnapshot();
+    static ProcessInfo MakeInfo(const ConnRow& c, const CachedProcess& proc);
+    EndpointIndex index; // rebuilt with every connection snapshot
+    SnapshotArena arena; // released and reused with every connection snapshot
+    std::optional<PidCache> pidCache; // lives in the arena; recreated after each Reset
+    std::optional<std::pmr::vector<ProcessInfoView>> views; // likewise
+    std::chrono::steady_clock::time_point snapshotTime;
+    std::chrono::milliseconds snapshotMaxAge{1000};
+    bool hasSnapshot = false;
+    ConnectionSource* connectionSource = nullptr;
+    ConnectionTraceWriter* recorder = nullptr;
 };
@@ -0,0 +1,55 @@
+// ProcessTree.cpp
+// Builds the adjacency lists and walks subtrees without revisiting nodes
+#include "ProcessTree.h"
+#include <utility>
+
+void ProcessTree::Build(std::vector<ProcessNode> snapshot) {
+    nodes = std::move(snapshot);
+    indexByPid.clear();
+    indexByPid.reserve(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); ++i) indexByPid[nodes[i].pid] = i;
+    children.assign(nodes.size(), {});
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        const ProcessNode& child = nodes[i];
+        if (child.parentPid == child.pid) continue; // idle/system processes point at themselves
+        auto it = indexByPid.find(child.parentPid);
+        if (it == indexByPid.end()) continue;
+        const ProcessNode& parent = nodes[it->second];
+        // Recycled PID: the current owner of parentPid started after this child did
+        if (parent.createTime && child.createTime && parent.createTime > child.createTime) continue;
+        children[it->second].push_back(i);
+    }
+}
+
+const ProcessNode* ProcessTree::Find(int pid) const {
+    auto it = indexByPid.find(pid);
+    return it == indexByPid.end() ? nullptr : &nodes[it->second];
+}
+
+std::vector<const ProcessNode*> ProcessTree::Children(int pid) const {
+    std::vector<const ProcessNode*> out;
+    auto it = indexByPid.find(pid);
+    if (it == indexByPid.end()) return out;
+    for (std::size_t c : children[it->second]) out.push_back(&nodes[c]);
+    return out;
+}
+
+std::vector<const ProcessNode*> ProcessTree::Subtree(int pid) const {
+    std::vector<const ProcessNode*> out;
+    auto it = indexByPid.find(pid);
+    if (it == indexByPid.end()) return out;
+    // visited guards against cycles when creation times are unknown
+    std::vector<bool> visited(nodes.size(), false);
+    std::vector<std::size_t> queue{ it->second };
+    visited[it->second] = true;
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+        std::size_t cur = queue[head];
+        out.push_back(&nodes[cur]);
+        for (std::size_t c : children[cur]) {
+            if (visited[c]) continue;
+            visited[c] = true;
+            queue.push_back(c);
+        }
+    }
+    return out;
+}
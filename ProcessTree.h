@@ -0,0 +1,33 @@
+// ProcessTree.h
+// Parent/child index over one process snapshot
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ProcessNode {
+    int pid = 0;
+    int parentPid = 0;
+    std::uint64_t createTime = 0; // FILETIME ticks; 0 when the process could not be opened
+    std::string name;
+    std::string path;             // empty when the image path is not accessible
+};
+
+class ProcessTree {
+public:
+    // Parent links are only trusted when the parent was created before the child;
+    // a parent PID that has since been recycled by a newer process is treated as orphaned.
+    void Build(std::vector<ProcessNode> snapshot);
+    const ProcessNode* Find(int pid) const;
+    std::vector<const ProcessNode*> Children(int pid) const;
+    // The process itself followed by all descendants (breadth-first); empty if pid is unknown
+    std::vector<const ProcessNode*> Subtree(int pid) const;
+    std::size_t Size() const { return nodes.size(); }
+
+private:
+    std::vector<ProcessNode> nodes;
+    std::unordered_map<int, std::size_t> indexByPid;
+    std::vector<std::vector<std::size_t>> children; // adjacency list by node index
+};
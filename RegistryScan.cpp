@@ -0,0 +1,75 @@
+// RegistryScan.cpp
+// Per-root caches keyed by subkey name and last-write time, refreshed in parallel
+#include "RegistryScan.h"
+#include <thread>
+#include <utility>
+
+RegistryScan::RegistryScan(RegistryKeySource& source, Resolver resolve, ExeExists exists, DirWriteTime dirWriteTime)
+    : source(source), resolve(std::move(resolve)), exists(std::move(exists)), dirWriteTime(std::move(dirWriteTime)) {}
+
+void RegistryScan::Resolve(Entry& entry) {
+    // Stamped before resolving, so a file added in between is caught on the next refresh
+    entry.installDirWrite = entry.values.installLocation.empty() ? 0 : dirWriteTime(entry.values.installLocation);
+    entry.app = ApplicationInfo();
+    entry.resolved = resolve(entry.values, entry.app);
+}
+
+void RegistryScan::RefreshRoot(std::size_t root, RootCache& cache) {
+    cache.stats = RegistryScanStats();
+    std::vector<RegistrySubkey> subkeys;
+    if (!source.ListSubkeys(root, subkeys)) {
+        cache.stats.removed = cache.entries.size();
+        cache.entries.clear();
+        return;
+    }
+    std::unordered_map<std::wstring, Entry> next;
+    next.reserve(subkeys.size());
+    for (auto& sk : subkeys) {
+        auto it = cache.entries.find(sk.name);
+        if (it != cache.entries.end() && it->second.lastWrite && it->second.lastWrite == sk.lastWrite) {
+            Entry& cached = it->second;
+            // Same values, but the executable may have been removed since, or (for an
+            // entry that did not resolve) installed into its install directory
+            const bool stale = cached.resolved
+                ? !exists(cached.app.exePath)
+                : !cached.values.installLocation.empty() && dirWriteTime(cached.values.installLocation) != cached.installDirWrite;
+            if (stale) {
+                Resolve(cached);
+                ++cache.stats.reresolved;
+            }
+            next.emplace(std::move(sk.name), std::move(cached));
+            cache.entries.erase(it);
+            continue;
+        }
+        Entry entry;
+        if (source.ReadValues(root, sk.name, entry.values)) {
+            entry.lastWrite = sk.lastWrite;
+            Resolve(entry);
+        }
+        ++cache.stats.reread;
+        if (it != cache.entries.end()) cache.entries.erase(it);
+        next.emplace(std::move(sk.name), std::move(entry));
+    }
+    // Whatever was not carried over belongs to subkeys that no longer exist
+    cache.stats.subkeys = next.size();
+    cache.stats.removed = cache.entries.size();
+    cache.entries.swap(next);
+}
+
+void RegistryScan::Refresh(std::vector<ApplicationInfo>& out) {
+    const std::size_t n = source.RootCount();
+    if (roots.size() != n) roots.assign(n, RootCache());
+    std::vector<std::thread> workers;
+    for (std::size_t r = 1; r < n; ++r) workers.emplace_back([this, r] { RefreshRoot(r, roots[r]); });
+    if (n) RefreshRoot(0, roots[0]);
+    for (auto& w : workers) w.join();
+
+    stats = RegistryScanStats();
+    for (const auto& root : roots) {
+        stats.subkeys += root.stats.subkeys;
+        stats.reread += root.stats.reread;
+        stats.reresolved += root.stats.reresolved;
+        stats.removed += root.stats.removed;
+        for (const auto& kv : root.entries) if (kv.second.resolved) out.push_back(kv.second.app);
+    }
+}
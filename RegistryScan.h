@@ -0,0 +1,85 @@
+// RegistryScan.h
+// Incremental uninstall-key discovery: only subkeys whose last-write time changed are re-read,
+// and cached results are re-resolved when the executable they point at disappears or, for
+// entries that did not resolve, when their install directory changes
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ApplicationInfo.h"
+
+struct RegistrySubkey {
+    std::wstring name;
+    std::uint64_t lastWrite = 0; // FILETIME reported by the enumeration
+};
+
+// The values discovery looks at; absent values are left empty
+struct UninstallValues {
+    std::wstring displayName;
+    std::wstring displayIcon;
+    std::wstring installLocation;
+    std::wstring uninstallString;
+};
+
+// Key/value access behind discovery, so the incremental logic can run against a fixture
+// instead of the live registry. Refresh runs one thread per root, so every method (and
+// the resolver) is called concurrently for different roots.
+class RegistryKeySource {
+public:
+    virtual ~RegistryKeySource() = default;
+    virtual std::size_t RootCount() const = 0;
+    // Subkeys of one root with their last-write times; false if the root cannot be opened
+    virtual bool ListSubkeys(std::size_t root, std::vector<RegistrySubkey>& out) = 0;
+    virtual bool ReadValues(std::size_t root, const std::wstring& subkey, UninstallValues& out) = 0;
+};
+
+struct RegistryScanStats {
+    std::size_t subkeys = 0;    // seen in the last refresh
+    std::size_t reread = 0;     // new or changed subkeys that were opened
+    std::size_t reresolved = 0; // unchanged subkeys resolved again from their cached values
+    std::size_t removed = 0;    // cached subkeys that disappeared
+};
+
+class RegistryScan {
+public:
+    // Turns one entry's values into an application; false skips the entry
+    using Resolver = std::function<bool(const UninstallValues&, ApplicationInfo&)>;
+    using ExeExists = std::function<bool(const std::wstring& path)>;
+    // Last-write time of an InstallLocation value's directory; 0 if it does not exist
+    using DirWriteTime = std::function<std::uint64_t(const std::wstring& installLocation)>;
+    // The resolver looks at the filesystem, which the last-write time does not cover: a
+    // cached application is kept only while exists(exePath) holds, and an entry that did
+    // not resolve is retried from its cached values when its install directory appears or
+    // its last-write time moves (an installer adding files directly in it). An executable
+    // that appears elsewhere is found once the subkey itself changes.
+    RegistryScan(RegistryKeySource& source, Resolver resolve, ExeExists exists, DirWriteTime dirWriteTime);
+    // Refreshes every root (one thread per root) and appends all resolved applications
+    void Refresh(std::vector<ApplicationInfo>& out);
+    const RegistryScanStats& LastStats() const { return stats; }
+    void Clear() { roots.clear(); }
+
+private:
+    struct Entry {
+        std::uint64_t lastWrite = 0; // 0 forces a re-read (e.g. after a failed read)
+        bool resolved = false;
+        std::uint64_t installDirWrite = 0; // the install directory as of the last resolve
+        UninstallValues values; // kept to re-resolve without reopening the key
+        ApplicationInfo app;
+    };
+    struct RootCache {
+        std::unordered_map<std::wstring, Entry> entries; // subkey name -> resolved entry
+        RegistryScanStats stats;
+    };
+    void RefreshRoot(std::size_t root, RootCache& cache);
+    void Resolve(Entry& entry);
+
+    RegistryKeySource& source;
+    Resolver resolve;
+    ExeExists exists;
+    DirWriteTime dirWriteTime;
+    std::vector<RootCache> roots; // each root is only touched by its own thread
+    RegistryScanStats stats;
+};
@@ -0,0 +1,38 @@
+// SnapshotArena.cpp
+// Counts allocations on the way through to a monotonic resource over a reusable buffer
+#include "SnapshotArena.h"
+#include <algorithm>
+#include <cstring>
+
+SnapshotArena::SnapshotArena(std::size_t initialBytes) {
+    stats.capacity = std::max<std::size_t>(initialBytes, 1024);
+    buffer = std::make_unique<std::byte[]>(stats.capacity);
+    monotonic.emplace(buffer.get(), stats.capacity, std::pmr::new_delete_resource());
+}
+
+void SnapshotArena::Reset() {
+    monotonic.reset(); // returns any overflow blocks to the heap
+    if (stats.bytesInUse > stats.capacity) {
+        // Leave headroom for padding and the monotonic resource's growth slack
+        stats.capacity = stats.bytesInUse + stats.bytesInUse / 4;
+        buffer = std::make_unique<std::byte[]>(stats.capacity);
+    }
+    monotonic.emplace(buffer.get(), stats.capacity, std::pmr::new_delete_resource());
+    stats.bytesInUse = 0;
+    ++stats.resets;
+}
+
+void* SnapshotArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    ++stats.allocations;
+    if (stats.bytesInUse + bytes > stats.capacity) ++stats.heapAllocations;
+    stats.bytesInUse += bytes;
+    stats.highWaterBytes = std::max(stats.highWaterBytes, stats.bytesInUse);
+    return monotonic->allocate(bytes, alignment);
+}
+
+std::string_view SnapshotArena::Copy(std::string_view s) {
+    if (s.empty()) return {};
+    char* p = static_cast<char*>(allocate(s.size(), 1));
+    std::memcpy(p, s.data(), s.size());
+    return { p, s.size() };
+}
@@ -0,0 +1,42 @@
+// SnapshotArena.h
+// Monotonic memory resource for data that lives exactly as long as one snapshot
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string_view>
+
+struct ArenaStats {
+    std::uint64_t allocations = 0;        // pmr allocations served, all snapshots
+    std::uint64_t heapAllocations = 0;    // of those, ones made after the buffer ran out
+    std::uint64_t resets = 0;
+    std::size_t bytesInUse = 0;           // allocated since the last Reset
+    std::size_t highWaterBytes = 0;       // largest single snapshot
+    std::size_t capacity = 0;             // size of the retained buffer
+};
+
+// Individual deallocations are no-ops; Reset releases a whole snapshot in one step.
+// The buffer is kept across resets and grown to the high-water mark, so steady-state
+// refreshes are served without touching the heap.
+class SnapshotArena : public std::pmr::memory_resource {
+public:
+    explicit SnapshotArena(std::size_t initialBytes = 64 * 1024);
+    SnapshotArena(const SnapshotArena&) = delete;
+    SnapshotArena& operator=(const SnapshotArena&) = delete;
+    // Every container allocated from the arena must be destroyed before this is called
+    void Reset();
+    // Copies s into the arena; the view is valid until the next Reset
+    std::string_view Copy(std::string_view s);
+    const ArenaStats& Stats() const { return stats; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    std::unique_ptr<std::byte[]> buffer;
+    std::optional<std::pmr::monotonic_buffer_resource> monotonic;
+    ArenaStats stats;
+};
@@ -1,14 +1,32 @@
 // Utils.cpp
+#ifdef _WIN32
 // Always include winsock2.h before windows.h to avoid redefinition errors
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cwctype>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <cstdio>
+#include <cstring>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "Utils.h"
-#pragma comment(lib, "ws2_32.lib")
+#include "Instrumentation.h"
 
 namespace Utils {
+#ifdef _WIN32
     std::string GuidToString(const GUID& guid) {
         char buf[64];
         snprintf(buf, sizeof(buf),
@@ -53,4 +71,152 @@ namespace Utils {
         if (len > 0) WideCharToMultiByte(CP_UTF8, 0, w.c_str(), -1, s.data(), len, NULL, NULL);
         return s;
     }
+    std::wstring Utf8ToWide(const std::string& s) {
+        if (s.empty()) return {};
+        int len = MultiByteToWideChar(CP_UTF8, 0, s.c_str(), -1, NULL, 0);
+        std::wstring w; w.resize(len ? len - 1 : 0);
+        if (len > 0) MultiByteToWideChar(CP_UTF8, 0, s.c_str(), -1, w.data(), len);
+        return w;
+    }
+    std::wstring CanonicalPathKey(const std::wstring& path) {
+        std::wstring key = path;
+        for (auto& c : key) if (c == L'/') c = L'\\';
+        while (!key.empty() && (key.back() == L'\\' || key.back() == L' ')) key.pop_back();
+        if (!key.empty()) CharLowerBuffW(&key[0], (DWORD)key.size());
+        return key;
+    }
+#else
+    // Portable builds (tests/): UTF-8 <-> UTF-32 wchar_t; invalid sequences become U+FFFD
+    std::string WideToUtf8(const std::wstring& w) {
+        std::string s;
+        s.reserve(w.size());
+        for (wchar_t wc : w) {
+            auto c = (std::uint32_t)wc;
+            if (c > 0x10FFFF || (c >= 0xD800 && c < 0xE000)) c = 0xFFFD;
+            if (c < 0x80) { s += (char)c; continue; }
+            if (c < 0x800) { s += (char)(0xC0 | (c >> 6)); }
+            else if (c < 0x10000) { s += (char)(0xE0 | (c >> 12)); s += (char)(0x80 | ((c >> 6) & 0x3F)); }
+            else { s += (char)(0xF0 | (c >> 18)); s += (char)(0x80 | ((c >> 12) & 0x3F)); s += (char)(0x80 | ((c >> 6) & 0x3F)); }
+            s += (char)(0x80 | (c & 0x3F));
+        }
+        return s;
+    }
+    std::wstring Utf8ToWide(const std::string& s) {
+        std::wstring w;
+        w.reserve(s.size());
+        for (std::size_t i = 0; i < s.size(); ) {
+            const auto b = (unsigned char)s[i];
+            const std::size_t n = b < 0x80 ? 1 : (b >> 5) == 6 ? 2 : (b >> 4) == 14 ? 3 : (b >> 3) == 30 ? 4 : 0;
+            std::uint32_t c = n == 1 ? b : n == 2 ? (b & 0x1F) : n == 3 ? (b & 0x0F) : (b & 0x07);
+            std::size_t k = 1;
+            for (; n && k < n && i + k < s.size() && ((unsigned char)s[i + k] >> 6) == 2; ++k) c = (c << 6) | ((unsigned char)s[i + k] & 0x3F);
+            if (!n || k < n) { w += (wchar_t)0xFFFD; i += k; continue; }
+            w += (wchar_t)c;
+            i += n;
+        }
+        return w;
+    }
+    std::wstring CanonicalPathKey(const std::wstring& path) {
+        std::wstring key = path;
+        for (auto& c : key) if (c == L'/') c = L'\\';
+        while (!key.empty() && (key.back() == L'\\' || key.back() == L' ')) key.pop_back();
+        for (auto& c : key) c = (wchar_t)std::towlower(c);
+        return key;
+    }
+#endif
+    void ParallelFor(std::size_t count, unsigned threads, const std::function<void(std::size_t)>& fn) {
+        if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+        std::atomic<std::size_t> next{0};
+        auto worker = [&]() { for (std::size_t i; (i = next.fetch_add(1)) < count; ) fn(i); };
+        std::size_t n = std::min<std::size_t>(threads, count);
+        std::vector<std::thread> pool;
+        for (std::size_t t = 1; t < n; ++t) pool.emplace_back(worker);
+        worker(); // the calling thread takes a share too
+        for (auto& t : pool) t.join();
+    }
+    std::size_t FormatEndpoint(const std::uint8_t* addr, std::uint16_t port, bool ipv6, char* out) {
+        char ip[INET6_ADDRSTRLEN] = {};
+        inet_ntop(ipv6 ? AF_INET6 : AF_INET, addr, ip, sizeof(ip));
+        int n = std::snprintf(out, kEndpointChars, ipv6 ? "[%s]:%u" : "%s:%u", ip, (unsigned)port);
+        return n > 0 ? std::min<std::size_t>((std::size_t)n, kEndpointChars - 1) : 0;
+    }
+
+    const std::uint8_t* MappedFile::MapAll() {
+        if (!size || size > SIZE_MAX) return nullptr;
+        return Map(0, (std::size_t)size);
+    }
+#ifdef _WIN32
+    bool MappedFile::Open(const std::wstring& path, bool sequential) {
+        Close();
+        file = APPGATE_TIMED("CreateFileW", CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+            sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0, NULL));
+        if (file == INVALID_HANDLE_VALUE) return false;
+        BY_HANDLE_FILE_INFORMATION info{};
+        if (!GetFileInformationByHandle(file, &info)) { DWORD error = GetLastError(); Close(); SetLastError(error); return false; }
+        size = ((std::uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+        writeTime = ((std::uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+        return true;
+    }
+
+    const std::uint8_t* MappedFile::Map(std::uint64_t offset, std::size_t length) {
+        Unmap();
+        if (file == INVALID_HANDLE_VALUE || !length || offset > size || length > size - offset) return nullptr;
+        // Empty files cannot have a mapping object, so it is created on the first view
+        if (!mapping) mapping = APPGATE_TIMED("CreateFileMappingW", CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL));
+        if (!mapping) return nullptr;
+        view = APPGATE_TIMED("MapViewOfFile", MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(offset >> 32), (DWORD)offset, length));
+        viewLength = view ? length : 0;
+        return (const std::uint8_t*)view;
+    }
+
+    void MappedFile::Unmap() {
+        if (view) UnmapViewOfFile(view);
+        view = nullptr;
+        viewLength = 0;
+    }
+
+    void MappedFile::Close() {
+        Unmap();
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+        size = writeTime = 0;
+    }
+#else
+    bool MappedFile::Open(const std::wstring& path, bool sequential) {
+        Close();
+        fd = APPGATE_TIMED("open", ::open(WideToUtf8(path).c_str(), O_RDONLY | O_CLOEXEC));
+        if (fd < 0) return false;
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) { Close(); return false; }
+        size = (std::uint64_t)st.st_size;
+        writeTime = (std::uint64_t)st.st_mtim.tv_sec * 1000000000ull + (std::uint64_t)st.st_mtim.tv_nsec;
+        if (sequential) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        return true;
+    }
+
+    const std::uint8_t* MappedFile::Map(std::uint64_t offset, std::size_t length) {
+        Unmap();
+        if (fd < 0 || !length || offset > size || length > size - offset) return nullptr;
+        void* p = APPGATE_TIMED("mmap", mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, (off_t)offset));
+        if (p == MAP_FAILED) return nullptr;
+        view = p;
+        viewLength = length;
+        return (const std::uint8_t*)view;
+    }
+
+    void MappedFile::Unmap() {
+        if (view) munmap(view, viewLength);
+        view = nullptr;
+        viewLength = 0;
+    }
+
+    void MappedFile::Close() {
+        Unmap();
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        size = writeTime = 0;
+    }
+#endif
 }
@@ -1,20 +1,76 @@
 // Utils.h
 // Helper functions for GUID, error handling, formatting
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
+#ifdef _WIN32
 #ifndef NOMINMAX
 #define NOMINMAX
 #endif
 #include <windows.h>
 #include <guiddef.h>
+#endif
 
 namespace Utils {
+#ifdef _WIN32
     std::string GuidToString(const GUID& guid);
     GUID GetSublayerGuid();
     std::string SockaddrToString(DWORD ip, DWORD port);
     // Format IPv6 address (16-byte) and port
     std::string Sockaddr6ToString(const BYTE ip6[16], DWORD port);
     std::string GetLastErrorAsString();
+#endif
+    // The helpers below are portable, so the modules using them build in tests/ as well
     // UTF conversions
     std::string WideToUtf8(const std::wstring& w);
+    std::wstring Utf8ToWide(const std::string& s);
+    // Case-folded, backslash-separated path used as the identity key for rules and apps
+    std::wstring CanonicalPathKey(const std::wstring& path);
+    // Runs fn(0..count-1) on up to `threads` threads (0 = one per hardware thread);
+    // indices are handed out dynamically so uneven work items balance out
+    void ParallelFor(std::size_t count, unsigned threads, const std::function<void(std::size_t)>& fn);
+    // Writes "a.b.c.d:port" or "[v6]:port" into out (kEndpointChars bytes) and returns the
+    // length; addr in network byte order, port in host byte order, as in ConnRow
+    constexpr std::size_t kEndpointChars = 64;
+    std::size_t FormatEndpoint(const std::uint8_t* addr, std::uint16_t port, bool ipv6, char* out);
+
+    // Read-only memory mapping of a file; the view, mapping and handle are released on
+    // destruction. On Windows others may read or delete the file while it is open but not
+    // write to it, so it cannot be truncated under a view (which would fault on the mapped
+    // pages); POSIX has no such share mode.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile() { Close(); }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // sequential hints that the file is read front to back once. False if it cannot be
+        // opened (on Windows, GetLastError still holds the reason).
+        bool Open(const std::wstring& path, bool sequential = false);
+        void Close();
+        std::uint64_t Size() const { return size; }
+        // Last-write time: FILETIME on Windows, nanoseconds since the epoch elsewhere
+        std::uint64_t WriteTime() const { return writeTime; }
+        // Maps [offset, offset + length), replacing the previous view; offset must be a
+        // multiple of 64 KB. Null for an empty range or when mapping fails.
+        const std::uint8_t* Map(std::uint64_t offset, std::size_t length);
+        // The whole file in one view; null when empty or too large for the address space
+        const std::uint8_t* MapAll();
+
+    private:
+        void Unmap();
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = NULL;
+#else
+        int fd = -1;
+#endif
+        void* view = nullptr;
+        std::size_t viewLength = 0;
+        std::uint64_t size = 0;
+        std::uint64_t writeTime = 0;
+    };
 }
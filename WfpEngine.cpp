@@ -0,0 +1,96 @@
+// WfpEngine.cpp
+// FirewallEngine over the Windows Filtering Platform (fwpuclnt)
+#include "FirewallEngine.h"
+#include "Utils.h"
+#include "Instrumentation.h"
+#include <windows.h>
+#include <fwpmu.h>
+#pragma comment(lib, "fwpuclnt.lib")
+
+namespace {
+    class WfpEngine : public FirewallEngine {
+    public:
+        ~WfpEngine() override {
+            if (engineHandle) APPGATE_TIMED("FwpmEngineClose0", FwpmEngineClose0(engineHandle));
+        }
+
+        bool Open() override {
+            FWPM_SESSION0 session = {0};
+            session.displayData.name = const_cast<wchar_t*>(L"AppGate Session");
+            session.flags = FWPM_SESSION_FLAG_DYNAMIC;
+            if (APPGATE_TIMED("FwpmEngineOpen0", FwpmEngineOpen0(NULL, RPC_C_AUTHN_WINNT, NULL, &session, &engineHandle)) != ERROR_SUCCESS) {
+                engineHandle = nullptr;
+                return false;
+            }
+            return AddSublayer();
+        }
+
+        bool BeginTransaction() override {
+            return APPGATE_TIMED("FwpmTransactionBegin0", FwpmTransactionBegin0(engineHandle, 0)) == ERROR_SUCCESS;
+        }
+
+        bool CommitTransaction() override {
+            return APPGATE_TIMED("FwpmTransactionCommit0", FwpmTransactionCommit0(engineHandle)) == ERROR_SUCCESS;
+        }
+
+        void AbortTransaction() override {
+            APPGATE_TIMED("FwpmTransactionAbort0", FwpmTransactionAbort0(engineHandle));
+        }
+
+        bool AddBlockFilter(const std::wstring& path, const std::wstring& name, const FilterSlot& slot, std::uint64_t& filterId) override {
+            const GUID& layer = slot.outbound
+                ? (slot.ipv6 ? FWPM_LAYER_ALE_AUTH_CONNECT_V6 : FWPM_LAYER_ALE_AUTH_CONNECT_V4)
+                : (slot.ipv6 ? FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V6 : FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V4);
+            std::wstring ruleName = name + (slot.outbound ? L"-Outbound" : L"-Inbound");
+            FWPM_FILTER0 filter = {0};
+            filter.displayData.name = const_cast<wchar_t*>(ruleName.c_str());
+            filter.layerKey = layer;
+            filter.subLayerKey = Utils::GetSublayerGuid();
+            filter.weight.type = FWP_EMPTY;
+            filter.action.type = FWP_ACTION_BLOCK;
+            FWPM_FILTER_CONDITION0 conditions[2] = {};
+            filter.numFilterConditions = 2;
+            filter.filterCondition = conditions;
+            // AppID condition
+            FWP_BYTE_BLOB* appIdBlob = nullptr;
+            if (APPGATE_TIMED("FwpmGetAppIdFromFileName0", FwpmGetAppIdFromFileName0(path.c_str(), &appIdBlob)) != ERROR_SUCCESS) return false;
+            conditions[0].fieldKey = FWPM_CONDITION_ALE_APP_ID;
+            conditions[0].matchType = FWP_MATCH_EQUAL;
+            conditions[0].conditionValue.type = FWP_BYTE_BLOB_TYPE;
+            conditions[0].conditionValue.byteBlob = appIdBlob;
+            // Protocol condition
+            conditions[1].fieldKey = FWPM_CONDITION_IP_PROTOCOL;
+            conditions[1].matchType = FWP_MATCH_EQUAL;
+            conditions[1].conditionValue.type = FWP_UINT8;
+            conditions[1].conditionValue.uint8 = slot.protocol;
+            UINT64 id = 0;
+            DWORD status = APPGATE_TIMED("FwpmFilterAdd0", FwpmFilterAdd0(engineHandle, &filter, NULL, &id));
+            if (appIdBlob) CoTaskMemFree(appIdBlob);
+            if (status != ERROR_SUCCESS) return false;
+            filterId = id;
+            return true;
+        }
+
+        bool DeleteFilter(std::uint64_t filterId) override {
+            return APPGATE_TIMED("FwpmFilterDeleteById0", FwpmFilterDeleteById0(engineHandle, filterId)) == ERROR_SUCCESS;
+        }
+
+    private:
+        bool AddSublayer() {
+            FWPM_SUBLAYER0 sublayer = {0};
+            sublayer.subLayerKey = Utils::GetSublayerGuid();
+            sublayer.displayData.name = const_cast<wchar_t*>(L"AppGateSublayer");
+            sublayer.displayData.description = const_cast<wchar_t*>(L"Custom sublayer for AppGate");
+            sublayer.flags = 0;
+            sublayer.weight = 0x100;
+            DWORD status = APPGATE_TIMED("FwpmSubLayerAdd0", FwpmSubLayerAdd0(engineHandle, &sublayer, NULL));
+            return status == ERROR_SUCCESS || status == FWP_E_ALREADY_EXISTS;
+        }
+
+        HANDLE engineHandle = nullptr;
+    };
+}
+
+std::unique_ptr<FirewallEngine> CreateWfpEngine() {
+    return std::make_unique<WfpEngine>();
+}
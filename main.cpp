@@ -4,34 +4,80 @@
 #include <iomanip>
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <vector>
 #include <sstream>
+#include <chrono>
+#include <thread>
 #include "ProcessManager.h"
 #include "FirewallManager.h"
 #include "Models.h"
 #include "Utils.h"
 #include "InstalledAppsManager.h"
 #include "ApplicationInfo.h"
+#include "ConnectionStats.h"
+#include "Instrumentation.h"
+#include "PolicyEvaluator.h"
+#include "PolicyFile.h"
+#include "ConnectionQuery.h"
+#include "FirewallCommandQueue.h"
+#include "ContentIdentity.h"
+#include "ConnectionTrace.h"
+#include "AppSearchIndex.h"
 
 void PrintBanner();
 void PrintMenu();
+void PrintUsage();
+int RunCommand(int argc, char* argv[]);
 void ListProcesses(ProcessManager& pm);
-void ListInstalledApps(InstalledAppsManager& iam, FirewallManager& fm);
+void ListInstalledApps(InstalledAppsManager& iam, FirewallManager& fm, AppSearchIndex& index);
+std::vector<ApplicationInfo> RefreshInventory(InstalledAppsManager& iam, FirewallManager& fm, AppSearchIndex& index);
+bool SelectInstalledApp(FirewallManager& fm, AppSearchIndex& index, const std::vector<ApplicationInfo>& apps, std::string query);
 void BlockProcess(FirewallManager& fm, ProcessManager& pm);
 void UnblockProcess(FirewallManager& fm, ProcessManager& pm);
 void ShowRules(FirewallManager& fm);
 void DeleteRuleBySerial(FirewallManager& fm);
 void DeleteAllRules(FirewallManager& fm);
+void TopTalkers(ProcessManager& pm);
+void ShowTopTalkers(ProcessManager& pm, int seconds, std::size_t k);
+void PrintTopTalkers(const std::vector<ProcessChurnStats>& top);
+int RecordTrace(ProcessManager& pm, const std::string& file, int intervalMs, int seconds);
+int ReplayTrace(const std::string& file, double speed, std::size_t k);
+void ShowStats();
+void WhatIf(FirewallManager& fm, InstalledAppsManager& iam);
+void BlockPrefix(FirewallManager& fm, InstalledAppsManager& iam);
+void ApplyPolicy(FirewallManager& fm, InstalledAppsManager& iam);
+bool ApplyPolicyFile(FirewallManager& fm, InstalledAppsManager& iam, const std::string& file, bool dryRun);
+void BlockProcessTree(FirewallManager& fm, ProcessManager& pm);
+void QueryConnections(ProcessManager& pm);
+bool RunQuery(ProcessManager& pm, const std::string& text);
+void FindOwner(ProcessManager& pm);
+bool PrintOwners(ProcessManager& pm, std::vector<std::string> args);
+int ServeCommands(unsigned windowMs);
+void PrintQueueMetrics(const FirewallQueueMetrics& m);
+void FindCopies(FirewallManager& fm, InstalledAppsManager& iam, ContentIdentityCache& ids);
+bool PrintCopies(InstalledAppsManager& iam, ContentIdentityCache& ids, const std::wstring& path, std::vector<std::wstring>& copies);
+void VerifyBlockedContent(FirewallManager& fm, InstalledAppsManager& iam, ContentIdentityCache& ids);
 
-static std::string JoinCSV(const std::vector<std::string>& v) {
-    std::ostringstream oss; bool first=true; for (auto& s : v){ if(!first) oss<<","; oss<<s; first=false; } return oss.str();
+static std::string JoinCSV(const std::vector<std::uint16_t>& v) {
+    std::string out;
+    for (auto p : v) { if (!out.empty()) out += ','; out += std::to_string(p); }
+    return out;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (Instrumentation::kEnabled) std::atexit(Instrumentation::DumpOnExit);
+    if (argc > 1) return RunCommand(argc, argv);
     PrintBanner();
     ProcessManager processManager;
     InstalledAppsManager iam;
     FirewallManager firewallManager;
+    ContentIdentityCache identities;
+    AppSearchIndex appIndex;
+    // Baselines for option 17 are taken at block time, before the binary can be swapped.
+    // They are hashed in the background so a block never waits for the disk.
+    firewallManager.SetBlockedCallback([&identities](const std::vector<std::wstring>& paths) { identities.QueueBaselines(paths); });
     if (!firewallManager.Initialize()) {
         std::cout << "[!] Failed to initialize WFP engine. Run as Administrator.\n";
         return 1;
@@ -44,12 +90,22 @@ int main() {
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
         switch (choice) {
             case 1: ListProcesses(processManager); break;
-            case 2: ListInstalledApps(iam, firewallManager); break;
+            case 2: ListInstalledApps(iam, firewallManager, appIndex); break;
             case 3: BlockProcess(firewallManager, processManager); break;
             case 4: UnblockProcess(firewallManager, processManager); break;
             case 5: ShowRules(firewallManager); break;
             case 6: DeleteRuleBySerial(firewallManager); break;
             case 7: DeleteAllRules(firewallManager); break;
+            case 8: TopTalkers(processManager); break;
+            case 9: ShowStats(); break;
+            case 10: WhatIf(firewallManager, iam); break;
+            case 11: BlockPrefix(firewallManager, iam); break;
+            case 12: ApplyPolicy(firewallManager, iam); break;
+            case 13: BlockProcessTree(firewallManager, processManager); break;
+            case 14: QueryConnections(processManager); break;
+            case 15: FindOwner(processManager); break;
+            case 16: FindCopies(firewallManager, iam, identities); break;
+            case 17: VerifyBlockedContent(firewallManager, iam, identities); break;
             case 0: std::cout << "\nExiting...\n"; break;
             default: std::cout << "Invalid choice. Please try again.\n"; break;
         }
@@ -61,6 +117,123 @@ int main() {
     return 0;
 }
 
+// Batch CLI: AppGate.exe <command> [args...]; returns the process exit code
+int RunCommand(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    const std::string& cmd = args[0];
+    ProcessManager processManager;
+    if (cmd == "top") {
+        int seconds = 10, k = 10;
+        try {
+            if (args.size() > 1) seconds = std::stoi(args[1]);
+            if (args.size() > 2) k = std::stoi(args[2]);
+        } catch (...) { std::cout << "[!] Invalid number.\n"; return 1; }
+        ShowTopTalkers(processManager, seconds, (std::size_t)std::max(k, 1));
+        return 0;
+    }
+    if (cmd == "query") {
+        std::string text;
+        for (std::size_t i = 1; i < args.size(); ++i) text += (i > 1 ? " " : "") + args[i];
+        return RunQuery(processManager, text) ? 0 : 1;
+    }
+    if (cmd == "owner") {
+        return PrintOwners(processManager, std::vector<std::string>(args.begin() + 1, args.end())) ? 0 : 1;
+    }
+    if (cmd == "apply") {
+        if (args.size() < 2) { std::cout << "[!] Usage: apply <policy-file> [--dry-run]\n"; return 1; }
+        bool dryRun = args.size() > 2 && args[2] == "--dry-run";
+        InstalledAppsManager iam;
+        FirewallManager firewallManager;
+        if (!firewallManager.Initialize()) {
+            std::cout << "[!] Failed to initialize WFP engine. Run as Administrator.\n";
+            return 1;
+        }
+        if (!ApplyPolicyFile(firewallManager, iam, args[1], dryRun)) return 1;
+        if (!dryRun) {
+            // The WFP session is dynamic: filters live only as long as this process
+            std::cout << "[*] Rules are active until AppGate exits. Press Enter to exit...";
+            std::cin.get();
+        }
+        return 0;
+    }
+    if (cmd == "apps") {
+        std::string query;
+        for (std::size_t i = 1; i < args.size(); ++i) query += (i > 1 ? " " : "") + args[i];
+        InstalledAppsManager iam;
+        FirewallManager firewallManager;
+        AppSearchIndex index;
+        if (!firewallManager.Initialize()) {
+            std::cout << "[!] Failed to initialize WFP engine. Run as Administrator.\n";
+            return 1;
+        }
+        auto apps = RefreshInventory(iam, firewallManager, index);
+        if (apps.empty()) { std::cout << "[!] No installed applications found.\n"; return 1; }
+        if (SelectInstalledApp(firewallManager, index, apps, query)) {
+            std::cout << "[*] Rules are active until AppGate exits. Press Enter to exit...";
+            std::cin.get();
+        }
+        return 0;
+    }
+    if (cmd == "copies") {
+        if (args.size() < 2) { std::cout << "[!] Usage: copies <exe-path>\n"; return 1; }
+        InstalledAppsManager iam;
+        ContentIdentityCache identities;
+        std::vector<std::wstring> copies;
+        return PrintCopies(iam, identities, Utils::Utf8ToWide(args[1]), copies) ? 0 : 1;
+    }
+    if (cmd == "serve") {
+        int windowMs = 50;
+        try { if (args.size() > 1) windowMs = std::stoi(args[1]); } catch (...) { std::cout << "[!] Invalid number.\n"; return 1; }
+        return ServeCommands((unsigned)std::max(windowMs, 0));
+    }
+    if (cmd == "record") {
+        if (args.size() < 2) { std::cout << "[!] Usage: record <trace-file> [intervalMs] [seconds]\n"; return 1; }
+        int intervalMs = 1000, seconds = 60;
+        try {
+            if (args.size() > 2) intervalMs = std::stoi(args[2]);
+            if (args.size() > 3) seconds = std::stoi(args[3]);
+        } catch (...) { std::cout << "[!] Invalid number.\n"; return 1; }
+        return RecordTrace(processManager, args[1], std::max(intervalMs, 1), std::max(seconds, 0));
+    }
+    if (cmd == "replay") {
+        if (args.size() < 2) { std::cout << "[!] Usage: replay <trace-file> [speed] [k]\n"; return 1; }
+        double speed = 0; int k = 10;
+        try {
+            if (args.size() > 2) speed = std::stod(args[2]);
+            if (args.size() > 3) k = std::stoi(args[3]);
+        } catch (...) { std::cout << "[!] Invalid number.\n"; return 1; }
+        return ReplayTrace(args[1], std::max(speed, 0.0), (std::size_t)std::max(k, 1));
+    }
+    if (cmd == "stats") {
+        // stats [command args...]: run the command (if any), then print the latency table
+        int rc = 0;
+        if (argc > 2) rc = RunCommand(argc - 1, argv + 1);
+        ShowStats();
+        return rc;
+    }
+    if (cmd == "help" || cmd == "-h" || cmd == "--help") { PrintUsage(); return 0; }
+    std::cout << "[!] Unknown command: " << cmd << "\n";
+    PrintUsage();
+    return 1;
+}
+
+void PrintUsage() {
+    std::cout << "Usage: AppGate.exe [command] [args]\n";
+    std::cout << "  (no command)                  Interactive menu\n";
+    std::cout << "  top [seconds] [k]             Sample connections and show the top-k churning processes\n";
+    std::cout << "  query <terms...>              Filter connections, e.g. query remote=10.0.0.0/8 rport=443\n";
+    std::cout << "  owner <port> | <host> <port>  Who owns a local port, or holds a connection to host:port\n";
+    std::cout << "                                (--max-age <ms> first: reuse snapshots up to that age)\n";
+    std::cout << "  apply <policy> [--dry-run]    Apply a policy file (only the diff), keep rules until Enter\n";
+    std::cout << "  apps [filter...]              Search installed apps by name or path, then block/unblock one\n";
+    std::cout << "  copies <exe-path>             List inventory executables with the same content (SHA-256)\n";
+    std::cout << "  serve [windowMs]              Read block/unblock/delete-all lines from stdin, batch per window\n";
+    std::cout << "  record <trace> [ms] [secs]    Record connection snapshots to a compact binary trace\n";
+    std::cout << "  replay <trace> [speed] [k]    Replay a trace through the enumeration API (0 = full speed)\n";
+    std::cout << "  stats [command ...]           Run a command, then print OS call latency statistics\n";
+    std::cout << "  help                          Show this help\n";
+}
+
 void PrintBanner() {
     std::cout << "\n===================================================\n";
     std::cout << R"(  ___              _____       _       
@@ -90,6 +263,16 @@ void PrintMenu() {
     std::cout << "| 5. Show active rules                       |\n";
     std::cout << "| 6. Delete rule by serial number            |\n";
     std::cout << "| 7. Delete all rules created by this program|\n";
+    std::cout << "| 8. Connection statistics (top talkers)     |\n";
+    std::cout << "| 9. Show OS call latency statistics         |\n";
+    std::cout << "| 10. What-if verdict query / blocklist audit|\n";
+    std::cout << "| 11. Block/unblock directory prefix or glob |\n";
+    std::cout << "| 12. Apply policy file (diff-based)         |\n";
+    std::cout << "| 13. Block process tree (PID + descendants) |\n";
+    std::cout << "| 14. Query connections (ports/CIDR/name)    |\n";
+    std::cout << "| 15. Find owner of a port / remote endpoint |\n";
+    std::cout << "| 16. Find copies of a binary (by content)   |\n";
+    std::cout << "| 17. Verify blocked binaries' content       |\n";
     std::cout << "| 0. Exit                                    |\n";
     std::cout << "+--------------------------------------------+\n";
 }
@@ -98,12 +281,15 @@ void ListProcesses(ProcessManager& pm) {
     auto rows = pm.ListNetworkProcessesGrouped();
     if (rows.empty()) { std::cout << "[!] No network processes found.\n"; return; }
     std::size_t maxName=4, maxPath=4, maxProto=5, maxL=5, maxR=6;
+    std::vector<std::string> localCsv, remoteCsv; // joined once, used for width and output
     for (const auto& r : rows) {
+        localCsv.push_back(JoinCSV(r.localPorts));
+        remoteCsv.push_back(JoinCSV(r.remotePorts));
         maxName = std::max(maxName, r.name.size());
         maxPath = std::max(maxPath, r.path.size());
         maxProto= std::max(maxProto, r.protocol.size());
-        maxL = std::max(maxL, JoinCSV(r.localPorts).size());
-        maxR = std::max(maxR, JoinCSV(r.remotePorts).size());
+        maxL = std::max(maxL, localCsv.back().size());
+        maxR = std::max(maxR, remoteCsv.back().size());
     }
     std::cout << std::left
         << std::setw(7) << "PID"
@@ -113,25 +299,40 @@ void ListProcesses(ProcessManager& pm) {
         << std::setw((int)maxL+2) << "LocalPorts"
         << std::setw((int)maxR+2) << "RemotePorts" << "\n";
     std::cout << std::string(7+(int)maxName+2+(int)maxPath+2+(int)maxProto+2+(int)maxL+2+(int)maxR+2, '-') << "\n";
-    for (const auto& r : rows) {
+    APPGATE_PROBE("RenderProcessTable");
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        const auto& r = rows[i];
         std::cout << std::left
             << std::setw(7) << r.pid
             << std::setw((int)maxName+2) << r.name
             << std::setw((int)maxPath+2) << r.path
             << std::setw((int)maxProto+2) << r.protocol
-            << std::setw((int)maxL+2) << JoinCSV(r.localPorts)
-            << std::setw((int)maxR+2) << JoinCSV(r.remotePorts) << "\n";
+            << std::setw((int)maxL+2) << localCsv[i]
+            << std::setw((int)maxR+2) << remoteCsv[i] << "\n";
     }
 }
 
-void ListInstalledApps(InstalledAppsManager& iam, FirewallManager& fm) {
+// Enumerates the inventory and brings the search index up to date with it: the first
+// refresh builds the index, later ones only touch the entries that changed
+std::vector<ApplicationInfo> RefreshInventory(InstalledAppsManager& iam, FirewallManager& fm, AppSearchIndex& index) {
     auto apps = iam.EnumerateAll();
-    if (apps.empty()) { std::cout << "[!] No installed applications found.\n"; return; }
+    if (apps.empty()) return apps;
+    if (int n = fm.ExpandPrefixRules(apps)) std::cout << "[+] " << n << " new executable(s) blocked by prefix rules\n";
+    if (index.Size() == 0) {
+        APPGATE_TIMED("AppIndexBuild", index.Build(apps));
+    } else {
+        AppIndexUpdate update = APPGATE_TIMED("AppIndexUpdate", index.Update(apps));
+        if (update.added || update.removed) std::cout << "[*] Search index: +" << update.added << " / -" << update.removed << " application(s)\n";
+    }
+    return apps;
+}
+
+static void PrintAppTable(const std::vector<const ApplicationInfo*>& apps) {
     std::size_t maxName = 12, maxPath = 4, maxSrc = 8;
-    for (const auto& a : apps) {
-        maxName = std::max(maxName, a.name.size());
-        maxPath = std::max(maxPath, a.exePath.size());
-        maxSrc  = std::max(maxSrc, a.source.size());
+    for (const auto* a : apps) {
+        maxName = std::max(maxName, a->name.size());
+        maxPath = std::max(maxPath, a->exePath.size());
+        maxSrc  = std::max(maxSrc, a->source.size());
     }
     std::cout << std::left
         << std::setw(6) << "#"
@@ -141,26 +342,59 @@ void ListInstalledApps(InstalledAppsManager& iam, FirewallManager& fm) {
         << std::setw(8) << "UWP" << "\n";
     std::cout << std::string(6+(int)maxName+2+(int)maxPath+2+(int)maxSrc+2+8, '-') << "\n";
     int idx = 1;
-    for (const auto& a : apps) {
+    for (const auto* a : apps) {
+        APPGATE_PROBE("RenderAppRow");
         std::cout << std::left
             << std::setw(6) << idx
-            << std::setw((int)maxName+2) << Utils::WideToUtf8(a.name)
-            << std::setw((int)maxPath+2) << Utils::WideToUtf8(a.exePath)
-            << std::setw((int)maxSrc+2)  << Utils::WideToUtf8(a.source)
-            << std::setw(8) << (a.isUWP ? "Yes" : "No") << "\n";
+            << std::setw((int)maxName+2) << Utils::WideToUtf8(a->name)
+            << std::setw((int)maxPath+2) << Utils::WideToUtf8(a->exePath)
+            << std::setw((int)maxSrc+2)  << Utils::WideToUtf8(a->source)
+            << std::setw(8) << (a->isUWP ? "Yes" : "No") << "\n";
         ++idx;
     }
-    std::cout << "\nEnter number to block (or 'u' to unblock by number, Enter to skip): ";
-    std::string input; std::getline(std::cin, input);
-    if (input.empty()) return;
-    bool unblock = false;
-    if (input.size() > 1 && (input[0] == 'u' || input[0] == 'U')) { unblock = true; input = input.substr(1); }
-    try {
-        int sel = std::stoi(input);
-        if (sel < 1 || sel > (int)apps.size()) { std::cout << "[!] Invalid selection.\n"; return; }
-        const auto& app = apps[sel-1];
-        if (!unblock) fm.BlockProcessByPathW(app.exePath); else fm.UnblockProcessByPathW(app.exePath);
-    } catch (...) { std::cout << "[!] Invalid input.\n"; }
+}
+
+// Type-to-filter selection: text narrows the list to the best index matches, a number
+// blocks the listed app and 'u' + number unblocks it. Returns true if a rule changed.
+bool SelectInstalledApp(FirewallManager& fm, AppSearchIndex& index, const std::vector<ApplicationInfo>& apps, std::string query) {
+    const std::size_t kShown = 20;
+    std::vector<const ApplicationInfo*> shown;
+    for (;;) {
+        if (query.empty()) {
+            std::cout << "\nFilter by name or path ('*' lists all, Enter to skip): ";
+            std::getline(std::cin, query);
+            if (query.empty()) return false;
+        }
+        shown.clear();
+        if (query == "*") {
+            for (const auto& a : apps) shown.push_back(&a);
+        } else {
+            auto hits = APPGATE_TIMED("AppIndexSearch", index.Search(Utils::Utf8ToWide(query), kShown));
+            for (const auto& h : hits) shown.push_back(&index.App(h.id));
+        }
+        if (shown.empty()) std::cout << "[!] No application matches \"" << query << "\".\n";
+        else PrintAppTable(shown);
+
+        std::cout << "\nEnter number to block ('u' + number to unblock), new filter text, or Enter to skip: ";
+        std::string input; std::getline(std::cin, input);
+        if (input.empty()) return false;
+        bool unblock = false;
+        std::string digits = input;
+        if (digits.size() > 1 && (digits[0] == 'u' || digits[0] == 'U')) { unblock = true; digits = digits.substr(1); }
+        if (digits.find_first_not_of("0123456789") != std::string::npos) { query = input; continue; }
+        int sel = 0;
+        try { sel = std::stoi(digits); } catch (...) {}
+        if (sel < 1 || sel > (int)shown.size()) { std::cout << "[!] Invalid selection.\n"; return false; }
+        const auto& app = *shown[sel-1];
+        return !unblock ? fm.BlockProcessByPathW(app.exePath) : fm.UnblockProcessByPathW(app.exePath);
+    }
+}
+
+void ListInstalledApps(InstalledAppsManager& iam, FirewallManager& fm, AppSearchIndex& index) {
+    auto apps = RefreshInventory(iam, fm, index);
+    if (apps.empty()) { std::cout << "[!] No installed applications found.\n"; return; }
+    std::cout << "[+] " << apps.size() << " application(s) indexed.\n";
+    SelectInstalledApp(fm, index, apps, "");
 }
 
 void BlockProcess(FirewallManager& fm, ProcessManager& pm) {
@@ -219,6 +453,11 @@ void ShowRules(FirewallManager& fm) {
             << std::setw(18) << std::to_string(r.filterId) << "\n";
         ++idx;
     }
+    auto prefixes = fm.ListPrefixRules();
+    if (!prefixes.empty()) {
+        std::cout << "\nPrefix rules:\n";
+        for (const auto& p : prefixes) std::cout << "  " << Utils::WideToUtf8(p) << "\n";
+    }
 }
 
 void DeleteRuleBySerial(FirewallManager& fm) {
@@ -238,3 +477,445 @@ void DeleteRuleBySerial(FirewallManager& fm) {
 }
 
 void DeleteAllRules(FirewallManager& fm) { fm.DeleteAllRules(); }
+
+void TopTalkers(ProcessManager& pm) {
+    std::cout << "Sample for how many seconds [10]: ";
+    std::string input; std::getline(std::cin, input);
+    int seconds = 10;
+    if (!input.empty()) {
+        try { seconds = std::stoi(input); } catch (...) { std::cout << "[!] Invalid input.\n"; return; }
+    }
+    ShowTopTalkers(pm, seconds, 10);
+}
+
+void ShowTopTalkers(ProcessManager& pm, int seconds, std::size_t k) {
+    if (seconds < 1) seconds = 1;
+    ConnectionStats stats;
+    std::cout << "[*] Sampling connections for " << seconds << "s...\n";
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i <= seconds; ++i) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        stats.IngestViews(pm.ListNetworkProcessViews(), (std::uint64_t)ms);
+        if (i < seconds) std::this_thread::sleep_until(start + std::chrono::seconds(i + 1));
+    }
+    if (Instrumentation::kEnabled) {
+        const auto& arena = pm.SnapshotArenaStats();
+        std::cout << "[*] Snapshot arena: " << arena.allocations << " allocation(s), " << arena.heapAllocations
+            << " past the buffer, high water " << arena.highWaterBytes / 1024 << " KB over " << arena.resets << " snapshot(s)\n";
+    }
+    PrintTopTalkers(stats.TopK(k, ConnectionStats::SortKey::Churn));
+}
+
+void PrintTopTalkers(const std::vector<ProcessChurnStats>& top) {
+    if (top.empty()) { std::cout << "[!] No network processes found.\n"; return; }
+    std::size_t maxName = 4;
+    for (const auto& t : top) maxName = std::max(maxName, t.name.size());
+    std::cout << std::left
+        << std::setw(7) << "PID"
+        << std::setw((int)maxName+2) << "Name"
+        << std::setw(8) << "Opens"
+        << std::setw(8) << "Closes"
+        << std::setw(9) << "Open/s"
+        << std::setw(9) << "Close/s"
+        << std::setw(8) << "Active"
+        << std::setw(8) << "Remotes" << "\n";
+    std::cout << std::string(7+(int)maxName+2+8+8+9+9+8+8, '-') << "\n";
+    for (const auto& t : top) {
+        std::cout << std::left << std::fixed << std::setprecision(2)
+            << std::setw(7) << t.pid
+            << std::setw((int)maxName+2) << t.name
+            << std::setw(8) << t.opens
+            << std::setw(8) << t.closes
+            << std::setw(9) << t.opensPerSec
+            << std::setw(9) << t.closesPerSec
+            << std::setw(8) << t.active
+            << std::setw(8) << t.distinctRemotes << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+int RecordTrace(ProcessManager& pm, const std::string& file, int intervalMs, int seconds) {
+    ConnectionTraceWriter writer;
+    if (!writer.Open(file)) { std::cout << "[!] Cannot create " << file << "\n"; return 1; }
+    pm.SetRecorder(&writer);
+    std::cout << "[*] Recording a snapshot every " << intervalMs << " ms for " << seconds << "s to " << file << "...\n";
+    const auto start = std::chrono::steady_clock::now();
+    const auto stop = start + std::chrono::seconds(seconds);
+    for (int i = 1; ; ++i) {
+        pm.ListNetworkProcessViews(); // every fresh snapshot is appended to the trace
+        if (!pm.Recording()) { std::cout << "[!] Failed to write " << file << "; recording stopped.\n"; break; }
+        const auto next = start + std::chrono::milliseconds((long long)intervalMs * i);
+        if (next > stop) break;
+        std::this_thread::sleep_until(next);
+    }
+    pm.SetRecorder(nullptr);
+    const bool closed = writer.Close();
+    const TraceStats& st = writer.Stats();
+    const double raw = (double)st.rows * sizeof(ConnRow);
+    std::cout << "[+] Recorded " << st.frames << " snapshot(s): " << st.rows << " row(s), " << st.changedRows
+        << " changed, " << st.strings << " distinct path(s) in " << st.bytes << " bytes";
+    if (st.frames) std::cout << " (" << st.bytes / st.frames << " bytes/snapshot";
+    if (st.frames && raw > 0) std::cout << ", " << std::fixed << std::setprecision(1) << 100.0 * st.bytes / raw << "% of the raw rows";
+    if (st.frames) std::cout << ")";
+    std::cout << "\n";
+    std::cout.unsetf(std::ios::fixed);
+    return closed && st.frames ? 0 : 1;
+}
+
+int ReplayTrace(const std::string& file, double speed, std::size_t k) {
+    // Mapped read-only: frames are decoded in place and recorded paths point into the view
+    Utils::MappedFile trace;
+    if (!trace.Open(Utils::Utf8ToWide(file), true)) { std::cout << "[!] Cannot open " << file << ": " << Utils::GetLastErrorAsString() << "\n"; return 1; }
+    const std::uint8_t* view = trace.MapAll();
+    int rc = 1;
+    if (!view) {
+        std::cout << "[!] Cannot map " << file << "\n";
+    } else {
+        TraceReplaySource source(view, (std::size_t)trace.Size(), speed);
+        if (!source.Valid()) {
+            std::cout << "[!] " << file << " is not an AppGate trace.\n";
+        } else {
+            ProcessManager pm;
+            pm.SetConnectionSource(&source);
+            ConnectionStats stats;
+            std::uint64_t connections = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (;;) {
+                const auto& snapshot = pm.ListNetworkProcessViews();
+                if (source.Finished()) break;
+                stats.IngestViews(snapshot, source.FrameTimeMicros() / 1000);
+                connections += snapshot.size();
+            }
+            const double secs = std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 1e-9);
+            if (source.Corrupt()) std::cout << "[!] Trace is corrupt after snapshot " << source.Frames() << "; replay stopped there.\n";
+            std::cout << "[+] Replayed " << source.Frames() << " snapshot(s), " << connections << " connection(s) in "
+                << std::fixed << std::setprecision(1) << secs * 1000 << " ms (" << source.Frames() / secs << " snapshots/s, "
+                << trace.Size() / secs / (1024 * 1024) << " MB/s of trace)\n";
+            std::cout.unsetf(std::ios::fixed);
+            PrintTopTalkers(stats.TopK(k, ConnectionStats::SortKey::Churn));
+            rc = source.Corrupt() ? 1 : 0;
+        }
+    }
+    return rc;
+}
+
+void ShowStats() {
+    if (!Instrumentation::kEnabled) {
+        std::cout << "[!] Instrumentation is compiled out. Reconfigure with -DAPPGATE_INSTRUMENTATION=ON.\n";
+        return;
+    }
+    auto probes = Instrumentation::Snapshot();
+    if (probes.empty()) { std::cout << "[!] No calls recorded yet.\n"; return; }
+    std::sort(probes.begin(), probes.end(), [](const Instrumentation::ProbeSummary& a, const Instrumentation::ProbeSummary& b){ return a.totalNs > b.totalNs; });
+    std::size_t maxName = 5;
+    for (const auto& p : probes) maxName = std::max(maxName, p.name.size());
+    std::cout << std::left
+        << std::setw((int)maxName+2) << "Probe"
+        << std::setw(10) << "Calls"
+        << std::setw(12) << "Total ms"
+        << std::setw(11) << "Mean us"
+        << std::setw(11) << "p50 us"
+        << std::setw(11) << "p99 us"
+        << std::setw(11) << "Max us" << "\n";
+    std::cout << std::string((int)maxName+2+10+12+11+11+11+11, '-') << "\n";
+    for (const auto& p : probes) {
+        std::cout << std::left << std::fixed << std::setprecision(1)
+            << std::setw((int)maxName+2) << p.name
+            << std::setw(10) << p.count
+            << std::setw(12) << p.totalNs / 1e6
+            << std::setw(11) << (double)p.totalNs / (double)p.count / 1e3
+            << std::setw(11) << p.p50Ns / 1e3
+            << std::setw(11) << p.p99Ns / 1e3
+            << std::setw(11) << p.maxNs / 1e3 << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+void WhatIf(FirewallManager& fm, InstalledAppsManager& iam) {
+    PolicyEvaluator pe;
+    pe.Compile(fm.ListRules());
+    std::cout << "Enter executable path to query (Enter to audit installed apps): ";
+    std::string input; std::getline(std::cin, input);
+    if (!input.empty()) {
+        std::wstring wpath = Utils::Utf8ToWide(input);
+        struct Slot { const char* label; bool outbound; bool ipv6; } slots[] = {
+            { "Outbound IPv4", true, false }, { "Outbound IPv6", true, true },
+            { "Inbound IPv4", false, false }, { "Inbound IPv6", false, true },
+        };
+        std::cout << std::left << std::setw(16) << "Direction" << std::setw(10) << "TCP" << std::setw(10) << "UDP" << "\n";
+        std::cout << std::string(36, '-') << "\n";
+        for (const auto& s : slots) {
+            std::cout << std::left << std::setw(16) << s.label
+                << std::setw(10) << (pe.IsBlocked(wpath, s.outbound, s.ipv6, 6) ? "Blocked" : "Allowed")
+                << std::setw(10) << (pe.IsBlocked(wpath, s.outbound, s.ipv6, 17) ? "Blocked" : "Allowed") << "\n";
+        }
+        return;
+    }
+    if (!pe.AppCount()) { std::cout << "[!] No rules found.\n"; return; }
+    auto apps = iam.EnumerateAll();
+    auto verdicts = pe.Audit(apps);
+    std::size_t full = 0, partial = 0, maxName = 12;
+    for (const auto& v : verdicts) {
+        if (v.coverage == BlockCoverage::None) continue;
+        maxName = std::max(maxName, v.app->name.size());
+        (v.coverage == BlockCoverage::Full ? full : partial)++;
+    }
+    if (!full && !partial) { std::cout << "[!] None of the " << apps.size() << " installed applications is blocked.\n"; return; }
+    std::cout << std::left
+        << std::setw(10) << "Coverage"
+        << std::setw((int)maxName+2) << "Application"
+        << "Executable Path" << "\n";
+    std::cout << std::string(10+(int)maxName+2+15, '-') << "\n";
+    for (const auto& v : verdicts) {
+        if (v.coverage == BlockCoverage::None) continue;
+        std::cout << std::left
+            << std::setw(10) << (v.coverage == BlockCoverage::Full ? "Full" : "Partial")
+            << std::setw((int)maxName+2) << Utils::WideToUtf8(v.app->name)
+            << Utils::WideToUtf8(v.app->exePath) << "\n";
+    }
+    std::cout << "\n[*] " << full << " fully and " << partial << " partially blocked of " << apps.size() << " applications.\n";
+}
+
+void BlockPrefix(FirewallManager& fm, InstalledAppsManager& iam) {
+    std::cout << "Enter directory prefix or glob to block (prefix with 'u' to unblock, e.g. u C:\\Games\\): ";
+    std::string input; std::getline(std::cin, input);
+    if (input.empty()) { std::cout << "[!] No input.\n"; return; }
+    if (input.size() > 2 && (input[0] == 'u' || input[0] == 'U') && input[1] == ' ') {
+        int n = fm.UnblockPrefixW(Utils::Utf8ToWide(input.substr(2)));
+        if (n < 0) std::cout << "[!] Prefix rule not found.\n";
+        else std::cout << "[-] Prefix rule removed (" << n << " executable(s) unblocked)\n";
+        return;
+    }
+    if (fm.BlockPrefixW(Utils::Utf8ToWide(input), iam.EnumerateAll()) < 0) {
+        std::cout << "[!] Invalid or duplicate pattern (wildcards are only allowed in the last component).\n";
+    }
+}
+
+void ApplyPolicy(FirewallManager& fm, InstalledAppsManager& iam) {
+    std::cout << "Enter policy file path (append ' --dry-run' to preview): ";
+    std::string input; std::getline(std::cin, input);
+    if (input.empty()) { std::cout << "[!] No input.\n"; return; }
+    const std::string flag = " --dry-run";
+    bool dryRun = input.size() > flag.size() && input.compare(input.size() - flag.size(), flag.size(), flag) == 0;
+    if (dryRun) input.erase(input.size() - flag.size());
+    ApplyPolicyFile(fm, iam, input, dryRun);
+}
+
+bool ApplyPolicyFile(FirewallManager& fm, InstalledAppsManager& iam, const std::string& file, bool dryRun) {
+    PolicyDocument policy;
+    std::string error;
+    if (!LoadPolicyFile(file, policy, error)) { std::cout << "[!] " << error << "\n"; return false; }
+    std::cout << "[*] Loaded " << policy.paths.size() << " path(s) and " << policy.prefixes.size() << " prefix rule(s)\n";
+    // Prefix rules need the app inventory; skip the (slow) enumeration when there are none
+    std::vector<ApplicationInfo> inventory;
+    if (!policy.prefixes.empty()) inventory = iam.EnumerateAll();
+    PolicyDiff diff;
+    if (!fm.ApplyPolicy(policy, inventory, diff, dryRun)) {
+        std::cout << "[!] Failed to apply policy.\n";
+        return false;
+    }
+    if (dryRun) {
+        for (const auto& p : diff.addPaths) std::cout << "  + " << Utils::WideToUtf8(p) << "\n";
+        for (const auto& p : diff.removePaths) std::cout << "  - " << Utils::WideToUtf8(p) << "\n";
+        std::cout << "[*] Dry run: " << diff.addPaths.size() << " to add, " << diff.removePaths.size() << " to remove, " << diff.unchanged << " unchanged\n";
+    }
+    return true;
+}
+
+void BlockProcessTree(FirewallManager& fm, ProcessManager& pm) {
+    std::cout << "Enter PID whose process tree to block: ";
+    std::string input; std::getline(std::cin, input);
+    int pid = 0;
+    try { pid = std::stoi(input); } catch (...) { std::cout << "[!] Invalid input.\n"; return; }
+    ProcessTree tree;
+    tree.Build(pm.SnapshotProcesses());
+    auto subtree = tree.Subtree(pid);
+    if (subtree.empty()) { std::cout << "[!] PID not found.\n"; return; }
+    std::vector<std::wstring> paths;
+    for (const auto* node : subtree) {
+        std::cout << "  " << std::left << std::setw(7) << node->pid << node->name
+            << (node->path.empty() ? "  (path not accessible, skipped)" : "") << "\n";
+        if (!node->path.empty()) paths.push_back(Utils::Utf8ToWide(node->path));
+    }
+    if (paths.empty()) { std::cout << "[!] No accessible executable paths in this tree.\n"; return; }
+    fm.BlockPathsW(paths);
+}
+
+void QueryConnections(ProcessManager& pm) {
+    std::cout << "Terms: lport= rport= port= (443,1000-2000) local= remote= (CIDR) proto=tcp4|tcp6 pid= name= (glob)\n";
+    std::cout << "Enter query: ";
+    std::string input; std::getline(std::cin, input);
+    RunQuery(pm, input);
+}
+
+bool RunQuery(ProcessManager& pm, const std::string& text) {
+    ConnectionQuery query;
+    std::string error;
+    if (!query.Parse(text, error)) { std::cout << "[!] " << error << "\n"; return false; }
+    auto rows = pm.QueryConnections(query);
+    if (rows.empty()) { std::cout << "[!] No matching connections.\n"; return true; }
+    std::size_t maxName = 4, maxL = 5, maxR = 6;
+    for (const auto& r : rows) {
+        maxName = std::max(maxName, r.name.size());
+        maxL = std::max(maxL, r.localAddr.size());
+        maxR = std::max(maxR, r.remoteAddr.size());
+    }
+    std::cout << std::left
+        << std::setw(7) << "PID"
+        << std::setw((int)maxName+2) << "Name"
+        << std::setw(7) << "Proto"
+        << std::setw((int)maxL+2) << "Local"
+        << std::setw((int)maxR+2) << "Remote" << "\n";
+    std::cout << std::string(7+(int)maxName+2+7+(int)maxL+2+(int)maxR+2, '-') << "\n";
+    for (const auto& r : rows) {
+        std::cout << std::left
+            << std::setw(7) << r.pid
+            << std::setw((int)maxName+2) << r.name
+            << std::setw(7) << r.protocol
+            << std::setw((int)maxL+2) << r.localAddr
+            << std::setw((int)maxR+2) << r.remoteAddr << "\n";
+    }
+    std::cout << "\n[*] " << rows.size() << " matching connection(s)\n";
+    return true;
+}
+
+void FindOwner(ProcessManager& pm) {
+    std::cout << "Snapshots are reused for up to 1000 ms; start with --max-age <ms> to change that.\n";
+    std::cout << "Enter local port, or remote host and port (e.g. 8080 or 10.0.0.5 443): ";
+    std::string input; std::getline(std::cin, input);
+    std::istringstream iss(input);
+    std::vector<std::string> args;
+    for (std::string tok; iss >> tok; ) args.push_back(tok);
+    PrintOwners(pm, args);
+}
+
+bool PrintOwners(ProcessManager& pm, std::vector<std::string> args) {
+    if (!args.empty() && args[0] == "--max-age") {
+        int ms = -1;
+        try { if (args.size() > 1) ms = std::stoi(args[1]); } catch (...) {}
+        if (ms < 0) { std::cout << "[!] Invalid --max-age.\n"; return false; }
+        pm.SetSnapshotMaxAge(std::chrono::milliseconds(ms));
+        args.erase(args.begin(), args.begin() + 2);
+    }
+    if (args.empty() || args.size() > 2) { std::cout << "[!] Expected <port> or <host> <port>.\n"; return false; }
+    int port = 0;
+    try { port = std::stoi(args.back()); } catch (...) { port = -1; }
+    if (port < 0 || port > 65535) { std::cout << "[!] Invalid port.\n"; return false; }
+    auto rows = (args.size() == 1) ? pm.FindByLocalPort((std::uint16_t)port) : pm.FindByRemote(args[0], (std::uint16_t)port);
+    if (rows.empty()) { std::cout << "[!] No matching connections.\n"; return true; }
+    for (const auto& r : rows) {
+        std::cout << std::left << std::setw(7) << r.pid << std::setw(7) << r.protocol
+            << r.name << "  " << r.localAddr << " -> " << r.remoteAddr << "  (" << r.path << ")\n";
+    }
+    return true;
+}
+
+// serve: one request per stdin line. Requests are queued, not awaited, so a burst of
+// lines is coalesced per path and flushed as one transaction per window.
+int ServeCommands(unsigned windowMs) {
+    FirewallCommandQueue queue(windowMs);
+    if (!queue.Start()) {
+        std::cout << "[!] Failed to initialize WFP engine. Run as Administrator.\n";
+        return 1;
+    }
+    std::vector<std::future<bool>> inFlight;
+    auto waitAll = [&]() {
+        std::size_t failed = 0;
+        for (auto& f : inFlight) if (!f.get()) ++failed;
+        if (failed) std::cout << "[!] " << failed << " of " << inFlight.size() << " request(s) failed or were reversed before they applied\n";
+        inFlight.clear();
+    };
+    std::cout << "[*] Commands: block <path>, unblock <path>, delete-all, wait, metrics, quit\n";
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::size_t sp = line.find(' ');
+        std::string verb = line.substr(0, sp);
+        std::string arg = (sp == std::string::npos) ? std::string() : line.substr(sp + 1);
+        if (verb.empty()) continue;
+        if (verb == "quit" || verb == "exit") break;
+        if (verb == "block" || verb == "unblock") {
+            if (arg.empty()) { std::cout << "[!] Usage: " << verb << " <path>\n"; continue; }
+            std::wstring wpath = Utils::Utf8ToWide(arg);
+            inFlight.push_back(verb == "block" ? queue.Block(wpath) : queue.Unblock(wpath));
+        } else if (verb == "delete-all") {
+            inFlight.push_back(queue.DeleteAll());
+        } else if (verb == "wait") {
+            waitAll();
+        } else if (verb == "metrics") {
+            PrintQueueMetrics(queue.Metrics());
+        } else {
+            std::cout << "[!] Unknown request: " << verb << "\n";
+        }
+    }
+    waitAll();
+    PrintQueueMetrics(queue.Metrics());
+    // The WFP session is dynamic: filters live only as long as this process
+    std::cout << "[*] Rules are active until AppGate exits. Press Enter to exit...";
+    std::cin.clear();
+    std::cin.get();
+    return 0;
+}
+
+void PrintQueueMetrics(const FirewallQueueMetrics& m) {
+    std::cout << "[*] Queue: depth " << m.depth << " (max " << m.maxDepth << "), "
+        << m.submitted << " submitted, " << m.coalesced << " coalesced (" << m.superseded << " superseded), "
+        << m.batches << " batch(es) (" << m.failedBatches << " failed, " << m.failedPaths << " path(s) not blocked), batch size last "
+        << m.lastBatchSize << " / max " << m.maxBatchSize << "\n";
+}
+
+void FindCopies(FirewallManager& fm, InstalledAppsManager& iam, ContentIdentityCache& ids) {
+    std::cout << "Enter executable path (e.g. a blocked binary): ";
+    std::string input; std::getline(std::cin, input);
+    if (input.empty()) { std::cout << "[!] No path entered.\n"; return; }
+    std::vector<std::wstring> copies;
+    if (!PrintCopies(iam, ids, Utils::Utf8ToWide(input), copies) || copies.empty()) return;
+    std::cout << "Block all copies? (y/n): ";
+    std::string answer; std::getline(std::cin, answer);
+    if (answer == "y" || answer == "Y") fm.BlockPathsW(copies);
+}
+
+bool PrintCopies(InstalledAppsManager& iam, ContentIdentityCache& ids, const std::wstring& path, std::vector<std::wstring>& copies) {
+    FileIdentity target;
+    if (!ids.Identify(path, target)) { std::cout << "[!] Cannot read " << Utils::WideToUtf8(path) << "\n"; return false; }
+    std::cout << "[*] SHA-256 " << target.Sha256Hex() << " (" << target.size << " bytes)\n";
+    const std::wstring self = Utils::CanonicalPathKey(path);
+    for (auto& copy : ids.FindCopies(target, iam.EnumerateAll())) {
+        if (Utils::CanonicalPathKey(copy) != self) copies.push_back(std::move(copy));
+    }
+    if (copies.empty()) { std::cout << "[*] No other copies in the app inventory.\n"; return true; }
+    for (const auto& c : copies) std::cout << "  " << Utils::WideToUtf8(c) << "\n";
+    std::cout << "[*] " << copies.size() << " cop" << (copies.size() == 1 ? "y" : "ies") << " found\n";
+    return true;
+}
+
+// Compares blocked paths with the content recorded when they were blocked (or on the
+// first run, for paths without one), reports replaced or vanished binaries and blocks
+// wherever their old content now lives in the inventory.
+void VerifyBlockedContent(FirewallManager& fm, InstalledAppsManager& iam, ContentIdentityCache& ids) {
+    std::vector<std::wstring> paths;
+    const std::string* prev = nullptr;
+    auto rules = fm.ListRules();
+    for (const auto& r : rules) {
+        if (prev && *prev == r.processPath) continue;
+        paths.push_back(Utils::Utf8ToWide(r.processPath));
+        prev = &r.processPath;
+    }
+    if (paths.empty()) { std::cout << "[!] No blocked binaries.\n"; return; }
+    std::size_t unreadable = 0;
+    auto changes = ids.CheckForChanges(paths, &unreadable);
+    if (unreadable) std::cout << "[!] " << unreadable << " blocked binar" << (unreadable == 1 ? "y" : "ies") << " could not be read (locked or access denied); checked again next run\n";
+    if (changes.empty()) {
+        std::cout << "[+] " << paths.size() - unreadable << " blocked binar" << (paths.size() - unreadable == 1 ? "y" : "ies") << " unchanged since blocked\n";
+        return;
+    }
+    auto inventory = iam.EnumerateAll();
+    std::vector<std::wstring> reblock;
+    for (const auto& c : changes) {
+        std::cout << "[!] " << Utils::WideToUtf8(c.path) << (c.missing ? " is gone" : " has new content") << "\n";
+        for (const auto& copy : ids.FindCopies(c.baseline, inventory)) {
+            std::cout << "    previous content now at " << Utils::WideToUtf8(copy) << "\n";
+            reblock.push_back(copy);
+        }
+    }
+    if (!reblock.empty()) fm.BlockPathsW(reblock);
+}
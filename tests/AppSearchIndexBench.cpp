@@ -0,0 +1,210 @@
+// AppSearchIndexBench.cpp
+// Ranking on a small inventory, queries longer than the per-query gram limit, incremental
+// updates against a rebuild, then top-20 search latency over a 100k-entry inventory
+// (typical queries must stay under a millisecond)
+#include "AppSearchIndex.h"
+#include "Check.h"
+#include <algorithm>
+#include <map>
+#include <random>
+
+namespace {
+    ApplicationInfo App(const std::wstring& name, const std::wstring& path) {
+        ApplicationInfo a;
+        a.name = name;
+        a.exePath = path;
+        a.source = L"Registry";
+        return a;
+    }
+
+    std::wstring TopName(AppSearchIndex& index, const std::wstring& query) {
+        auto hits = index.Search(query, 5);
+        return hits.empty() ? L"" : index.App(hits[0].id).name;
+    }
+
+    void Ranking() {
+        AppSearchIndex index;
+        index.Build({
+            App(L"Mozilla Firefox", L"C:\\Program Files\\Mozilla Firefox\\firefox.exe"),
+            App(L"Firefox Developer Edition", L"C:\\Program Files\\Firefox Developer Edition\\firefox.exe"),
+            App(L"Google Chrome", L"C:\\Program Files\\Google\\Chrome\\Application\\chrome.exe"),
+            App(L"Visual Studio Code", L"C:\\Users\\me\\AppData\\Local\\Programs\\Microsoft VS Code\\Code.exe"),
+            App(L"Notepad++", L"C:\\Program Files\\Notepad++\\notepad++.exe"),
+            App(L"7-Zip File Manager", L"C:\\Program Files\\7-Zip\\7zFM.exe"),
+        });
+        CHECK(index.Size() == 6);
+        CHECK(TopName(index, L"chrome") == L"Google Chrome");
+        auto fox = index.Search(L"FIREFOX", 5);
+        CHECK(fox.size() == 2 && index.App(fox[0].id).name == L"Firefox Developer Edition"); // prefix beats substring
+        CHECK(TopName(index, L"firefx") == L"Mozilla Firefox");  // typo
+        CHECK(TopName(index, L"code") == L"Visual Studio Code");
+        CHECK(TopName(index, L"no") == L"Notepad++");            // word prefix
+        CHECK(TopName(index, L"  7zfm ") == L"7-Zip File Manager"); // executable name, trimmed
+        CHECK(index.Search(L"zzzz", 5).empty());
+        CHECK(index.Search(L"", 5).empty() && index.Search(L"chrome", 0).empty());
+    }
+
+    // More distinct trigrams than a query keeps: the word-start gram must survive the cut
+    // and a literal match must still get its name bonus
+    void LongQuery() {
+        std::mt19937 rng(7);
+        std::wstring q;
+        for (int i = 0; i < 400; ++i) q += (wchar_t)(L'a' + rng() % 26);
+        AppSearchIndex index;
+        // Paths differ only in digits, so they add the same path hits to every entry
+        const auto exact = index.Add(App(q, L"C:\\1.exe"));
+        const auto word = index.Add(App(L"zz " + q, L"C:\\2.exe"));
+        const auto inner = index.Add(App(L"zz" + q, L"C:\\3.exe"));
+        index.Add(App(q.substr(0, 150), L"C:\\4.exe"));
+        auto hits = index.Search(q, 10);
+        CHECK(hits.size() >= 3);
+        if (hits.size() < 3) return;
+        CHECK(hits[0].id == exact && hits[1].id == word && hits[2].id == inner);
+        // Same trigram hits and length penalty; the word-start gram (a name hit counts 4) and
+        // the word-start name bonus make up the difference
+        CHECK(hits[1].score - hits[2].score == 4 * 20 + (150 - 100));
+    }
+
+    // Pronounceable made-up words: vendors come from a pool of 2000, product words from one
+    // of 30000, and one name in five carries a common suffix ("Update", "Tools", ...)
+    std::wstring MakeWord(std::mt19937& rng) {
+        static const wchar_t* onsets[] = { L"b", L"c", L"d", L"f", L"g", L"h", L"k", L"l", L"m", L"n", L"p", L"r", L"s", L"t",
+            L"v", L"w", L"z", L"br", L"ch", L"cl", L"cr", L"dr", L"fl", L"gr", L"pl", L"pr", L"sh", L"st", L"tr", L"" };
+        static const wchar_t* vowels[] = { L"a", L"e", L"i", L"o", L"u", L"ai", L"ea", L"io", L"ou", L"y" };
+        static const wchar_t* codas[] = { L"", L"", L"", L"n", L"r", L"s", L"x", L"l", L"t", L"ck" };
+        std::wstring w;
+        for (int i = 0, n = 2 + (int)(rng() % 2); i < n; ++i) { w += onsets[rng() % 30]; w += vowels[rng() % 10]; w += codas[rng() % 10]; }
+        w[0] = (wchar_t)std::towupper(w[0]);
+        return w;
+    }
+
+    struct Vocabulary {
+        std::vector<std::wstring> vendors, words;
+        explicit Vocabulary(std::mt19937& rng) {
+            for (int i = 0; i < 2000; ++i) vendors.push_back(MakeWord(rng));
+            for (int i = 0; i < 30000; ++i) words.push_back(MakeWord(rng));
+        }
+        const std::wstring& Word(std::mt19937& rng) const { return words[rng() % words.size()]; }
+    };
+
+    std::vector<ApplicationInfo> Inventory(const Vocabulary& vocab, std::size_t n, std::mt19937& rng) {
+        static const wchar_t* suffixes[] = { L"Update", L"Tools", L"Setup", L"Helper", L"Service" };
+        std::vector<ApplicationInfo> apps;
+        apps.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::wstring& vendor = vocab.vendors[rng() % vocab.vendors.size()];
+            const std::wstring& product = vocab.Word(rng);
+            std::wstring name = vendor + L" " + product;
+            if (rng() % 2) name += L" " + vocab.Word(rng);
+            if (rng() % 5 == 0) name += std::wstring(L" ") + suffixes[rng() % 5];
+            apps.push_back(App(name, L"C:\\Program Files\\" + vendor + L"\\" + product + std::to_wstring(i) + L"\\" + product + L".exe"));
+        }
+        return apps;
+    }
+
+    // Same scores in the same order, and each of a's hits scores the same in b; ties are
+    // ordered by id, which differs between the two
+    bool SameResults(AppSearchIndex& a, AppSearchIndex& b, const std::wstring& query) {
+        auto x = a.Search(query, 20), y = b.Search(query, 20);
+        if (x.size() != y.size()) return false;
+        std::map<std::wstring, int> all;
+        for (const auto& h : b.Search(query, b.Size())) all[b.App(h.id).exePath] = h.score;
+        for (std::size_t i = 0; i < x.size(); ++i) {
+            auto it = all.find(a.App(x[i].id).exePath);
+            if (x[i].score != y[i].score || it == all.end() || it->second != x[i].score) return false;
+        }
+        return true;
+    }
+
+    void IncrementalMatchesRebuild() {
+        std::mt19937 rng(11);
+        const Vocabulary vocab(rng);
+        auto apps = Inventory(vocab, 5000, rng);
+        AppSearchIndex incremental;
+        incremental.Build(apps);
+        // Several refreshes that drop, rename and add entries, enough to trigger compaction
+        for (int round = 0; round < 4; ++round) {
+            for (int i = 0; i < 600; ++i) apps.erase(apps.begin() + (std::ptrdiff_t)(rng() % apps.size()));
+            for (int i = 0; i < 100; ++i) apps[rng() % apps.size()].name = vocab.Word(rng);
+            auto more = Inventory(vocab, 500, rng);
+            for (auto& a : more) a.exePath += L"." + std::to_wstring(round);
+            apps.insert(apps.end(), more.begin(), more.end());
+            const auto update = incremental.Update(apps);
+            CHECK(update.added >= 500 && update.removed >= 600);
+        }
+        AppSearchIndex rebuilt;
+        rebuilt.Build(apps);
+        CHECK(incremental.Size() == apps.size() && rebuilt.Size() == apps.size());
+        for (const wchar_t* q : { L"f", L"no", L"tra", L"update", L"setp", L"tools helper", L"program files" }) CHECK(SameResults(incremental, rebuilt, q));
+    }
+
+    struct Timing { double p50 = 0, p99 = 0, max = 0; };
+    Timing Time(AppSearchIndex& index, const std::vector<std::wstring>& queries) {
+        std::vector<double> ms;
+        for (const auto& q : queries) {
+            auto start = std::chrono::steady_clock::now();
+            auto hits = index.Search(q, 20);
+            ms.push_back(Check::MsSince(start));
+            CHECK(hits.size() <= 20);
+        }
+        std::sort(ms.begin(), ms.end());
+        return { ms[ms.size() / 2], ms[ms.size() * 99 / 100], ms.back() };
+    }
+
+    void Benchmark() {
+        const std::size_t kEntries = 100000, kQueries = 500;
+        std::mt19937 rng(42);
+        const Vocabulary vocab(rng);
+        const auto apps = Inventory(vocab, kEntries, rng);
+        AppSearchIndex index;
+        auto start = std::chrono::steady_clock::now();
+        index.Build(apps);
+        std::cout << "[*] Build " << kEntries << " entries: " << Check::MsSince(start) << " ms\n";
+        CHECK(index.Size() == kEntries);
+
+        // What a user types into the filter: a word of an app's name, a prefix of one, one
+        // with a dropped letter, and one or two letters
+        std::vector<std::wstring> names, prefixes, typos, shorts;
+        for (std::size_t i = 0; i < kQueries; ++i) {
+            std::wstring word = vocab.Word(rng);
+            for (auto& c : word) c = (wchar_t)std::towlower(c);
+            names.push_back(word);
+            prefixes.push_back(word.substr(0, 4));
+            std::wstring typo = word;
+            typo.erase(1 + rng() % (typo.size() - 1), 1);
+            typos.push_back(typo);
+            shorts.push_back(word.substr(0, 1 + rng() % 2));
+        }
+        // Queries whose grams are in nearly every path
+        const std::vector<std::wstring> broad = { L"exe", L"program files", L"files", L"c:\\program" };
+
+        bool fast = true;
+        for (const auto& set : { std::make_pair("names", &names), std::make_pair("prefixes", &prefixes),
+                                 std::make_pair("typos", &typos), std::make_pair("1-2 chars", &shorts) }) {
+            Timing t = Time(index, *set.second);
+            std::cout << "[*] " << set.first << ": p50 " << t.p50 << " ms, p99 " << t.p99 << " ms, max " << t.max << " ms\n";
+            fast = fast && t.p50 < 1.0;
+        }
+        Timing t = Time(index, broad);
+        std::cout << "[*] broad (every path): p50 " << t.p50 << " ms, max " << t.max << " ms\n";
+        CHECK(fast);
+
+        // A refresh that drops and adds a few entries
+        auto refreshed = apps;
+        refreshed.erase(refreshed.begin() + 100, refreshed.begin() + 110);
+        refreshed.push_back(App(L"Brand New App", L"C:\\New\\new.exe"));
+        start = std::chrono::steady_clock::now();
+        const auto update = index.Update(refreshed);
+        std::cout << "[*] Update (+" << update.added << " -" << update.removed << "): " << Check::MsSince(start) << " ms\n";
+        CHECK(update.added == 1 && update.removed == 10);
+        CHECK(TopName(index, L"brand new") == L"Brand New App");
+    }
+}
+
+int main() {
+    Ranking();
+    LongQuery();
+    IncrementalMatchesRebuild();
+    Benchmark();
+    return Check::Report("AppSearchIndexBench");
+}
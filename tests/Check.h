@@ -0,0 +1,28 @@
+// Check.h
+// Minimal check macros for the test executables: failures are counted and reported, not fatal
+#pragma once
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace Check {
+    inline int& Failures() { static int failures = 0; return failures; }
+
+    // Exit code for main(): 0 when every check passed
+    inline int Report(const char* suite) {
+        if (Failures()) { std::cout << "[!] " << suite << ": " << Failures() << " check(s) failed\n"; return 1; }
+        std::cout << "[+] " << suite << ": all checks passed\n";
+        return 0;
+    }
+
+    inline double MsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Directory of the checked-in fixtures (tests/fixtures)
+    inline std::string Fixture(const std::string& name) { return std::string(APPGATE_FIXTURES) + "/" + name; }
+}
+
+#define CHECK(cond) do { \
+    if (!(cond)) { ++Check::Failures(); std::cout << "[!] " << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed\n"; } \
+} while (0)
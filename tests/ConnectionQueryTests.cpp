@@ -0,0 +1,180 @@
+// ConnectionQueryTests.cpp
+// Query parsing and row predicates: ports and ranges, port= on either side, v4/v6 CIDRs
+// (including /0 and full-length prefixes), proto, pid lists, name globs and parse errors
+#include "ConnectionQuery.h"
+#include "Check.h"
+
+namespace {
+    ConnRow Row(const std::string& local, std::uint16_t lport, const std::string& remote, std::uint16_t rport, std::uint32_t pid = 100) {
+        ConnRow r;
+        bool v6 = false;
+        CHECK(ParseIpAddress(local, r.localAddr, v6));
+        CHECK(ParseIpAddress(remote, r.remoteAddr, r.ipv6));
+        CHECK(v6 == r.ipv6);
+        r.localPort = lport;
+        r.remotePort = rport;
+        r.pid = pid;
+        r.state = 5; // ESTABLISHED
+        return r;
+    }
+
+    ConnectionQuery Query(const std::string& text) {
+        ConnectionQuery q;
+        std::string error;
+        const bool ok = q.Parse(text, error);
+        if (!ok) std::cout << "[!] " << text << ": " << error << "\n";
+        CHECK(ok);
+        return q;
+    }
+
+    std::string ParseError(const std::string& text) {
+        ConnectionQuery q;
+        std::string error;
+        return q.Parse(text, error) ? "" : error;
+    }
+
+    void Addresses() {
+        std::uint8_t a[16]; bool v6 = true;
+        CHECK(ParseIpAddress("10.1.2.3", a, v6) && !v6 && a[0] == 10 && a[3] == 3);
+        CHECK(ParseIpAddress("::1", a, v6) && v6 && a[15] == 1 && a[0] == 0);
+        CHECK(ParseIpAddress("fe80::1:2", a, v6) && a[0] == 0xFE && a[1] == 0x80 && a[13] == 1 && a[15] == 2);
+        CHECK(ParseIpAddress("1:2:3:4:5:6:7:8", a, v6) && a[1] == 1 && a[15] == 8);
+        CHECK(!ParseIpAddress("10.1.2", a, v6) && !ParseIpAddress("10.1.2.256", a, v6) && !ParseIpAddress("10..2.3", a, v6));
+        CHECK(!ParseIpAddress("1::2::3", a, v6) && !ParseIpAddress("1:2:3:4:5:6:7", a, v6) && !ParseIpAddress("12345::", a, v6));
+    }
+
+    void Ports() {
+        const ConnRow https = Row("10.0.0.5", 50000, "93.184.216.34", 443);
+        const ConnRow server = Row("10.0.0.5", 8080, "10.0.0.9", 61000);
+        auto q = Query("rport=443");
+        CHECK(q.MatchesRow(https) && !q.MatchesRow(server));
+        q = Query("lport=8000-8100");
+        CHECK(!q.MatchesRow(https) && q.MatchesRow(server));
+        q = Query("lport=0-65535 rport=1-443");
+        CHECK(q.MatchesRow(https) && !q.MatchesRow(server));
+        // port= matches either side
+        q = Query("port=443,8080");
+        CHECK(q.MatchesRow(https) && q.MatchesRow(server));
+        q = Query("port=61000");
+        CHECK(!q.MatchesRow(https) && q.MatchesRow(server));
+        q = Query("port=1-100");
+        CHECK(!q.MatchesRow(https) && !q.MatchesRow(server));
+        // Different keys intersect
+        q = Query("port=443 lport=50000");
+        CHECK(q.MatchesRow(https));
+        q = Query("port=443 lport=50001");
+        CHECK(!q.MatchesRow(https));
+    }
+
+    void Cidrs() {
+        const ConnRow v4 = Row("192.168.1.20", 50000, "10.20.30.40", 443);
+        const ConnRow v6 = Row("fe80::5", 50000, "2001:db8::42", 443);
+        auto q = Query("remote=10.0.0.0/8");
+        CHECK(q.MatchesRow(v4) && !q.MatchesRow(v6));
+        q = Query("remote=10.20.30.40/32 local=192.168.0.0/16");
+        CHECK(q.MatchesRow(v4));
+        q = Query("remote=10.20.30.41/32");
+        CHECK(!q.MatchesRow(v4));
+        q = Query("remote=10.20.30.40"); // no length: the whole address
+        CHECK(q.MatchesRow(v4));
+        q = Query("remote=0.0.0.0/0");
+        CHECK(q.MatchesRow(v4) && !q.MatchesRow(v6));
+        q = Query("remote=2001:db8::/32");
+        CHECK(!q.MatchesRow(v4) && q.MatchesRow(v6));
+        q = Query("remote=2001:db8::42/128");
+        CHECK(q.MatchesRow(v6));
+        q = Query("remote=2001:db8::43/128");
+        CHECK(!q.MatchesRow(v6));
+        q = Query("remote=::/0");
+        CHECK(!q.MatchesRow(v4) && q.MatchesRow(v6));
+        // Prefixes past the first 64 bits
+        q = Query("remote=2001:db8::40/126");
+        CHECK(q.MatchesRow(v6));
+        q = Query("remote=2001:db8::40/127");
+        CHECK(!q.MatchesRow(v6));
+        // One list mixing families and lengths
+        q = Query("remote=172.16.0.0/12,2001:db8::/48,10.20.0.0/16");
+        CHECK(q.MatchesRow(v4) && q.MatchesRow(v6));
+        q = Query("local=fe80::/10");
+        CHECK(!q.MatchesRow(v4) && q.MatchesRow(v6));
+    }
+
+    void ProtoAndPids() {
+        const ConnRow v4 = Row("10.0.0.5", 50000, "10.0.0.9", 443, 42);
+        const ConnRow v6 = Row("::1", 50000, "::1", 443, 7);
+        auto q = Query("proto=tcp4");
+        CHECK(q.MatchesRow(v4) && !q.MatchesRow(v6));
+        q = Query("proto=TCP6");
+        CHECK(!q.MatchesRow(v4) && q.MatchesRow(v6));
+        q = Query("proto=tcp");
+        CHECK(q.MatchesRow(v4) && q.MatchesRow(v6));
+        q = Query("pid=7");
+        CHECK(!q.MatchesRow(v4) && q.MatchesRow(v6));
+        q = Query("pid=1,42,4294967295");
+        CHECK(q.MatchesRow(v4) && !q.MatchesRow(v6));
+        q = Query("pid=42 proto=tcp6");
+        CHECK(!q.MatchesRow(v4) && !q.MatchesRow(v6));
+    }
+
+    void Names() {
+        auto q = Query("name=chrome*");
+        CHECK(q.NeedsName());
+        CHECK(q.MatchesName("chrome.exe") && q.MatchesName("Chrome.EXE") && !q.MatchesName("msedge.exe"));
+        q = Query("name=*.exe,svchost?");
+        CHECK(q.MatchesName("a.exe") && q.MatchesName("svchost1") && !q.MatchesName("svchost") && !q.MatchesName("a.dll"));
+        q = Query("NAME=Fire*Fox.exe");
+        CHECK(q.MatchesName("firefox.exe") && q.MatchesName("firewall-fox.exe") && !q.MatchesName("firefox.exe.bak"));
+        q = Query("rport=443");
+        CHECK(!q.NeedsName() && q.MatchesName("anything"));
+        q = Query("");
+        CHECK(q.MatchesRow(Row("10.0.0.5", 1, "10.0.0.9", 2)) && !q.NeedsName());
+    }
+
+    void Errors() {
+        CHECK(ParseError("rport") == "expected key=value: rport");
+        CHECK(ParseError("rport=443 color=red") == "unknown key: color");
+        CHECK(ParseError("lport=") == "invalid value in: lport=");
+        CHECK(ParseError("lport=65536") == "invalid value in: lport=65536");
+        CHECK(ParseError("rport=2000-1000") == "invalid value in: rport=2000-1000");
+        CHECK(ParseError("rport=1-") == "invalid value in: rport=1-");
+        CHECK(ParseError("port=80,http") == "invalid value in: port=80,http");
+        CHECK(ParseError("remote=10.0.0.0/33") == "invalid value in: remote=10.0.0.0/33");
+        CHECK(ParseError("remote=::/129") == "invalid value in: remote=::/129");
+        CHECK(ParseError("remote=10.0.0.0/") == "invalid value in: remote=10.0.0.0/");
+        CHECK(ParseError("local=example.com") == "invalid value in: local=example.com");
+        CHECK(ParseError("proto=udp") == "invalid value in: proto=udp");
+        CHECK(ParseError("pid=12,x") == "invalid value in: pid=12,x");
+        CHECK(ParseError("pid=4294967296") == "invalid value in: pid=4294967296");
+        CHECK(ParseError("name=") == "invalid value in: name=");
+        // A failed parse leaves no half-built query behind
+        ConnectionQuery q;
+        std::string error;
+        CHECK(q.Parse("pid=42", error));
+        CHECK(!q.Parse("pid=7 bogus", error));
+        CHECK(q.Parse("", error) && q.MatchesRow(Row("10.0.0.5", 1, "10.0.0.9", 2, 7)));
+    }
+
+    // Each key may appear once: "pid=1 pid=2" would otherwise read as "or" across terms,
+    // against the rule that terms must all match, and a second proto would override the first
+    void RepeatedKeys() {
+        CHECK(ParseError("pid=1 pid=2") == "repeated key: pid (list values with commas)");
+        CHECK(ParseError("proto=tcp4 proto=tcp6") == "repeated key: proto (list values with commas)");
+        CHECK(ParseError("rport=443 RPORT=80") == "repeated key: rport (list values with commas)");
+        CHECK(ParseError("remote=10.0.0.0/8 name=a* remote=fd00::/8") == "repeated key: remote (list values with commas)");
+        // lport, rport and port are different keys and intersect
+        auto q = Query("lport=50000 rport=443 port=443");
+        CHECK(q.MatchesRow(Row("10.0.0.5", 50000, "10.0.0.9", 443)));
+        CHECK(!q.MatchesRow(Row("10.0.0.5", 50001, "10.0.0.9", 443)));
+    }
+}
+
+int main() {
+    Addresses();
+    Ports();
+    Cidrs();
+    ProtoAndPids();
+    Names();
+    Errors();
+    RepeatedKeys();
+    return Check::Report("ConnectionQueryTests");
+}
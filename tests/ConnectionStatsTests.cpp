@@ -0,0 +1,148 @@
+// ConnectionStatsTests.cpp
+// Replays fixture snapshots through ConnectionStats and checks churn, PID recycling,
+// eviction, the HyperLogLog estimate and top-K latency
+#include "ConnectionStats.h"
+#include "Check.h"
+#include <fstream>
+#include <sstream>
+
+namespace {
+    // Fixture format: see tests/fixtures/churn_snapshots.tsv
+    bool ReplayFixture(const std::string& file, ConnectionStats& stats) {
+        std::ifstream in(file);
+        if (!in) return false;
+        std::vector<ProcessInfo> snapshot;
+        std::uint64_t time = 0;
+        bool open = false;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            if (line[0] == '@') {
+                if (open) stats.Ingest(snapshot, time);
+                snapshot.clear();
+                time = std::stoull(line.substr(1));
+                open = true;
+                continue;
+            }
+            std::istringstream fields(line);
+            std::string pid;
+            ProcessInfo pi;
+            std::getline(fields, pid, '\t');
+            std::getline(fields, pi.name, '\t');
+            std::getline(fields, pi.path, '\t');
+            std::getline(fields, pi.protocol, '\t');
+            std::getline(fields, pi.localAddr, '\t');
+            std::getline(fields, pi.remoteAddr, '\t');
+            pi.pid = std::stoi(pid);
+            snapshot.push_back(pi);
+        }
+        if (open) stats.Ingest(snapshot, time);
+        return open;
+    }
+
+    const ProcessChurnStats* Find(const std::vector<ProcessChurnStats>& top, const std::string& name) {
+        for (const auto& s : top) if (s.name == name) return &s;
+        return nullptr;
+    }
+
+    ProcessInfo Row(int pid, const std::string& path, const std::string& local, const std::string& remote) {
+        ProcessInfo pi;
+        pi.pid = pid;
+        pi.name = path.substr(path.find_last_of('\\') + 1);
+        pi.path = path;
+        pi.protocol = "TCP";
+        pi.localAddr = local;
+        pi.remoteAddr = remote;
+        return pi;
+    }
+
+    void FixtureReplay() {
+        ConnectionStats stats;
+        CHECK(ReplayFixture(Check::Fixture("churn_snapshots.tsv"), stats));
+        CHECK(stats.SnapshotCount() == 3);
+        auto top = stats.TopK(10, ConnectionStats::SortKey::Churn);
+        CHECK(top.size() == 3); // pid 30's updater slot was taken over by rogue.exe
+        CHECK(!top.empty() && top[0].name == "browser.exe");
+        const auto* browser = Find(top, "browser.exe");
+        CHECK(browser && browser->opens == 2 && browser->closes == 2 && browser->active == 2);
+        CHECK(browser && browser->distinctRemotes == 3);
+        const auto* agent = Find(top, "agent.exe");
+        CHECK(agent && agent->opens == 0 && agent->closes == 0 && agent->active == 1);
+        // The updater's connection closed when rogue.exe took over PID 30; that close
+        // belongs to the updater, not to the new owner of the PID
+        const auto* rogue = Find(top, "rogue.exe");
+        CHECK(rogue && rogue->opens == 1 && rogue->closes == 0);
+        CHECK(!Find(top, "updater.exe"));
+    }
+
+    void EvictedSlotKeepsNoCloses() {
+        ConnectionStats stats(2);
+        stats.Ingest({ Row(1, "C:\\a.exe", "10.0.0.1:1", "1.1.1.1:443"), Row(2, "C:\\b.exe", "10.0.0.1:2", "2.2.2.2:443") }, 1000);
+        // b.exe is seen first, so a.exe is the least recently seen slot and c.exe evicts it
+        stats.Ingest({ Row(2, "C:\\b.exe", "10.0.0.1:2", "2.2.2.2:443"), Row(3, "C:\\c.exe", "10.0.0.1:3", "3.3.3.3:443") }, 2000);
+        CHECK(stats.TrackedProcesses() == 2);
+        auto top = stats.TopK(10, ConnectionStats::SortKey::Churn);
+        const auto* c = Find(top, "c.exe");
+        CHECK(c && c->opens == 1 && c->closes == 0);
+        const auto* b = Find(top, "b.exe");
+        CHECK(b && b->opens == 0 && b->closes == 0);
+    }
+
+    void WindowSlides() {
+        ConnectionStats stats;
+        stats.Ingest({}, 0);
+        stats.Ingest({ Row(1, "C:\\a.exe", "10.0.0.1:1", "1.1.1.1:443") }, 1000);
+        auto top = stats.TopK(1, ConnectionStats::SortKey::Opens);
+        CHECK(top.size() == 1 && top[0].opens == 1);
+        // Still connected, but the open is now older than the window
+        stats.Ingest({ Row(1, "C:\\a.exe", "10.0.0.1:1", "1.1.1.1:443") }, 1000 + ConnectionStats::kWindowSeconds * 1000);
+        top = stats.TopK(1, ConnectionStats::SortKey::Opens);
+        CHECK(top.size() == 1 && top[0].opens == 0 && top[0].active == 1);
+    }
+
+    void DistinctEstimate() {
+        ConnectionStats stats;
+        std::vector<ProcessInfo> snapshot;
+        for (int i = 0; i < 10000; ++i) {
+            snapshot.push_back(Row(7, "C:\\scanner.exe", "10.0.0.1:" + std::to_string(1024 + i % 60000),
+                "10." + std::to_string(i / 65536) + "." + std::to_string(i / 256 % 256) + "." + std::to_string(i % 256) + ":80"));
+        }
+        stats.Ingest(snapshot, 1000);
+        auto top = stats.TopK(1, ConnectionStats::SortKey::Distinct);
+        CHECK(top.size() == 1);
+        // 256 registers: standard error ~6.5%; allow three of them
+        CHECK(!top.empty() && top[0].distinctRemotes > 8000 && top[0].distinctRemotes < 12000);
+    }
+
+    void TopKLatency() {
+        // A full tracking budget of busy processes, then time the query the view issues
+        ConnectionStats stats;
+        for (std::uint64_t t = 0; t < 5; ++t) {
+            std::vector<ProcessInfo> snapshot;
+            for (int pid = 1; pid <= 1024; ++pid) {
+                const std::string path = "C:\\Apps\\app" + std::to_string(pid) + ".exe";
+                for (int c = 0; c < 8; ++c) {
+                    snapshot.push_back(Row(pid, path, "10.0.0.1:" + std::to_string(10000 + (int)t * 8 + c), "8.8." + std::to_string(c) + ".8:443"));
+                }
+            }
+            stats.Ingest(snapshot, 1000 * (t + 1));
+        }
+        const int rounds = 200;
+        auto start = std::chrono::steady_clock::now();
+        std::size_t sink = 0;
+        for (int i = 0; i < rounds; ++i) sink += stats.TopK(10, ConnectionStats::SortKey::Churn).size();
+        const double ms = Check::MsSince(start) / rounds;
+        CHECK(sink == (std::size_t)rounds * 10);
+        std::cout << "[*] TopK(10) over " << stats.TrackedProcesses() << " processes: " << ms * 1000.0 << " us\n";
+    }
+}
+
+int main() {
+    FixtureReplay();
+    EvictedSlotKeepsNoCloses();
+    WindowSlides();
+    DistinctEstimate();
+    TopKLatency();
+    return Check::Report("ConnectionStatsTests");
+}
@@ -0,0 +1,241 @@
+// ConnectionTraceBench.cpp
+// Replays the trace fixtures in tests/fixtures/traces (plus argv[1] or APPGATE_TRACE, e.g.
+// a capture from `AppGate record`) through a Utils::MappedFile at full speed: decode only,
+// then decode + endpoint formatting + ConnectionStats, as `AppGate replay` does.
+// churn.agtrace is churn_snapshots.tsv recorded by ConnectionTraceWriter; its replay must
+// give back those rows, so it also pins the on-disk format.
+//   ConnectionTraceBench --write-fixtures <dir>   regenerates both fixture traces
+#include "ConnectionTrace.h"
+#include "ConnectionStats.h"
+#include "Utils.h"
+#include "Check.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory_resource>
+#include <random>
+#include <set>
+#include <sstream>
+#include <tuple>
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct Snapshot {
+        std::uint64_t timeMs = 0;
+        std::vector<ConnRow> rows;
+        std::vector<std::string> paths; // paths[i] belongs to rows[i].pid
+    };
+
+    bool ParseEndpoint(const std::string& text, std::uint8_t* addr, std::uint16_t& port) {
+        const auto colon = text.rfind(':');
+        if (colon == std::string::npos) return false;
+        port = (std::uint16_t)std::stoul(text.substr(colon + 1));
+        return inet_pton(AF_INET, text.substr(0, colon).c_str(), addr) == 1;
+    }
+
+    // Fixture format: see tests/fixtures/churn_snapshots.tsv
+    std::vector<Snapshot> LoadSnapshots(const std::string& file) {
+        std::vector<Snapshot> snapshots;
+        std::ifstream in(file);
+        for (std::string line; std::getline(in, line); ) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            if (line[0] == '@') { snapshots.emplace_back(); snapshots.back().timeMs = std::stoull(line.substr(1)); continue; }
+            if (snapshots.empty()) continue;
+            std::istringstream fields(line);
+            std::string pid, name, path, protocol, local, remote;
+            std::getline(fields, pid, '\t');
+            std::getline(fields, name, '\t');
+            std::getline(fields, path, '\t');
+            std::getline(fields, protocol, '\t');
+            std::getline(fields, local, '\t');
+            std::getline(fields, remote, '\t');
+            ConnRow row;
+            row.pid = (std::uint32_t)std::stoul(pid);
+            row.state = 5; // ESTABLISHED
+            if (!ParseEndpoint(local, row.localAddr, row.localPort) || !ParseEndpoint(remote, row.remoteAddr, row.remotePort)) continue;
+            snapshots.back().rows.push_back(row);
+            snapshots.back().paths.push_back(path);
+        }
+        return snapshots;
+    }
+
+    bool WriteTrace(const std::string& file, const std::vector<Snapshot>& snapshots) {
+        ConnectionTraceWriter writer;
+        if (!writer.Open(file)) return false;
+        for (const auto& s : snapshots) {
+            std::vector<TraceProcess> processes;
+            std::set<std::uint32_t> seen;
+            for (std::size_t i = 0; i < s.rows.size(); ++i) {
+                if (seen.insert(s.rows[i].pid).second) processes.push_back({s.rows[i].pid, s.paths[i]});
+            }
+            if (!writer.Append(s.timeMs * 1000, s.rows, processes)) return false;
+        }
+        return writer.Close();
+    }
+
+    // A steady desktop: ~3000 connections over 300 processes, 2% of them replaced each
+    // second for five minutes, a few processes exiting and new ones starting
+    std::vector<Snapshot> SteadySnapshots() {
+        std::mt19937 rng(0x5EED);
+        struct Proc { std::uint32_t pid; std::string path; };
+        std::vector<Proc> procs;
+        std::uint32_t nextPid = 1000;
+        auto newProc = [&]() {
+            const std::uint32_t vendor = rng() % 40;
+            procs.push_back({nextPid, "C:\\Program Files\\Vendor" + std::to_string(vendor) + "\\app" + std::to_string(nextPid % 97) + ".exe"});
+            nextPid += 4;
+        };
+        for (int i = 0; i < 300; ++i) newProc();
+        auto newRow = [&]() {
+            ConnRow row;
+            row.pid = procs[rng() % procs.size()].pid;
+            row.ipv6 = rng() % 8 == 0;
+            row.localAddr[0] = 10; row.localAddr[3] = 5;
+            for (int b = 0; b < (row.ipv6 ? 16 : 4); ++b) row.remoteAddr[b] = (std::uint8_t)rng();
+            if (row.ipv6) { row.localAddr[0] = 0xFE; row.localAddr[1] = 0x80; row.localAddr[15] = 5; }
+            row.localPort = (std::uint16_t)(49152 + rng() % 16384);
+            row.remotePort = rng() % 4 ? 443 : (std::uint16_t)(rng() % 65536);
+            row.state = 5;
+            return row;
+        };
+        std::vector<ConnRow> live;
+        for (int i = 0; i < 3000; ++i) live.push_back(newRow());
+        std::vector<Snapshot> snapshots;
+        for (int t = 0; t < 300; ++t) {
+            if (t && rng() % 10 == 0) {
+                // A process exits with its connections and a new one starts
+                const std::size_t victim = rng() % procs.size();
+                const std::uint32_t pid = procs[victim].pid;
+                live.erase(std::remove_if(live.begin(), live.end(), [&](const ConnRow& r) { return r.pid == pid; }), live.end());
+                procs.erase(procs.begin() + (std::ptrdiff_t)victim);
+                newProc();
+            }
+            for (int c = 0; c < 60 && !live.empty(); ++c) live[rng() % live.size()] = newRow();
+            while (live.size() < 3000) live.push_back(newRow());
+            Snapshot s;
+            s.timeMs = 1000ull * (std::uint64_t)(t + 1);
+            s.rows = live;
+            for (const auto& r : live) {
+                s.paths.push_back(std::find_if(procs.begin(), procs.end(), [&](const Proc& p) { return p.pid == r.pid; })->path);
+            }
+            snapshots.push_back(std::move(s));
+        }
+        return snapshots;
+    }
+
+    using RowKey = std::tuple<std::uint32_t, std::string, std::string>;
+    RowKey Key(const ConnRow& r) {
+        char local[Utils::kEndpointChars], remote[Utils::kEndpointChars];
+        const std::size_t ln = Utils::FormatEndpoint(r.localAddr, r.localPort, r.ipv6, local);
+        const std::size_t rn = Utils::FormatEndpoint(r.remoteAddr, r.remotePort, r.ipv6, remote);
+        return RowKey(r.pid, std::string(local, ln), std::string(remote, rn));
+    }
+
+    // churn.agtrace must replay exactly the snapshots it was recorded from
+    void ChurnFixtureMatchesSource() {
+        const auto expected = LoadSnapshots(Check::Fixture("churn_snapshots.tsv"));
+        Utils::MappedFile file;
+        CHECK(file.Open(Utils::Utf8ToWide(Check::Fixture("traces/churn.agtrace"))));
+        const std::uint8_t* data = file.MapAll();
+        CHECK(data != nullptr && !expected.empty());
+        if (!data) return;
+        ConnectionTraceReader reader(data, (std::size_t)file.Size());
+        CHECK(reader.Valid());
+        std::size_t frame = 0;
+        for (; reader.Next(); ++frame) {
+            if (frame >= expected.size()) break;
+            const auto& want = expected[frame];
+            CHECK(reader.TimeMicros() == want.timeMs * 1000);
+            std::multiset<RowKey> got, wanted;
+            for (const auto& r : reader.Rows()) got.insert(Key(r));
+            for (const auto& r : want.rows) wanted.insert(Key(r));
+            CHECK(got == wanted);
+            for (std::size_t i = 0; i < want.rows.size(); ++i) CHECK(reader.ImagePath(want.rows[i].pid) == want.paths[i]);
+        }
+        CHECK(frame == expected.size() && !reader.Corrupt());
+    }
+
+    void Replay(const std::string& path) {
+        Utils::MappedFile file;
+        if (!file.Open(Utils::Utf8ToWide(path), true)) { std::cout << "[!] Cannot open " << path << "\n"; CHECK(false); return; }
+        const std::uint8_t* data = file.MapAll();
+        CHECK(data != nullptr);
+        if (!data) return;
+        const std::size_t size = (std::size_t)file.Size();
+
+        // Decode only, repeated until about 50 MB of trace went through
+        const std::size_t passes = std::max<std::size_t>(1, (50u << 20) / size);
+        std::uint64_t frames = 0, rows = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t p = 0; p < passes; ++p) {
+            ConnectionTraceReader reader(data, size);
+            while (reader.Next()) { ++frames; rows += reader.Rows().size(); }
+            CHECK(!reader.Corrupt());
+        }
+        const double decodeMs = Check::MsSince(start);
+
+        // One pass the way `AppGate replay` consumes it: rows become views, then statistics
+        TraceReplaySource source(data, size, 0);
+        ConnectionStats stats;
+        std::vector<ConnRow> captured;
+        std::vector<char> text;
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::vector<ProcessInfoView> views(&pool);
+        std::uint64_t ingested = 0;
+        start = std::chrono::steady_clock::now();
+        while (source.Capture(captured) && !source.Finished()) {
+            text.resize(captured.size() * 2 * Utils::kEndpointChars);
+            views.clear();
+            for (std::size_t i = 0; i < captured.size(); ++i) {
+                const ConnRow& r = captured[i];
+                char* local = &text[2 * i * Utils::kEndpointChars];
+                char* remote = local + Utils::kEndpointChars;
+                ProcessInfoView v;
+                v.pid = (int)r.pid;
+                v.path = source.ImagePath(r.pid);
+                v.name = v.path.substr(v.path.find_last_of('\\') + 1);
+                v.protocol = "TCP";
+                v.localAddr = std::string_view(local, Utils::FormatEndpoint(r.localAddr, r.localPort, r.ipv6, local));
+                v.remoteAddr = std::string_view(remote, Utils::FormatEndpoint(r.remoteAddr, r.remotePort, r.ipv6, remote));
+                views.push_back(v);
+            }
+            stats.IngestViews(views, source.FrameTimeMicros() / 1000);
+            ingested += captured.size();
+        }
+        const double replayMs = Check::MsSince(start);
+        CHECK(!source.Corrupt() && source.Frames() == frames / passes);
+
+        const double mb = (double)size * passes / (1024 * 1024);
+        std::cout << "[*] " << fs::path(path).filename().string() << ": " << size << " bytes, " << frames / passes << " snapshots, "
+                  << rows / passes << " rows (" << (double)size / std::max<std::uint64_t>(frames / passes, 1) << " bytes/snapshot)\n";
+        std::cout << "    decode " << mb / std::max(decodeMs / 1000, 1e-9) << " MB/s, " << frames / std::max(decodeMs / 1000, 1e-9)
+                  << " snapshots/s; with views + stats " << source.Frames() / std::max(replayMs / 1000, 1e-9) << " snapshots/s, "
+                  << ingested / std::max(replayMs / 1000, 1e-9) << " rows/s\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2 && std::string(argv[1]) == "--write-fixtures") {
+        const std::string dir = argv[2];
+        const bool ok = WriteTrace(dir + "/churn.agtrace", LoadSnapshots(Check::Fixture("churn_snapshots.tsv")))
+                     && WriteTrace(dir + "/steady_3k.agtrace", SteadySnapshots());
+        std::cout << (ok ? "[+] Wrote fixture traces to " : "[!] Could not write fixture traces to ") << dir << "\n";
+        return ok ? 0 : 1;
+    }
+    ChurnFixtureMatchesSource();
+    std::vector<std::string> traces;
+    for (const auto& e : fs::directory_iterator(Check::Fixture("traces"))) {
+        if (e.path().extension() == ".agtrace") traces.push_back(e.path().string());
+    }
+    std::sort(traces.begin(), traces.end());
+    CHECK(traces.size() >= 2);
+    const char* env = std::getenv("APPGATE_TRACE");
+    if (argc > 1) traces.push_back(argv[1]);
+    else if (env && *env) traces.push_back(env);
+    for (const auto& t : traces) Replay(t);
+    return Check::Report("ConnectionTraceBench");
+}
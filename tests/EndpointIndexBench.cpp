@@ -0,0 +1,80 @@
+// EndpointIndexBench.cpp
+// 100k-socket snapshot: index build time, lookup latency against a linear scan, and
+// agreement of both answers
+#include "EndpointIndex.h"
+#include "Check.h"
+#include <cstring>
+
+namespace {
+    ConnRow MakeRow(std::uint32_t i) {
+        ConnRow r;
+        r.pid = 100 + i % 700;
+        r.ipv6 = i % 5 == 0;
+        r.localAddr[0] = 10; r.localAddr[3] = 5;
+        r.localPort = (std::uint16_t)(1024 + i % 60000);
+        // Few remote endpoints, many sockets each: the shape of a busy proxy or browser
+        const std::uint32_t remote = i % 3000;
+        r.remoteAddr[0] = r.ipv6 ? 0x20 : 52;
+        r.remoteAddr[1] = (std::uint8_t)(remote >> 8);
+        r.remoteAddr[2] = (std::uint8_t)remote;
+        r.remoteAddr[15] = r.ipv6 ? 1 : 0;
+        r.remotePort = remote % 3 ? 443 : 80;
+        r.state = 5; // ESTABLISHED
+        return r;
+    }
+
+    std::size_t ScanLocal(const std::vector<ConnRow>& rows, std::uint16_t port) {
+        std::size_t n = 0;
+        for (const auto& r : rows) n += r.localPort == port;
+        return n;
+    }
+
+    std::size_t ScanRemote(const std::vector<ConnRow>& rows, const ConnRow& key) {
+        std::size_t n = 0;
+        for (const auto& r : rows) {
+            n += r.ipv6 == key.ipv6 && r.remotePort == key.remotePort && std::memcmp(r.remoteAddr, key.remoteAddr, key.ipv6 ? 16 : 4) == 0;
+        }
+        return n;
+    }
+}
+
+int main() {
+    const std::uint32_t n = 100000;
+    std::vector<ConnRow> rows;
+    rows.reserve(n);
+    for (std::uint32_t i = 0; i < n; ++i) rows.push_back(MakeRow(i));
+
+    EndpointIndex index;
+    auto start = std::chrono::steady_clock::now();
+    index.Build(rows);
+    const double buildMs = Check::MsSince(start);
+    CHECK(index.Rows().size() == n);
+
+    // Every answer must agree with a linear scan
+    for (std::uint32_t i = 0; i < n; i += 997) {
+        CHECK(index.ByLocalPort(rows[i].localPort).size() == ScanLocal(rows, rows[i].localPort));
+        CHECK(index.ByRemote(rows[i].remoteAddr, rows[i].ipv6, rows[i].remotePort).size() == ScanRemote(rows, rows[i]));
+    }
+    CHECK(index.ByLocalPort(80).empty());
+
+    const int lookups = 100000;
+    std::size_t sink = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; ++i) sink += index.ByLocalPort(rows[(std::uint32_t)i * 7919 % n].localPort).size();
+    const double localUs = Check::MsSince(start) * 1000.0 / lookups;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; ++i) {
+        const ConnRow& r = rows[(std::uint32_t)i * 7919 % n];
+        sink += index.ByRemote(r.remoteAddr, r.ipv6, r.remotePort).size();
+    }
+    const double remoteUs = Check::MsSince(start) * 1000.0 / lookups;
+    const int scans = 100;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < scans; ++i) sink += ScanRemote(rows, rows[(std::uint32_t)i * 7919 % n]);
+    const double scanUs = Check::MsSince(start) * 1000.0 / scans;
+    CHECK(sink > 0);
+
+    std::cout << "[*] " << n << " sockets: build " << buildMs << " ms; ByLocalPort " << localUs
+              << " us, ByRemote " << remoteUs << " us (" << n / 3000 << " matches), linear scan " << scanUs << " us\n";
+    return Check::Report("EndpointIndexBench");
+}
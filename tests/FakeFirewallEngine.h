@@ -0,0 +1,91 @@
+// FakeFirewallEngine.h
+// In-memory FirewallEngine for tests: transactional like WFP, with injectable failures
+#pragma once
+#include "FirewallEngine.h"
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+
+class FakeFirewallEngine : public FirewallEngine {
+public:
+    struct Filter { std::wstring path; FilterSlot slot; };
+
+    // Shared with the test after the engine is handed to a FirewallManager
+    struct State {
+        std::map<std::uint64_t, Filter> filters; // committed filters
+        std::set<std::wstring> failPaths;        // AddBlockFilter fails for these paths
+        bool failOpen = false;
+        bool failCommit = false;
+        std::size_t transactions = 0;            // committed
+        std::size_t aborts = 0;
+        std::size_t adds = 0;                    // AddBlockFilter calls that succeeded
+        std::size_t deletes = 0;                 // DeleteFilter calls that succeeded
+        std::atomic<std::size_t> foreignCalls{0}; // calls from a thread other than Open()'s
+
+        std::size_t FiltersFor(const std::wstring& path) const {
+            std::size_t n = 0;
+            for (const auto& f : filters) n += f.second.path == path;
+            return n;
+        }
+    };
+
+    explicit FakeFirewallEngine(State& state) : state(state) {}
+
+    bool Open() override {
+        owner = std::this_thread::get_id();
+        return !state.failOpen;
+    }
+
+    bool BeginTransaction() override {
+        CheckThread();
+        if (inTransaction) return false;
+        inTransaction = true;
+        staged = state.filters;
+        return true;
+    }
+
+    bool CommitTransaction() override {
+        CheckThread();
+        if (!inTransaction || state.failCommit) return false;
+        inTransaction = false;
+        state.filters.swap(staged);
+        ++state.transactions;
+        return true;
+    }
+
+    void AbortTransaction() override {
+        CheckThread();
+        inTransaction = false;
+        ++state.aborts;
+    }
+
+    bool AddBlockFilter(const std::wstring& path, const std::wstring&, const FilterSlot& slot, std::uint64_t& filterId) override {
+        CheckThread();
+        if (state.failPaths.count(path)) return false;
+        filterId = nextId++;
+        Target()[filterId] = Filter{ path, slot };
+        ++state.adds;
+        return true;
+    }
+
+    bool DeleteFilter(std::uint64_t filterId) override {
+        CheckThread();
+        if (!Target().erase(filterId)) return false;
+        ++state.deletes;
+        return true;
+    }
+
+private:
+    void CheckThread() { if (std::this_thread::get_id() != owner) ++state.foreignCalls; }
+    // Outside a transaction every call commits on its own, as in WFP
+    std::map<std::uint64_t, Filter>& Target() { return inTransaction ? staged : state.filters; }
+
+    State& state;
+    std::thread::id owner;
+    bool inTransaction = false;
+    std::map<std::uint64_t, Filter> staged;
+    std::uint64_t nextId = 1;
+};
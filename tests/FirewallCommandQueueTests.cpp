@@ -0,0 +1,187 @@
+// FirewallCommandQueueTests.cpp
+// Stress and failure tests for the coalescing command queue over the fake engine:
+// concurrent producers, per-request results, superseded requests, the transactional wipe,
+// and engine thread affinity
+#include "FirewallCommandQueue.h"
+#include "FakeFirewallEngine.h"
+#include "Check.h"
+#include <random>
+
+namespace {
+    FirewallCommandQueue::EngineFactory FakeFactory(FakeFirewallEngine::State& state) {
+        return [&state] { return std::make_unique<FakeFirewallEngine>(state); };
+    }
+
+    std::wstring PathOf(int producer, int i) {
+        return L"C:\\P" + std::to_wstring(producer) + L"\\app" + std::to_wstring(i) + L".exe";
+    }
+
+    bool AllTrue(std::vector<std::future<bool>>& futures) {
+        bool ok = true;
+        for (auto& f : futures) ok = f.get() && ok;
+        futures.clear();
+        return ok;
+    }
+
+    void ConcurrentProducers() {
+        // Each producer owns its paths, so per-path order is the producer's program order and
+        // the final state is known: the last request per path wins. Earlier requests may have
+        // been reversed before a flush, so only the last one per path must succeed.
+        const int producers = 4, pathsEach = 64, requestsEach = 5000;
+        FakeFirewallEngine::State state;
+        std::vector<std::vector<bool>> expected(producers, std::vector<bool>(pathsEach, false));
+        std::vector<std::vector<int>> last(producers, std::vector<int>(pathsEach, -1));
+        std::vector<std::vector<std::future<bool>>> futures(producers);
+        auto start = std::chrono::steady_clock::now();
+        {
+            FirewallCommandQueue queue(2, FakeFactory(state));
+            CHECK(queue.Start());
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; ++p) {
+                threads.emplace_back([&, p] {
+                    std::mt19937 rng(p + 1);
+                    for (int r = 0; r < requestsEach; ++r) {
+                        const int i = (int)(rng() % pathsEach);
+                        const bool block = rng() % 3 != 0;
+                        expected[p][i] = block;
+                        last[p][i] = r;
+                        futures[p].push_back(block ? queue.Block(PathOf(p, i)) : queue.Unblock(PathOf(p, i)));
+                        // Pause now and then so the run spans several flush windows
+                        if (r % 1000 == 999) std::this_thread::sleep_for(std::chrono::milliseconds(3));
+                    }
+                });
+            }
+            for (auto& t : threads) t.join();
+            bool ok = true;
+            std::uint64_t failed = 0;
+            for (int p = 0; p < producers; ++p) {
+                std::vector<bool> results;
+                for (auto& f : futures[p]) results.push_back(f.get());
+                for (int i = 0; i < pathsEach; ++i) ok = ok && (last[p][i] < 0 || results[last[p][i]]);
+                for (bool r : results) failed += !r;
+            }
+            CHECK(ok);
+            auto m = queue.Metrics();
+            CHECK(m.submitted == (std::uint64_t)producers * requestsEach);
+            CHECK(m.failedBatches == 0 && m.failedPaths == 0 && m.depth == 0);
+            CHECK(m.batches < m.submitted && m.coalesced > 0);
+            CHECK(m.superseded == failed && m.superseded <= m.coalesced);
+            CHECK(m.maxBatchSize <= (std::size_t)producers * pathsEach);
+            std::cout << "[*] " << m.submitted << " requests from " << producers << " threads: " << m.batches << " transaction(s), "
+                      << m.coalesced << " coalesced (" << m.superseded << " superseded), max batch " << m.maxBatchSize << ", " << Check::MsSince(start) << " ms\n";
+        }
+        std::size_t blocked = 0;
+        bool matches = true;
+        for (int p = 0; p < producers; ++p) {
+            for (int i = 0; i < pathsEach; ++i) {
+                blocked += expected[p][i];
+                matches = matches && state.FiltersFor(PathOf(p, i)) == (expected[p][i] ? 8u : 0u);
+            }
+        }
+        CHECK(matches);
+        CHECK(state.filters.size() == blocked * 8);
+        CHECK(state.foreignCalls == 0);
+    }
+
+    void PerRequestResults() {
+        FakeFirewallEngine::State state;
+        state.failPaths.insert(L"C:\\bad.exe");
+        FirewallCommandQueue queue(100, FakeFactory(state));
+        CHECK(queue.Start());
+        auto good = queue.Block(L"C:\\good.exe");
+        auto bad = queue.Block(L"C:\\bad.exe");
+        auto again = queue.Block(L"C:\\bad.exe"); // coalesced with the failing request
+        auto unblock = queue.Unblock(L"C:\\never-blocked.exe");
+        CHECK(good.get() && !bad.get() && !again.get() && unblock.get());
+        auto m = queue.Metrics();
+        CHECK(m.batches == 1 && m.failedBatches == 0 && m.failedPaths == 1);
+        CHECK(state.FiltersFor(L"C:\\good.exe") == 8 && state.FiltersFor(L"C:\\bad.exe") == 0);
+        // Blocking an already blocked path succeeds without new filters
+        const std::size_t adds = state.adds;
+        CHECK(queue.Block(L"C:\\GOOD.exe").get());
+        CHECK(state.adds == adds);
+    }
+
+    void BlockThenUnblockCoalesces() {
+        FakeFirewallEngine::State state;
+        FirewallCommandQueue queue(100, FakeFactory(state));
+        CHECK(queue.Start());
+        // Reversed within one window: the block never reaches the engine and says so
+        auto block = queue.Block(L"C:\\a.exe");
+        auto unblock = queue.Unblock(L"C:\\A.EXE");
+        CHECK(!block.get() && unblock.get());
+        CHECK(state.filters.empty() && state.adds == 0);
+        // Repeats of one request share its result; only the reversed ones fail
+        auto first = queue.Block(L"C:\\b.exe");
+        auto second = queue.Block(L"C:\\b.exe");
+        auto undo = queue.Unblock(L"C:\\b.exe");
+        auto redo = queue.Block(L"C:\\b.exe");
+        auto redoAgain = queue.Block(L"C:\\B.exe");
+        CHECK(!first.get() && !second.get() && !undo.get() && redo.get() && redoAgain.get());
+        CHECK(state.filters.size() == 8 && state.FiltersFor(L"C:\\B.exe") == 8); // latest spelling
+        auto m = queue.Metrics();
+        CHECK(m.batches == 2 && m.superseded == 4 && m.coalesced == 5);
+    }
+
+    void FailedCommitFailsEveryRequest() {
+        FakeFirewallEngine::State state;
+        FirewallCommandQueue queue(100, FakeFactory(state));
+        CHECK(queue.Start());
+        CHECK(queue.Block(L"C:\\a.exe").get());
+        state.failCommit = true;
+        auto b = queue.Block(L"C:\\b.exe");
+        auto a = queue.Unblock(L"C:\\a.exe");
+        CHECK(!b.get() && !a.get());
+        CHECK(queue.Metrics().failedBatches == 1);
+        CHECK(state.FiltersFor(L"C:\\a.exe") == 8 && state.FiltersFor(L"C:\\b.exe") == 0);
+    }
+
+    void WipeIsTransactional() {
+        FakeFirewallEngine::State state;
+        FirewallCommandQueue queue(100, FakeFactory(state));
+        CHECK(queue.Start());
+        std::vector<std::future<bool>> futures;
+        for (int i = 0; i < 10; ++i) futures.push_back(queue.Block(PathOf(0, i)));
+        CHECK(AllTrue(futures));
+        CHECK(state.filters.size() == 80);
+
+        // A failed wipe reports failure and leaves every filter in place
+        state.failCommit = true;
+        auto superseded = queue.Block(PathOf(0, 99));
+        auto wipe = queue.DeleteAll();
+        CHECK(!wipe.get() && !superseded.get());
+        CHECK(state.filters.size() == 80);
+
+        // Wipe plus a later block: one transaction, only the later block survives. A block
+        // dropped by the wipe is reversed; an unblock dropped by it is carried out by it.
+        state.failCommit = false;
+        const std::size_t transactions = state.transactions;
+        auto dropped = queue.Block(PathOf(1, 1));
+        auto unblocked = queue.Unblock(PathOf(0, 0));
+        wipe = queue.DeleteAll();
+        auto after = queue.Block(PathOf(1, 0));
+        CHECK(wipe.get() && after.get() && !dropped.get() && unblocked.get());
+        CHECK(state.transactions == transactions + 1);
+        CHECK(state.filters.size() == 8 && state.FiltersFor(PathOf(1, 0)) == 8);
+        CHECK(state.foreignCalls == 0);
+    }
+
+    void FailedStart() {
+        FakeFirewallEngine::State state;
+        state.failOpen = true;
+        FirewallCommandQueue queue(1, FakeFactory(state));
+        CHECK(!queue.Start());
+        auto f = queue.Block(L"C:\\a.exe");
+        CHECK(!f.get());
+    }
+}
+
+int main() {
+    ConcurrentProducers();
+    PerRequestResults();
+    BlockThenUnblockCoalesces();
+    FailedCommitFailsEveryRequest();
+    WipeIsTransactional();
+    FailedStart();
+    return Check::Report("FirewallCommandQueueTests");
+}
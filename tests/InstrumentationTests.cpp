@@ -0,0 +1,47 @@
+// InstrumentationTests.cpp
+// Histogram merging across threads, percentile buckets, and block reuse by short-lived threads
+#include "Instrumentation.h"
+#include "Check.h"
+#include <thread>
+#include <vector>
+
+namespace {
+    const Instrumentation::ProbeSummary* Find(const std::vector<Instrumentation::ProbeSummary>& all, const std::string& name) {
+        for (const auto& s : all) if (s.name == name) return &s;
+        return nullptr;
+    }
+
+    void Percentiles() {
+        const int probe = Instrumentation::RegisterProbe("Percentiles");
+        CHECK(probe >= 0 && Instrumentation::RegisterProbe("Percentiles") == probe);
+        for (std::uint64_t i = 1; i <= 1000; ++i) Instrumentation::Record(probe, i * 1000); // 1..1000 us
+        const auto* s = Find(Instrumentation::Snapshot(), "Percentiles");
+        CHECK(s && s->count == 1000 && s->maxNs == 1000000);
+        // Buckets are ~12.5% wide and report their lower bound
+        CHECK(s && s->p50Ns > 500000 * 0.87 && s->p50Ns <= 501000);
+        CHECK(s && s->p99Ns > 990000 * 0.87 && s->p99Ns <= 991000);
+    }
+
+    void ShortLivedThreadsReuseBlocks() {
+        const int probe = Instrumentation::RegisterProbe("Workers");
+        const unsigned width = 4, rounds = 50, samples = 100;
+        // Like Utils::ParallelFor: a fresh set of threads on every call
+        for (unsigned r = 0; r < rounds; ++r) {
+            std::vector<std::thread> pool;
+            for (unsigned t = 0; t < width; ++t) {
+                pool.emplace_back([&] { for (unsigned i = 0; i < samples; ++i) Instrumentation::Record(probe, 100 + i); });
+            }
+            for (auto& t : pool) t.join();
+        }
+        // The main thread's block plus one per concurrently live worker, not one per thread ever started
+        CHECK(Instrumentation::ThreadBlocks() <= 1 + width);
+        const auto* s = Find(Instrumentation::Snapshot(), "Workers");
+        CHECK(s && s->count == (std::uint64_t)width * rounds * samples);
+    }
+}
+
+int main() {
+    Percentiles();
+    ShortLivedThreadsReuseBlocks();
+    return Check::Report("InstrumentationTests");
+}
@@ -0,0 +1,99 @@
+// LnkParserTests.cpp
+// The .lnk parser over the fixture corpus (tests/fixtures/lnk, see make_corpus.py): extracted
+// target, arguments and working directory per expected.tsv, rejection of broken files, and
+// every truncation of every shortcut staying in bounds. A directory of real shortcuts
+// (a copy of a Start Menu, say) can be given as argv[1] or APPGATE_LNK_CORPUS; every .lnk
+// in it must parse.
+#include "LnkParser.h"
+#include "Utils.h"
+#include "Check.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::vector<std::uint8_t> ReadAll(const fs::path& file) {
+        std::ifstream in(file, std::ios::binary);
+        return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    std::vector<std::string> SplitTabs(const std::string& line) {
+        std::vector<std::string> fields;
+        std::istringstream in(line);
+        for (std::string f; std::getline(in, f, '\t'); ) fields.push_back(f);
+        if (!line.empty() && line.back() == '\t') fields.emplace_back();
+        return fields;
+    }
+
+    void Corpus() {
+        std::ifstream in(Check::Fixture("lnk/expected.tsv"));
+        CHECK(in.good());
+        std::size_t files = 0;
+        for (std::string line; std::getline(in, line); ) {
+            if (line.empty() || line[0] == '#') continue;
+            auto f = SplitTabs(line);
+            CHECK(f.size() == 6);
+            if (f.size() != 6) continue;
+            ++files;
+            const auto data = ReadAll(Check::Fixture("lnk/" + f[0]));
+            CHECK(!data.empty());
+            ShellLink link;
+            const bool ok = ParseShellLink(data.data(), data.size(), link);
+            if (ok != (f[1] == "1")) { std::cout << "[!] " << f[0] << ": parse result " << ok << "\n"; CHECK(false); continue; }
+            if (!ok) continue;
+            const bool match = link.Target() == Utils::Utf8ToWide(f[2]) && link.advertised == (f[3] == "1")
+                && link.arguments.ToWide() == Utils::Utf8ToWide(f[4]) && link.workingDir.ToWide() == Utils::Utf8ToWide(f[5]);
+            if (!match) std::cout << "[!] " << f[0] << ": got target '" << Utils::WideToUtf8(link.Target()) << "'\n";
+            CHECK(match);
+        }
+        CHECK(files == 12);
+    }
+
+    // Cutting a shortcut anywhere must never read past the cut; a cut inside the header,
+    // IDList, LinkInfo or StringData must be rejected
+    void Truncations() {
+        for (const auto& entry : fs::directory_iterator(Check::Fixture("lnk"))) {
+            if (entry.path().extension() != ".lnk") continue;
+            const auto data = ReadAll(entry.path());
+            ShellLink full;
+            if (!ParseShellLink(data.data(), data.size(), full)) continue;
+            for (std::size_t n = 0; n < data.size(); ++n) {
+                std::vector<std::uint8_t> cut(data.begin(), data.begin() + n); // exact size, so overreads are visible to sanitizers
+                ShellLink link;
+                const bool ok = ParseShellLink(cut.data(), cut.size(), link);
+                if (n < 0x4C) CHECK(!ok);
+                if (ok && !link.basePath.Empty()) CHECK(link.basePath.data >= cut.data() && link.basePath.data < cut.data() + cut.size());
+            }
+        }
+    }
+
+    void RealCorpus(const std::string& dir) {
+        std::size_t total = 0, rejected = 0, advertised = 0, withTarget = 0;
+        for (const auto& entry : fs::recursive_directory_iterator(dir, fs::directory_options::skip_permission_denied)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".lnk") continue;
+            ++total;
+            const auto data = ReadAll(entry.path());
+            ShellLink link;
+            if (!ParseShellLink(data.data(), data.size(), link)) { ++rejected; std::cout << "[!] rejected " << entry.path().string() << "\n"; continue; }
+            if (link.advertised) ++advertised;
+            else if (!link.Target().empty()) ++withTarget;
+        }
+        CHECK(rejected == 0);
+        std::cout << "[*] " << dir << ": " << total << " shortcut(s), " << withTarget << " with a target, "
+                  << advertised << " advertised, " << rejected << " rejected\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    Corpus();
+    Truncations();
+    const char* env = std::getenv("APPGATE_LNK_CORPUS");
+    if (argc > 1) RealCorpus(argv[1]);
+    else if (env && *env) RealCorpus(env);
+    return Check::Report("LnkParserTests");
+}
@@ -0,0 +1,78 @@
+// PeVersionBench.cpp
+// ReadPeVersionStrings over a PE corpus held in memory, on one thread and on all of them
+// (Utils::ParallelFor, as InstalledAppsManager runs it). The corpus is tests/fixtures/pe
+// unless a directory of real executables is given as argv[1] or APPGATE_PE_CORPUS, e.g.
+// a copy of C:\Windows\System32 or a Wine prefix.
+#include "PeVersion.h"
+#include "Utils.h"
+#include "Check.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    bool IsPeName(const fs::path& p) {
+        std::string ext = p.extension().string();
+        for (auto& c : ext) c = (char)std::tolower((unsigned char)c);
+        return ext == ".exe" || ext == ".dll" || ext == ".sys" || ext == ".ocx" || ext == ".cpl";
+    }
+
+    std::vector<std::vector<std::uint8_t>> LoadCorpus(const std::string& dir, std::size_t maxFiles) {
+        std::vector<std::vector<std::uint8_t>> files;
+        for (const auto& e : fs::recursive_directory_iterator(dir, fs::directory_options::skip_permission_denied)) {
+            if (files.size() >= maxFiles) break;
+            std::error_code ec;
+            if (!e.is_regular_file(ec) || !IsPeName(e.path()) || e.file_size(ec) > (64u << 20)) continue;
+            std::ifstream in(e.path(), std::ios::binary);
+            files.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        return files;
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* env = std::getenv("APPGATE_PE_CORPUS");
+    const std::string dir = argc > 1 ? argv[1] : (env && *env) ? env : Check::Fixture("pe");
+    const auto corpus = LoadCorpus(dir, 20000);
+    CHECK(!corpus.empty());
+    if (corpus.empty()) return Check::Report("PeVersionBench");
+    std::size_t bytes = 0;
+    for (const auto& f : corpus) bytes += f.size();
+
+    // Enough passes for about 200k parses, so a small corpus still gives stable numbers
+    const std::size_t passes = std::max<std::size_t>(1, 200000 / corpus.size());
+    std::size_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t p = 0; p < passes; ++p) {
+        for (const auto& f : corpus) {
+            PeVersionStrings s;
+            if (ReadPeVersionStrings(f.data(), f.size(), s) && !s.productName.Empty()) ++hits;
+        }
+    }
+    const double serialMs = Check::MsSince(start);
+    hits /= passes;
+
+    std::atomic<std::size_t> parallelHits{0};
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    start = std::chrono::steady_clock::now();
+    Utils::ParallelFor(corpus.size() * passes, threads, [&](std::size_t i) {
+        const auto& f = corpus[i % corpus.size()];
+        PeVersionStrings s;
+        if (ReadPeVersionStrings(f.data(), f.size(), s) && !s.productName.Empty()) parallelHits.fetch_add(1, std::memory_order_relaxed);
+    });
+    const double parallelMs = Check::MsSince(start);
+    CHECK(parallelHits == hits * passes);
+
+    const double parses = (double)corpus.size() * passes;
+    std::cout << "[*] " << dir << ": " << corpus.size() << " file(s), " << bytes / 1024 << " KB, " << hits << " with a ProductName\n";
+    std::cout << "[*] " << passes << " pass(es): " << serialMs * 1e6 / parses << " ns/file on 1 thread, "
+              << parallelMs * 1e6 / parses << " ns/file on " << threads << "\n";
+    return Check::Report("PeVersionBench");
+}
@@ -0,0 +1,122 @@
+// PeVersionFuzz.cpp
+// Fuzz target for the PE version-resource reader. Built with -DAPPGATE_LIBFUZZER=ON (clang)
+// it is a libFuzzer target: run it on tests/fixtures/pe as the seed corpus. Otherwise the
+// standalone driver below checks the seeds against expected.tsv and then replays a fixed
+// number of seeded mutations (header-, tail- and uniformly-placed byte writes and cuts),
+// so every ctest run covers the same inputs.
+//   PeVersionFuzz [iterations] [extra seed file or directory]...
+#include "PeVersion.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+    PeVersionStrings s;
+    if (!ReadPeVersionStrings(data, size, s)) return 0;
+    // Every view must lie inside the input; reading it through ToWide lets the sanitizers
+    // see any overrun
+    for (const Utf16View* v : { &s.productName, &s.fileDescription, &s.companyName, &s.fileVersion }) {
+        if (v->Empty()) continue;
+        if (v->data < data || (std::size_t)(v->data - data) + (std::size_t)v->length * 2 > size) std::abort();
+        volatile std::size_t n = v->ToWide().size();
+        (void)n;
+    }
+    return 0;
+}
+
+#ifndef APPGATE_LIBFUZZER
+#include "Utils.h"
+#include "Check.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::vector<std::uint8_t> ReadAll(const fs::path& file) {
+        std::ifstream in(file, std::ios::binary);
+        return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // Runs one input from an exact-size heap copy, so a read one past the end is an overrun
+    void RunOne(const std::vector<std::uint8_t>& input) {
+        std::unique_ptr<std::uint8_t[]> copy(new std::uint8_t[input.size() ? input.size() : 1]);
+        if (!input.empty()) std::memcpy(copy.get(), input.data(), input.size());
+        LLVMFuzzerTestOneInput(copy.get(), input.size());
+    }
+
+    void CheckSeeds() {
+        std::ifstream in(Check::Fixture("pe/expected.tsv"));
+        CHECK(in.good());
+        std::size_t files = 0;
+        for (std::string line; std::getline(in, line); ) {
+            if (line.empty() || line[0] == '#') continue;
+            std::vector<std::string> f;
+            std::istringstream fields(line);
+            for (std::string x; std::getline(fields, x, '\t'); ) f.push_back(x);
+            f.resize(6);
+            ++files;
+            const auto data = ReadAll(Check::Fixture("pe/" + f[0]));
+            PeVersionStrings s;
+            const bool ok = ReadPeVersionStrings(data.data(), data.size(), s);
+            const bool match = ok == (f[1] == "1") && s.productName.ToWide() == Utils::Utf8ToWide(f[2])
+                && s.fileDescription.ToWide() == Utils::Utf8ToWide(f[3]) && s.companyName.ToWide() == Utils::Utf8ToWide(f[4])
+                && s.fileVersion.ToWide() == Utils::Utf8ToWide(f[5]);
+            if (!match) std::cout << "[!] " << f[0] << ": parsed " << ok << ", ProductName '" << Utils::WideToUtf8(s.productName.ToWide()) << "'\n";
+            CHECK(match);
+        }
+        CHECK(files == 10);
+    }
+
+    void AddSeeds(const fs::path& p, std::vector<std::vector<std::uint8_t>>& seeds) {
+        if (fs::is_directory(p)) {
+            for (const auto& e : fs::recursive_directory_iterator(p, fs::directory_options::skip_permission_denied)) {
+                const auto ext = e.path().extension().string();
+                if (e.is_regular_file() && ext != ".tsv" && ext != ".py" && e.file_size() <= (4u << 20)) seeds.push_back(ReadAll(e.path()));
+            }
+        } else if (fs::is_regular_file(p)) {
+            seeds.push_back(ReadAll(p));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    CheckSeeds();
+    const long iterations = argc > 1 ? std::atol(argv[1]) : 20000;
+    std::vector<std::vector<std::uint8_t>> seeds;
+    AddSeeds(Check::Fixture("pe"), seeds);
+    for (int i = 2; i < argc; ++i) AddSeeds(argv[i], seeds);
+    seeds.erase(std::remove_if(seeds.begin(), seeds.end(), [](const std::vector<std::uint8_t>& s) { return s.empty(); }), seeds.end());
+    CHECK(!seeds.empty());
+    if (seeds.empty()) return Check::Report("PeVersionFuzz");
+
+    std::mt19937_64 rng(0xA99A7E);
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        auto input = seeds[rng() % seeds.size()];
+        const int mutations = 1 + (int)(rng() % 16);
+        for (int m = 0; m < mutations && !input.empty(); ++m) {
+            // Headers and the resource data (near the end of these images) are where the
+            // offsets live, so two thirds of the writes go there
+            const std::size_t n = input.size();
+            const std::size_t pos = (rng() % 3 == 0) ? rng() % std::min<std::size_t>(n, 1024)
+                                  : (rng() % 2 == 0) ? n - 1 - rng() % std::min<std::size_t>(n, 4096) : rng() % n;
+            switch (rng() % 4) {
+                case 0: input[pos] = (std::uint8_t)rng(); break;
+                case 1: input[pos] ^= (std::uint8_t)(1u << (rng() % 8)); break;
+                case 2: { const std::uint32_t v = (std::uint32_t)rng(); if (pos + 4 <= n) std::memcpy(&input[pos], &v, 4); break; }
+                case 3: input.resize(pos); break;
+            }
+        }
+        RunOne(input);
+    }
+    std::cout << "[*] " << iterations << " mutated inputs from " << seeds.size() << " seed(s) in " << Check::MsSince(start) << " ms\n";
+    return Check::Report("PeVersionFuzz");
+}
+#endif
@@ -0,0 +1,211 @@
+// PolicyApplyTests.cpp
+// Policy-file parsing, the add/remove diff and diff-based apply against the fake engine:
+// one transaction, unchanged filters untouched, re-apply a no-op, failed commits roll back,
+// and the blocked-paths callback
+#include "FirewallManager.h"
+#include "FakeFirewallEngine.h"
+#include "Check.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+    std::string WritePolicy(const std::string& name, const std::string& text) {
+        const std::string file = (std::filesystem::temp_directory_path() / ("appgate_" + name)).string();
+        std::ofstream(file, std::ios::binary) << text;
+        return file;
+    }
+
+    bool Contains(const std::string& s, const std::string& part) { return s.find(part) != std::string::npos; }
+
+    std::set<std::uint64_t> FilterIds(const std::map<std::uint64_t, FakeFirewallEngine::Filter>& filters, const std::wstring& path) {
+        std::set<std::uint64_t> ids;
+        for (const auto& f : filters) if (f.second.path == path) ids.insert(f.first);
+        return ids;
+    }
+
+    void Parse() {
+        const std::string file = WritePolicy("parse.txt",
+            "\xEF\xBB\xBF# comment\r\n"
+            "block C:\\Tools\\a.exe\r\n"
+            "\r\n"
+            "   C:\\Tools\\b.exe   \r\n"
+            "\"C:\\Program Files\\c.exe\"\r\n"
+            "\\\\server\\share\\d.exe\r\n"
+            "prefix C:\\Games\\\r\n"
+            "block \"C:\\Program Files\\e.exe\"\n");
+        PolicyDocument doc;
+        std::string error;
+        CHECK(LoadPolicyFile(file, doc, error));
+        CHECK(doc.paths.size() == 5 && doc.prefixes.size() == 1);
+        CHECK(doc.paths.size() == 5 && doc.paths[0] == L"C:\\Tools\\a.exe" && doc.paths[1] == L"C:\\Tools\\b.exe");
+        CHECK(doc.paths.size() == 5 && doc.paths[2] == L"C:\\Program Files\\c.exe" && doc.paths[4] == L"C:\\Program Files\\e.exe");
+        CHECK(doc.paths.size() == 5 && doc.paths[3] == L"\\\\server\\share\\d.exe");
+        CHECK(doc.prefixes.size() == 1 && doc.prefixes[0] == L"C:\\Games\\");
+        std::remove(file.c_str());
+    }
+
+    void ParseErrors() {
+        PolicyDocument doc;
+        std::string error;
+        const std::string verb = WritePolicy("verb.txt", "block C:\\a.exe\nblok C:\\b.exe\n");
+        CHECK(!LoadPolicyFile(verb, doc, error));
+        CHECK(Contains(error, verb + ":2: unknown verb 'blok'"));
+        const std::string missing = WritePolicy("missing.txt", "# empty block\nprefix\n");
+        CHECK(!LoadPolicyFile(missing, doc, error));
+        CHECK(Contains(error, missing + ":2: missing path"));
+        CHECK(!LoadPolicyFile(verb + ".absent", doc, error));
+        CHECK(Contains(error, "cannot open"));
+        std::remove(verb.c_str());
+        std::remove(missing.c_str());
+    }
+
+    void Diff() {
+        auto diff = ComputePolicyDiff({ L"C:\\A.exe", L"c:\\b.exe", L"C:\\B.EXE", L"C:\\new.exe" }, { L"c:\\a.exe", L"C:\\B.exe", L"C:\\old.exe", L"C:\\old.exe" });
+        CHECK(diff.unchanged == 2);
+        CHECK(diff.addPaths.size() == 1 && diff.addPaths[0] == L"C:\\new.exe");
+        CHECK(diff.removePaths.size() == 1 && diff.removePaths[0] == L"C:\\old.exe");
+    }
+
+    void ApplyDiffInOneTransaction() {
+        FakeFirewallEngine::State state;
+        FirewallManager fm(std::make_unique<FakeFirewallEngine>(state));
+        CHECK(fm.Initialize());
+        CHECK(fm.BlockProcessByPathW(L"C:\\keep.exe") && fm.BlockProcessByPathW(L"C:\\drop.exe"));
+        CHECK(state.FiltersFor(L"C:\\keep.exe") == 8 && state.filters.size() == 16);
+        const auto keepIds = FilterIds(state.filters, L"C:\\keep.exe");
+        const std::size_t addsBefore = state.adds, transactionsBefore = state.transactions;
+
+        PolicyDocument policy;
+        policy.paths = { L"C:\\KEEP.exe", L"C:\\new.exe" };
+        PolicyDiff diff;
+        CHECK(fm.ApplyPolicy(policy, {}, diff));
+        CHECK(diff.addPaths.size() == 1 && diff.removePaths.size() == 1 && diff.unchanged == 1);
+        CHECK(state.transactions == transactionsBefore + 1);
+        CHECK(state.adds == addsBefore + 8 && state.deletes == 8);
+        CHECK(FilterIds(state.filters, L"C:\\keep.exe") == keepIds); // never deleted and re-added
+        CHECK(state.FiltersFor(L"C:\\drop.exe") == 0 && state.FiltersFor(L"C:\\new.exe") == 8);
+        CHECK(fm.ListRules().size() == 16);
+
+        // Re-applying the same policy finds nothing to do
+        const std::size_t adds = state.adds, deletes = state.deletes;
+        CHECK(fm.ApplyPolicy(policy, {}, diff));
+        CHECK(diff.addPaths.empty() && diff.removePaths.empty() && diff.unchanged == 2);
+        CHECK(state.adds == adds && state.deletes == deletes);
+    }
+
+    void DryRunChangesNothing() {
+        FakeFirewallEngine::State state;
+        FirewallManager fm(std::make_unique<FakeFirewallEngine>(state));
+        CHECK(fm.Initialize());
+        CHECK(fm.BlockProcessByPathW(L"C:\\a.exe"));
+        PolicyDocument policy;
+        policy.paths = { L"C:\\b.exe" };
+        PolicyDiff diff;
+        CHECK(fm.ApplyPolicy(policy, {}, diff, true));
+        CHECK(diff.addPaths.size() == 1 && diff.removePaths.size() == 1);
+        CHECK(state.FiltersFor(L"C:\\a.exe") == 8 && state.filters.size() == 8 && state.transactions == 0);
+    }
+
+    void FailedCommitRollsBack() {
+        FakeFirewallEngine::State state;
+        FirewallManager fm(std::make_unique<FakeFirewallEngine>(state));
+        CHECK(fm.Initialize());
+        CHECK(fm.BlockProcessByPathW(L"C:\\a.exe"));
+        const auto before = state.filters;
+        const auto rulesBefore = fm.ListRules();
+        state.failCommit = true;
+        PolicyDocument policy;
+        policy.paths = { L"C:\\b.exe" };
+        policy.prefixes = { L"C:\\Games\\" };
+        PolicyDiff diff;
+        CHECK(!fm.ApplyPolicy(policy, { { L"Game", L"C:\\Games\\g.exe", L"Filesystem", false } }, diff));
+        CHECK(state.aborts == 1);
+        CHECK(state.filters.size() == before.size() && FilterIds(state.filters, L"C:\\a.exe") == FilterIds(before, L"C:\\a.exe"));
+        CHECK(fm.ListRules().size() == rulesBefore.size() && fm.ListRules().front().processPath == "C:\\a.exe");
+        CHECK(fm.ListPrefixRules().empty()); // the prefix rules of a failed policy are not adopted
+    }
+
+    void PrefixesExpandFromInventory() {
+        FakeFirewallEngine::State state;
+        FirewallManager fm(std::make_unique<FakeFirewallEngine>(state));
+        CHECK(fm.Initialize());
+        PolicyDocument policy;
+        policy.prefixes = { L"C:\\Games\\" };
+        std::vector<ApplicationInfo> inventory = {
+            { L"G1", L"C:\\Games\\one.exe", L"Filesystem", false },
+            { L"G2", L"C:\\Games\\sub\\two.exe", L"Filesystem", false },
+            { L"Other", L"C:\\Tools\\x.exe", L"Filesystem", false },
+        };
+        PolicyDiff diff;
+        CHECK(fm.ApplyPolicy(policy, inventory, diff));
+        CHECK(diff.addPaths.size() == 2 && state.transactions == 1);
+        CHECK(state.FiltersFor(L"C:\\Games\\sub\\two.exe") == 8 && state.FiltersFor(L"C:\\Tools\\x.exe") == 0);
+        CHECK(fm.ListPrefixRules().size() == 1);
+    }
+
+    void BlockedCallbackSeesOnlyNewFilters() {
+        FakeFirewallEngine::State state;
+        FirewallManager fm(std::make_unique<FakeFirewallEngine>(state));
+        std::vector<std::wstring> seen;
+        fm.SetBlockedCallback([&seen](const std::vector<std::wstring>& paths) { seen.insert(seen.end(), paths.begin(), paths.end()); });
+        CHECK(fm.Initialize());
+        CHECK(fm.BlockProcessByPathW(L"C:\\a.exe"));
+        CHECK(seen == std::vector<std::wstring>{ L"C:\\a.exe" });
+        seen.clear();
+        state.failPaths.insert(L"C:\\bad.exe");
+        CHECK(fm.BlockPathsW({ L"C:\\A.EXE", L"C:\\b.exe", L"C:\\bad.exe" }) == 1);
+        CHECK(seen == std::vector<std::wstring>{ L"C:\\b.exe" }); // not the already blocked or failed ones
+        seen.clear();
+        state.failCommit = true;
+        CHECK(fm.BlockPathsW({ L"C:\\c.exe" }) == -1);
+        CHECK(seen.empty()); // nothing is reported for an aborted transaction
+    }
+
+    void LargePolicy() {
+        // 50k paths on disk, half of them already blocked: parse, diff and apply the other half
+        const int n = 50000;
+        std::string text;
+        for (int i = 0; i < n; ++i) text += "block C:\\Apps\\Vendor" + std::to_string(i % 97) + "\\app" + std::to_string(i) + ".exe\n";
+        const std::string file = WritePolicy("large.txt", text);
+        FakeFirewallEngine::State state;
+        FirewallManager fm(std::make_unique<FakeFirewallEngine>(state));
+        CHECK(fm.Initialize());
+        PolicyDocument half;
+        std::string error;
+        CHECK(LoadPolicyFile(file, half, error));
+        half.paths.resize(n / 2);
+        PolicyDiff diff;
+        CHECK(fm.ApplyPolicy(half, {}, diff));
+
+        auto start = std::chrono::steady_clock::now();
+        PolicyDocument policy;
+        CHECK(LoadPolicyFile(file, policy, error));
+        const double loadMs = Check::MsSince(start);
+        start = std::chrono::steady_clock::now();
+        CHECK(fm.ApplyPolicy(policy, {}, diff, true));
+        const double diffMs = Check::MsSince(start);
+        start = std::chrono::steady_clock::now();
+        const std::size_t deletes = state.deletes;
+        CHECK(fm.ApplyPolicy(policy, {}, diff));
+        const double applyMs = Check::MsSince(start);
+        CHECK(diff.addPaths.size() == (std::size_t)n / 2 && diff.unchanged == (std::size_t)n / 2);
+        CHECK(state.deletes == deletes && state.filters.size() == (std::size_t)n * 8);
+        std::cout << "[*] " << n << "-path policy: load " << loadMs << " ms, diff " << diffMs << " ms, apply "
+                  << n / 2 << " additions " << applyMs << " ms\n";
+        std::remove(file.c_str());
+    }
+}
+
+int main() {
+    Parse();
+    ParseErrors();
+    Diff();
+    ApplyDiffInOneTransaction();
+    DryRunChangesNothing();
+    FailedCommitRollsBack();
+    PrefixesExpandFromInventory();
+    BlockedCallbackSeesOnlyNewFilters();
+    LargePolicy();
+    return Check::Report("PolicyApplyTests");
+}
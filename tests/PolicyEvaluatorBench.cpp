@@ -0,0 +1,91 @@
+// PolicyEvaluatorBench.cpp
+// What-if verdicts: correctness on a small rule set, then one million queries against 50k
+// blocked apps (400k filters) and an audit of a 100k-entry inventory
+#include "PolicyEvaluator.h"
+#include "Check.h"
+#include "Utils.h"
+#include <random>
+
+namespace {
+    const std::uint8_t kTcp = 6, kUdp = 17;
+
+    // The 8 filters FirewallManager adds per blocked path, minus the slots in skipMask
+    void AddRules(std::vector<RuleEntry>& rules, const std::string& path, std::uint8_t skipMask = 0) {
+        for (int bit = 0; bit < 8; ++bit) {
+            if (skipMask & (1u << bit)) continue;
+            RuleEntry r;
+            r.serial = (int)rules.size() + 1;
+            r.processPath = path;
+            r.outbound = !(bit & 4);
+            r.ipv6 = (bit & 2) != 0;
+            r.protocol = (bit & 1) ? kUdp : kTcp;
+            r.filterId = rules.size() + 1000;
+            rules.push_back(r);
+        }
+    }
+
+    std::string AppPath(std::size_t i) { return "C:\\Program Files\\Vendor" + std::to_string(i % 97) + "\\App" + std::to_string(i) + "\\app.exe"; }
+
+    void Verdicts() {
+        std::vector<RuleEntry> rules;
+        AddRules(rules, "C:\\Tools\\Full.exe");
+        AddRules(rules, "C:\\Tools\\Partial.exe", 0xF0); // outbound only
+        PolicyEvaluator eval;
+        eval.Compile(rules);
+        CHECK(eval.RuleCount() == 12 && eval.AppCount() == 2);
+        CHECK(eval.Coverage(L"c:/tools/full.EXE") == BlockCoverage::Full);
+        CHECK(eval.Coverage(L"C:\\Tools\\Partial.exe") == BlockCoverage::Partial);
+        CHECK(eval.IsBlocked(L"C:\\Tools\\Partial.exe", true, true, kUdp));
+        CHECK(!eval.IsBlocked(L"C:\\Tools\\Partial.exe", false, true, kUdp));
+        CHECK(!eval.IsBlocked(L"C:\\Tools\\Full.exe", true, false, 1)); // ICMP is never filtered
+        CHECK(eval.Coverage(L"C:\\Tools\\Other.exe") == BlockCoverage::None);
+        std::vector<ApplicationInfo> apps(3);
+        apps[0].exePath = L"C:\\Tools\\Full.exe";
+        apps[1].exePath = L"C:\\TOOLS\\partial.exe";
+        apps[2].exePath = L"C:\\Tools\\Other.exe";
+        auto audit = eval.Audit(apps);
+        CHECK(audit.size() == 3 && audit[0].coverage == BlockCoverage::Full && audit[1].coverage == BlockCoverage::Partial && audit[2].coverage == BlockCoverage::None);
+    }
+
+    void Benchmark() {
+        const std::size_t kApps = 50000, kQueries = 1000000, kDistinctQueries = 100000, kInventory = 100000;
+        std::vector<RuleEntry> rules;
+        rules.reserve(kApps * 8);
+        for (std::size_t i = 0; i < kApps; ++i) AddRules(rules, AppPath(i), i % 10 == 0 ? 0x0F : 0); // every 10th inbound-only
+        PolicyEvaluator eval;
+        auto start = std::chrono::steady_clock::now();
+        eval.Compile(rules);
+        std::cout << "[*] Compile " << rules.size() << " filters (" << eval.AppCount() << " apps): " << Check::MsSince(start) << " ms\n";
+        CHECK(eval.AppCount() == kApps);
+
+        // Half the query paths are blocked apps, half are not; spelled as callers pass them
+        std::vector<std::wstring> paths;
+        paths.reserve(kDistinctQueries);
+        for (std::size_t i = 0; i < kDistinctQueries; ++i) paths.push_back(Utils::Utf8ToWide(AppPath(i % 2 ? i + kApps : i)));
+        std::mt19937 rng(42);
+        std::size_t blocked = 0;
+        start = std::chrono::steady_clock::now();
+        for (std::size_t q = 0; q < kQueries; ++q) {
+            const std::uint32_t r = rng();
+            blocked += eval.IsBlocked(paths[r % kDistinctQueries], (r >> 20) & 1, (r >> 21) & 1, (r >> 22) & 1 ? kUdp : kTcp);
+        }
+        const double ms = Check::MsSince(start);
+        std::cout << "[*] " << kQueries << " IsBlocked queries: " << ms << " ms (" << ms * 1e6 / kQueries << " ns/query), " << blocked << " blocked\n";
+        CHECK(blocked > kQueries / 5 && blocked < kQueries / 2);
+
+        std::vector<ApplicationInfo> inventory(kInventory);
+        for (std::size_t i = 0; i < kInventory; ++i) inventory[i].exePath = Utils::Utf8ToWide(AppPath(i));
+        start = std::chrono::steady_clock::now();
+        auto audit = eval.Audit(inventory);
+        std::size_t full = 0, partial = 0;
+        for (const auto& v : audit) { full += v.coverage == BlockCoverage::Full; partial += v.coverage == BlockCoverage::Partial; }
+        std::cout << "[*] Audit " << kInventory << " apps: " << Check::MsSince(start) << " ms (" << full << " full, " << partial << " partial)\n";
+        CHECK(full == kApps - kApps / 10 && partial == kApps / 10);
+    }
+}
+
+int main() {
+    Verdicts();
+    Benchmark();
+    return Check::Report("PolicyEvaluatorBench");
+}
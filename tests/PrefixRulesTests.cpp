@@ -0,0 +1,83 @@
+// PrefixRulesTests.cpp
+// Prefix-rule expansion and ownership against the fake engine: rejected patterns, failed
+// paths retried, no duplicate filters, explicit blocks surviving UnblockPrefix
+#include "FirewallManager.h"
+#include "FakeFirewallEngine.h"
+#include "Check.h"
+
+namespace {
+    ApplicationInfo App(const std::wstring& path) { return { L"app", path, L"Filesystem", false }; }
+
+    void Matching() {
+        PrefixRuleSet set;
+        CHECK(set.AddRule(L"C:\\Games\\"));
+        CHECK(set.AddRule(L"D:\\Tools\\*.exe"));
+        CHECK(!set.AddRule(L"c:\\games\\")); // duplicate after case folding
+        CHECK(set.Matches(L"C:\\GAMES\\a\\b\\c.exe"));
+        CHECK(set.Matches(L"D:\\Tools\\x.exe") && !set.Matches(L"D:\\Tools\\sub\\x.exe") && !set.Matches(L"D:\\Tools\\x.dll"));
+        CHECK(!set.Matches(L"C:\\Gamesx\\a.exe"));
+    }
+
+    void RejectedPatternKeepsTargets() {
+        FakeFirewallEngine::State state;
+        FirewallManager fm(std::make_unique<FakeFirewallEngine>(state));
+        CHECK(fm.Initialize());
+        std::vector<ApplicationInfo> inventory = { App(L"C:\\Games\\a.exe") };
+        CHECK(fm.BlockPrefixW(L"C:\\Games\\", inventory) == 1);
+        CHECK(fm.BlockPrefixW(L"C:\\Games\\", inventory) == -1); // duplicate
+        inventory.push_back(App(L"C:\\Games\\b.exe"));
+        // The new path is still offered to the existing rule after the rejected one
+        CHECK(fm.ExpandPrefixRules(inventory) == 1);
+        CHECK(state.FiltersFor(L"C:\\Games\\b.exe") == 8);
+    }
+
+    void FailedPathIsRetried() {
+        FakeFirewallEngine::State state;
+        FirewallManager fm(std::make_unique<FakeFirewallEngine>(state));
+        CHECK(fm.Initialize());
+        std::vector<ApplicationInfo> inventory = { App(L"C:\\Games\\a.exe"), App(L"C:\\Games\\b.exe") };
+        state.failPaths.insert(L"C:\\Games\\b.exe");
+        CHECK(fm.BlockPrefixW(L"C:\\Games\\", inventory) == 1);
+        CHECK(state.transactions == 1 && state.FiltersFor(L"C:\\Games\\b.exe") == 0);
+        state.failPaths.clear();
+        CHECK(fm.ExpandPrefixRules(inventory) == 1);
+        CHECK(state.FiltersFor(L"C:\\Games\\a.exe") == 8 && state.FiltersFor(L"C:\\Games\\b.exe") == 8);
+        CHECK(fm.ExpandPrefixRules(inventory) == 0 && state.filters.size() == 16); // nothing added twice
+    }
+
+    void ExplicitBlocksSurviveUnblockPrefix() {
+        FakeFirewallEngine::State state;
+        FirewallManager fm(std::make_unique<FakeFirewallEngine>(state));
+        CHECK(fm.Initialize());
+        CHECK(fm.BlockProcessByPathW(L"C:\\Games\\before.exe"));
+        std::vector<ApplicationInfo> inventory = { App(L"C:\\Games\\before.exe"), App(L"C:\\Games\\after.exe"), App(L"C:\\Games\\rule.exe") };
+        CHECK(fm.BlockPrefixW(L"C:\\Games\\", inventory) == 2);
+        CHECK(state.FiltersFor(L"C:\\Games\\before.exe") == 8); // not duplicated
+        // Blocked explicitly after the rule expanded it: ownership moves to the explicit block
+        CHECK(fm.BlockProcessByPathW(L"C:\\Games\\after.exe"));
+        CHECK(state.FiltersFor(L"C:\\Games\\after.exe") == 8);
+        CHECK(fm.UnblockPrefixW(L"C:\\Games\\") == 1);
+        CHECK(state.FiltersFor(L"C:\\Games\\rule.exe") == 0);
+        CHECK(state.FiltersFor(L"C:\\Games\\before.exe") == 8 && state.FiltersFor(L"C:\\Games\\after.exe") == 8);
+        CHECK(fm.UnblockPrefixW(L"C:\\Games\\") == -1);
+    }
+
+    void FailedUnblockKeepsFilters() {
+        FakeFirewallEngine::State state;
+        FirewallManager fm(std::make_unique<FakeFirewallEngine>(state));
+        CHECK(fm.Initialize());
+        CHECK(fm.BlockPrefixW(L"C:\\Games\\", { App(L"C:\\Games\\a.exe") }) == 1);
+        state.failCommit = true;
+        CHECK(fm.UnblockPrefixW(L"C:\\Games\\") == 0);
+        CHECK(state.FiltersFor(L"C:\\Games\\a.exe") == 8 && fm.ListRules().size() == 8);
+    }
+}
+
+int main() {
+    Matching();
+    RejectedPatternKeepsTargets();
+    FailedPathIsRetried();
+    ExplicitBlocksSurviveUnblockPrefix();
+    FailedUnblockKeepsFilters();
+    return Check::Report("PrefixRulesTests");
+}
@@ -0,0 +1,138 @@
+// ProcessTreeTests.cpp
+// Builds ProcessTree from a fixture snapshot (recycled parent PIDs, unknown creation times,
+// cycles) and, on Linux, from a live /proc snapshot; times Build + Subtree at 50k processes
+#include "ProcessTree.h"
+#include "Check.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Fixture format: see tests/fixtures/process_tree.tsv
+    std::vector<ProcessNode> LoadFixture(const std::string& file) {
+        std::vector<ProcessNode> nodes;
+        std::ifstream in(file);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream fields(line);
+            std::string pid, parent, created;
+            ProcessNode node;
+            std::getline(fields, pid, '\t');
+            std::getline(fields, parent, '\t');
+            std::getline(fields, created, '\t');
+            std::getline(fields, node.name, '\t');
+            std::getline(fields, node.path, '\t');
+            node.pid = std::stoi(pid);
+            node.parentPid = std::stoi(parent);
+            node.createTime = std::stoull(created);
+            nodes.push_back(node);
+        }
+        return nodes;
+    }
+
+    std::vector<int> Pids(const std::vector<const ProcessNode*>& nodes) {
+        std::vector<int> pids;
+        for (const auto* n : nodes) pids.push_back(n->pid);
+        return pids;
+    }
+
+    void Fixture() {
+        ProcessTree tree;
+        tree.Build(LoadFixture(Check::Fixture("process_tree.tsv")));
+        CHECK(tree.Size() == 12);
+        CHECK((Pids(tree.Subtree(1000)) == std::vector<int>{ 1000, 1010, 1030, 1020, 1040 })); // breadth-first
+        CHECK(tree.Find(1040) && tree.Find(1040)->path.empty());
+        CHECK(Pids(tree.Children(1010)) == std::vector<int>{ 1020 });
+        // 2010's parent exited and PID 2000 was reused by a process that started later
+        CHECK(Pids(tree.Subtree(2000)) == std::vector<int>{ 2000 });
+        CHECK(Pids(tree.Subtree(2010)) == std::vector<int>{ 2010 });
+        // Idle points at itself; the cycle terminates
+        CHECK(Pids(tree.Subtree(0)).size() == 3 + 5 + 1); // 0, 4, 600, the launcher tree and 2000, not 2010
+        auto cycle = Pids(tree.Subtree(3000));
+        CHECK((cycle == std::vector<int>{ 3000, 3010 }));
+        CHECK(tree.Subtree(12345).empty() && !tree.Find(12345));
+    }
+
+#ifdef __linux__
+    // A real snapshot: /proc/<pid>/stat gives the parent PID and the start time (clock ticks
+    // since boot), which plays the part of the Windows creation time
+    std::vector<ProcessNode> SnapshotProc() {
+        std::vector<ProcessNode> nodes;
+        DIR* dir = opendir("/proc");
+        if (!dir) return nodes;
+        while (dirent* e = readdir(dir)) {
+            if (!std::all_of(e->d_name, e->d_name + std::char_traits<char>::length(e->d_name), ::isdigit)) continue;
+            std::ifstream stat(std::string("/proc/") + e->d_name + "/stat");
+            std::string text;
+            if (!std::getline(stat, text)) continue; // exited meanwhile
+            std::size_t open = text.find('('), close = text.rfind(')');
+            if (open == std::string::npos || close == std::string::npos) continue;
+            ProcessNode node;
+            node.pid = std::stoi(text.substr(0, open));
+            node.name = text.substr(open + 1, close - open - 1);
+            std::istringstream rest(text.substr(close + 2));
+            std::string field;
+            for (int i = 3; i <= 22 && rest >> field; ++i) {
+                if (i == 4) node.parentPid = std::stoi(field);
+                if (i == 22) node.createTime = std::stoull(field);
+            }
+            char exe[4096];
+            ssize_t n = readlink((std::string("/proc/") + e->d_name + "/exe").c_str(), exe, sizeof(exe));
+            if (n > 0) node.path.assign(exe, (std::size_t)n);
+            nodes.push_back(node);
+        }
+        closedir(dir);
+        return nodes;
+    }
+
+    void LiveProc() {
+        auto snapshot = SnapshotProc();
+        if (snapshot.empty()) { std::cout << "[*] /proc not readable, live snapshot skipped\n"; return; }
+        ProcessTree tree;
+        tree.Build(std::move(snapshot));
+        const int self = (int)getpid(), parent = (int)getppid();
+        CHECK(tree.Find(self) && !tree.Find(self)->path.empty());
+        auto pids = Pids(tree.Subtree(parent));
+        CHECK(std::find(pids.begin(), pids.end(), self) != pids.end());
+        std::cout << "[*] /proc snapshot: " << tree.Size() << " processes\n";
+    }
+#endif
+
+    void Scale() {
+        // 50k processes, each the child of a random earlier one
+        const int n = 50000;
+        std::vector<ProcessNode> nodes(n);
+        std::uint32_t seed = 12345;
+        for (int i = 0; i < n; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            nodes[i].pid = (i + 1) * 4;
+            nodes[i].parentPid = i ? nodes[seed % i].pid : 0;
+            nodes[i].createTime = 1000 + i;
+            nodes[i].name = "p" + std::to_string(i) + ".exe";
+        }
+        auto start = std::chrono::steady_clock::now();
+        ProcessTree tree;
+        tree.Build(std::move(nodes));
+        const double buildMs = Check::MsSince(start);
+        start = std::chrono::steady_clock::now();
+        auto all = tree.Subtree(4);
+        const double subtreeMs = Check::MsSince(start);
+        CHECK(all.size() == (std::size_t)n);
+        std::cout << "[*] " << n << " processes: Build " << buildMs << " ms, Subtree(root) " << subtreeMs << " ms\n";
+    }
+}
+
+int main() {
+    Fixture();
+#ifdef __linux__
+    LiveProc();
+#endif
+    Scale();
+    return Check::Report("ProcessTreeTests");
+}
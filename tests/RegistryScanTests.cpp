@@ -0,0 +1,283 @@
+// RegistryScanTests.cpp
+// Incremental uninstall-key discovery over a fixture hive (tests/fixtures/uninstall_hive.reg)
+// and a fake filesystem: unchanged keys are not reopened, changed and removed keys are
+// picked up, a resolved entry follows its executable disappearing and an unresolved one is
+// retried only when its install directory changes
+#include "RegistryScan.h"
+#include "Check.h"
+#include <algorithm>
+#include <atomic>
+#include <cwctype>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace {
+    const wchar_t* const kRootNames[] = {
+        L"HKEY_LOCAL_MACHINE\\SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall",
+        L"HKEY_LOCAL_MACHINE\\SOFTWARE\\WOW6432Node\\Microsoft\\Windows\\CurrentVersion\\Uninstall",
+        L"HKEY_CURRENT_USER\\SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall",
+    };
+
+    struct FixtureKey {
+        std::uint64_t lastWrite = 1;
+        UninstallValues values;
+    };
+
+    // Uninstall roots loaded from a REGEDIT4 export. Keys may be edited between refreshes,
+    // never during one.
+    class FixtureHive : public RegistryKeySource {
+    public:
+        std::map<std::wstring, FixtureKey> roots[3];
+        std::set<std::wstring> failReads; // ReadValues fails for these subkeys
+        std::atomic<std::size_t> reads{0};
+        std::mutex mutex;
+        std::set<std::thread::id> threads; // every thread a source method ran on
+
+        std::size_t RootCount() const override { return 3; }
+        bool ListSubkeys(std::size_t root, std::vector<RegistrySubkey>& out) override {
+            Seen();
+            for (const auto& kv : roots[root]) out.push_back({kv.first, kv.second.lastWrite});
+            return true;
+        }
+        bool ReadValues(std::size_t root, const std::wstring& subkey, UninstallValues& out) override {
+            Seen();
+            ++reads;
+            auto it = roots[root].find(subkey);
+            if (it == roots[root].end() || failReads.count(subkey)) return false;
+            out = it->second.values;
+            return true;
+        }
+
+        void Seen() { std::lock_guard<std::mutex> lock(mutex); threads.insert(std::this_thread::get_id()); }
+    };
+
+    // "..." with \\ and \" escapes, as regedit writes string values
+    std::wstring RegString(const std::string& s, std::size_t& pos) {
+        std::string out;
+        for (++pos; pos < s.size() && s[pos] != '"'; ++pos) {
+            if (s[pos] == '\\' && pos + 1 < s.size()) ++pos;
+            out += s[pos];
+        }
+        ++pos;
+        return std::wstring(out.begin(), out.end()); // the fixture is ASCII
+    }
+
+    bool LoadHive(const std::string& file, FixtureHive& hive) {
+        std::ifstream in(file);
+        if (!in) return false;
+        std::string line;
+        FixtureKey* key = nullptr;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.size() > 2 && line.front() == '[' && line.back() == ']') {
+                const std::wstring path(line.begin() + 1, line.end() - 1);
+                key = nullptr;
+                for (std::size_t r = 0; r < 3; ++r) {
+                    const std::wstring prefix = std::wstring(kRootNames[r]) + L"\\";
+                    if (path.compare(0, prefix.size(), prefix) == 0) key = &hive.roots[r][path.substr(prefix.size())];
+                }
+                continue;
+            }
+            if (!key || line.empty() || line[0] != '"') continue;
+            std::size_t pos = 0;
+            const std::wstring name = RegString(line, pos);
+            if (pos >= line.size() || line[pos] != '=' || pos + 1 >= line.size() || line[pos + 1] != '"') continue; // dword etc.
+            ++pos;
+            const std::wstring value = RegString(line, pos);
+            if (name == L"DisplayName") key->values.displayName = value;
+            else if (name == L"DisplayIcon") key->values.displayIcon = value;
+            else if (name == L"InstallLocation") key->values.installLocation = value;
+            else if (name == L"UninstallString") key->values.uninstallString = value;
+        }
+        return true;
+    }
+
+    // Files plus directory last-write times; Insert and Erase move the parent directory's
+    // time the way creating or deleting a file does
+    struct FakeFiles {
+        std::mutex mutex;
+        std::set<std::wstring> files;
+        std::map<std::wstring, std::uint64_t> dirs;
+        std::uint64_t clock = 0;
+        std::atomic<std::size_t> lookups{0};
+        bool Exists(const std::wstring& path) {
+            ++lookups;
+            std::lock_guard<std::mutex> lock(mutex);
+            return files.count(path) != 0;
+        }
+        std::uint64_t DirWriteTime(std::wstring dir) {
+            while (!dir.empty() && dir.back() == L'\\') dir.pop_back();
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = dirs.find(dir);
+            return it == dirs.end() ? 0 : it->second;
+        }
+        void Insert(const std::wstring& path) { files.insert(path); Touch(path); }
+        void Erase(const std::wstring& path) { files.erase(path); Touch(path); }
+        void Touch(const std::wstring& path) { dirs[path.substr(0, path.rfind(L'\\'))] = ++clock; }
+    };
+
+    bool EndsWithExe(const std::wstring& p) {
+        if (p.size() < 4) return false;
+        std::wstring ext = p.substr(p.size() - 4);
+        for (auto& c : ext) c = (wchar_t)std::towlower(c);
+        return ext == L".exe";
+    }
+
+    // The candidate order of InstalledAppsManager's resolver (DisplayIcon or UninstallString,
+    // then <InstallLocation>\<DisplayName>.exe), with its shell path helpers reduced to
+    // unquoting, dropping arguments after a quoted path and the ",N" icon index
+    std::wstring Candidate(std::wstring p) {
+        if (!p.empty() && p[0] == L'"') { auto end = p.find(L'"', 1); p = p.substr(1, end == std::wstring::npos ? std::wstring::npos : end - 1); }
+        auto comma = p.rfind(L',');
+        if (comma != std::wstring::npos && comma + 1 < p.size() && std::all_of(p.begin() + comma + 1, p.end(), ::iswdigit)) p.erase(comma);
+        return p;
+    }
+
+    RegistryScan::Resolver MakeResolver(FakeFiles& fs, std::atomic<std::size_t>& calls) {
+        return [&fs, &calls](const UninstallValues& v, ApplicationInfo& app) {
+            ++calls;
+            if (v.displayName.empty()) return false;
+            std::wstring exe = Candidate(!v.displayIcon.empty() ? v.displayIcon : v.uninstallString);
+            if (!exe.empty() && !EndsWithExe(exe)) exe.clear();
+            if (exe.empty() && !v.installLocation.empty()) {
+                std::wstring dir = v.installLocation;
+                while (!dir.empty() && dir.back() == L'\\') dir.pop_back();
+                exe = dir + L"\\" + v.displayName + L".exe";
+            }
+            if (exe.empty() || !fs.Exists(exe)) return false;
+            app = {v.displayName, exe, L"Registry", false};
+            return true;
+        };
+    }
+
+    RegistryScan::DirWriteTime MakeDirWriteTime(FakeFiles& fs) {
+        return [&fs](const std::wstring& dir) { return fs.DirWriteTime(dir); };
+    }
+
+    std::set<std::wstring> Paths(const std::vector<ApplicationInfo>& apps) {
+        std::set<std::wstring> paths;
+        for (const auto& a : apps) paths.insert(a.exePath);
+        return paths;
+    }
+
+    const std::wstring kGit = L"C:\\Program Files\\Git\\Git.exe";
+    const std::wstring kSevenZip = L"C:\\Program Files\\7-Zip\\7zFM.exe";
+    const std::wstring kFoo = L"C:\\Tools\\Foo\\FooTool.exe";
+    const std::wstring kNotepad = L"C:\\Program Files (x86)\\Notepad++\\notepad++.exe";
+    const std::wstring kDiscord = L"C:\\Users\\me\\AppData\\Local\\Discord\\Discord.exe";
+    const std::wstring kLate = L"C:\\Late\\LateApp.exe";
+
+    void FixtureHiveRefreshes() {
+        FixtureHive hive;
+        CHECK(LoadHive(Check::Fixture("uninstall_hive.reg"), hive));
+        CHECK(hive.roots[0].size() == 4 && hive.roots[1].size() == 2 && hive.roots[2].size() == 1);
+        CHECK(hive.roots[2][L"Discord"].values.uninstallString == L"\"C:\\Users\\me\\AppData\\Local\\Discord\\Update.exe\" --uninstall");
+        FakeFiles fs;
+        fs.files = { kGit, kSevenZip, kFoo, kNotepad, kDiscord, L"C:\\Program Files\\Git\\unins000.exe" };
+        std::atomic<std::size_t> resolves{0};
+        RegistryScan scan(hive, MakeResolver(fs, resolves), [&fs](const std::wstring& p) { return fs.Exists(p); }, MakeDirWriteTime(fs));
+
+        // First listing opens every key; the SystemComponent entry (no name) and LateApp
+        // (not installed yet) do not resolve
+        std::vector<ApplicationInfo> apps;
+        scan.Refresh(apps);
+        CHECK(scan.LastStats().subkeys == 7 && scan.LastStats().reread == 7 && hive.reads == 7);
+        CHECK(Paths(apps) == (std::set<std::wstring>{ kGit, kSevenZip, kFoo, kNotepad, kDiscord }));
+        CHECK(hive.threads.size() == 3); // one thread per root
+
+        // Nothing changed: no key is reopened and nothing is resolved again, including the
+        // two entries that did not resolve
+        const std::size_t firstResolves = resolves;
+        apps.clear();
+        scan.Refresh(apps);
+        CHECK(scan.LastStats().reread == 0 && scan.LastStats().reresolved == 0 && hive.reads == 7 && resolves == firstResolves);
+        CHECK(apps.size() == 5);
+
+        // An unrelated directory changing does not wake LateApp
+        fs.Insert(L"C:\\Elsewhere\\LateApp.exe");
+        scan.Refresh(apps);
+        CHECK(scan.LastStats().reresolved == 0);
+
+        // Filesystem changes under unchanged keys: Git's guessed executable is removed and
+        // LateApp's appears in its install directory. Both follow without reopening their keys.
+        fs.Erase(kGit);
+        fs.Insert(kLate);
+        apps.clear();
+        scan.Refresh(apps);
+        CHECK(hive.reads == 7 && scan.LastStats().reresolved == 2);
+        CHECK(Paths(apps) == (std::set<std::wstring>{ kSevenZip, kFoo, kNotepad, kDiscord, kLate }));
+
+        // A changed key is reread, a deleted one dropped
+        auto& zip = hive.roots[0][L"7-Zip"];
+        zip.values.displayIcon = L"C:\\Program Files\\7-Zip\\7zG.exe";
+        zip.lastWrite = 2;
+        fs.files.insert(zip.values.displayIcon);
+        hive.roots[1].erase(L"Notepad++");
+        apps.clear();
+        scan.Refresh(apps);
+        CHECK(scan.LastStats().reread == 1 && scan.LastStats().removed == 1 && scan.LastStats().subkeys == 6 && hive.reads == 8);
+        CHECK(scan.LastStats().reresolved == 0); // Git, now unresolved, waits for its directory
+        CHECK(Paths(apps) == (std::set<std::wstring>{ L"C:\\Program Files\\7-Zip\\7zG.exe", kFoo, kDiscord, kLate }));
+    }
+
+    void FailedReadIsRetried() {
+        FixtureHive hive;
+        CHECK(LoadHive(Check::Fixture("uninstall_hive.reg"), hive));
+        FakeFiles fs;
+        fs.files = { kFoo };
+        std::atomic<std::size_t> resolves{0};
+        RegistryScan scan(hive, MakeResolver(fs, resolves), [&fs](const std::wstring& p) { return fs.Exists(p); }, MakeDirWriteTime(fs));
+        hive.failReads.insert(L"FooTool");
+        std::vector<ApplicationInfo> apps;
+        scan.Refresh(apps);
+        CHECK(apps.empty());
+        hive.failReads.clear();
+        const std::size_t reads = hive.reads;
+        scan.Refresh(apps);
+        CHECK(scan.LastStats().reread == 1 && hive.reads == reads + 1); // only the failed key
+        CHECK(apps.size() == 1 && apps[0].exePath == kFoo);
+    }
+
+    void LargeHive() {
+        // 30k uninstall keys spread over the three roots, one in ten with no executable yet;
+        // a repeat listing touches no key and resolves nothing again
+        const std::size_t n = 30000;
+        FixtureHive hive;
+        FakeFiles fs;
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::wstring name = L"App" + std::to_wstring(i);
+            FixtureKey key;
+            key.values.displayName = name;
+            if (i % 10 == 0) {
+                key.values.installLocation = L"C:\\Apps\\" + name + L"\\";
+            } else {
+                key.values.displayIcon = L"C:\\Apps\\" + name + L"\\" + name + L".exe,0";
+                fs.Insert(L"C:\\Apps\\" + name + L"\\" + name + L".exe");
+            }
+            hive.roots[i % 3][name] = key;
+        }
+        std::atomic<std::size_t> resolves{0};
+        RegistryScan scan(hive, MakeResolver(fs, resolves), [&fs](const std::wstring& p) { return fs.Exists(p); }, MakeDirWriteTime(fs));
+        std::vector<ApplicationInfo> apps;
+        auto start = std::chrono::steady_clock::now();
+        scan.Refresh(apps);
+        const double firstMs = Check::MsSince(start);
+        CHECK(apps.size() == n - n / 10);
+        apps.clear();
+        start = std::chrono::steady_clock::now();
+        scan.Refresh(apps);
+        const double repeatMs = Check::MsSince(start);
+        CHECK(apps.size() == n - n / 10 && hive.reads == n && resolves == n && scan.LastStats().reread == 0);
+        std::cout << "[*] " << n << " uninstall keys: first listing " << firstMs << " ms, repeat " << repeatMs << " ms\n";
+    }
+}
+
+int main() {
+    FixtureHiveRefreshes();
+    FailedReadIsRetried();
+    LargeHive();
+    return Check::Report("RegistryScanTests");
+}
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+# make_corpus.py
+# Writes the .lnk corpus for LnkParserTests. Each file follows the byte layout of MS-SHLLINK
+# and mirrors a shortcut as Windows writes it (Explorer, MSI, a network share, an old
+# ANSI shortcut...), including the IDList and ExtraData blocks the parser has to skip.
+# expected.tsv lists what the parser must extract. Run from any directory; output goes
+# next to this script.
+import os
+import struct
+import uuid
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+LINK_CLSID = uuid.UUID("00021401-0000-0000-C000-000000000046").bytes_le
+
+HasLinkTargetIDList, HasLinkInfo, HasName, HasRelativePath = 0x1, 0x2, 0x4, 0x8
+HasWorkingDir, HasArguments, HasIconLocation, IsUnicode = 0x10, 0x20, 0x40, 0x80
+HasExpString, HasDarwinID, EnableTargetMetadata = 0x200, 0x1000, 0x80000
+
+FILETIME = struct.pack("<Q", 133000000000000000)  # 2022-06-18
+
+
+def header(flags, attrs=0x20, size=0):
+    return (struct.pack("<I", 0x4C) + LINK_CLSID + struct.pack("<II", flags, attrs) + FILETIME * 3
+            + struct.pack("<IiIHHII", size, 0, 1, 0, 0, 0, 0))
+
+
+def idlist(items):
+    body = b"".join(struct.pack("<H", len(i) + 2) + i for i in items) + b"\0\0"
+    return struct.pack("<H", len(body)) + body
+
+
+def root_item(clsid):  # shell root folder item (My Computer, Network...)
+    return b"\x1f\x50" + uuid.UUID(clsid).bytes_le
+
+
+def drive_item(letter):
+    return b"\x2f" + (letter + ":\\").encode() + b"\0" * 19
+
+
+def file_item(name, folder):
+    short = name.encode("ascii", "replace")[:12] + b"\0"
+    if len(short) % 2:
+        short += b"\0"
+    return bytes([0x31 if folder else 0x32, 0]) + struct.pack("<IHHH", 0, 0x5A52, 0x7A31, 0x10 if folder else 0x20) + short
+
+
+def cstr(s, unicode):
+    return s.encode("utf-16-le") + b"\0\0" if unicode else s.encode("cp1252", "replace") + b"\0"
+
+
+def volume_id(label=""):
+    body = struct.pack("<III", 3, 0x1A2B3C4D, 0x10) + cstr(label, False)
+    return struct.pack("<I", 4 + len(body)) + body
+
+
+def link_info(local=None, suffix="", net=None, unicode_local=None, unicode_suffix=None):
+    extended = unicode_local is not None or unicode_suffix is not None
+    hsize = 0x24 if extended else 0x1C
+    parts, offsets = b"", {}
+
+    def put(key, data):
+        nonlocal parts
+        offsets[key] = hsize + len(parts)
+        parts += data
+
+    flags = 0
+    if local is not None:
+        flags |= 1
+        put("vol", volume_id())
+        put("local", cstr(local, False))
+    if net is not None:
+        flags |= 2
+        name = cstr(net, False)
+        cnrl = struct.pack("<IIIII", 0x14 + len(name), 2, 0x14, 0, 0x20000) + name
+        put("net", cnrl)
+    put("suffix", cstr(suffix, False))
+    if unicode_local is not None:
+        put("ulocal", cstr(unicode_local, True))
+    put("usuffix", cstr(unicode_suffix or "", True)) if extended else None
+    head = struct.pack("<IIIIIII", 0, hsize, flags, offsets.get("vol", 0), offsets.get("local", 0),
+                       offsets.get("net", 0), offsets["suffix"])
+    if extended:
+        head += struct.pack("<II", offsets.get("ulocal", 0), offsets.get("usuffix", 0))
+    blob = head + parts
+    return struct.pack("<I", len(blob)) + blob[4:]
+
+
+def string_data(strings, unicode):
+    out = b""
+    for s in strings:
+        out += struct.pack("<H", len(s)) + (s.encode("utf-16-le") if unicode else s.encode("cp1252"))
+    return out
+
+
+def env_block(sig, target):
+    ansi = target.encode("cp1252").ljust(260, b"\0")
+    wide = target.encode("utf-16-le").ljust(520, b"\0")
+    return struct.pack("<II", 0x314, sig) + ansi + wide
+
+
+def special_folder():
+    return struct.pack("<IIII", 0x10, 0xA0000005, 0x26, 0x0C)
+
+
+def known_folder():
+    return struct.pack("<II", 0x1C, 0xA000000B) + uuid.UUID("905e63b6-c1bf-494e-b29c-65b732d3d21a").bytes_le + struct.pack("<I", 0x0C)
+
+
+def tracker(machine):
+    droid = uuid.uuid5(uuid.NAMESPACE_DNS, machine).bytes_le * 2
+    return struct.pack("<IIII", 0x60, 0xA0000003, 0x58, 0) + machine.encode().ljust(16, b"\0") + droid * 2
+
+
+def property_store():
+    value = struct.pack("<IIB", 0x15, 4, 0) + struct.pack("<HHI", 0x13, 0, 1) + b"\0" * 4
+    store = struct.pack("<I", 0) + b"1SPS" + uuid.UUID("b725f130-47ef-101a-a5f1-02608c9eebac").bytes_le + value + struct.pack("<I", 0)
+    store = struct.pack("<I", len(store)) + store[4:]
+    body = store + struct.pack("<I", 0)
+    return struct.pack("<II", 8 + len(body), 0xA0000009) + body
+
+
+END = struct.pack("<I", 0)
+MY_COMPUTER = "20d04fe0-3aea-1069-a2d8-08002b30309d"
+NETWORK = "208d2c60-3aea-1069-a2d7-08002b30309d"
+
+
+def corpus():
+    firefox = "C:\\Program Files\\Mozilla Firefox\\firefox.exe"
+    yield "explorer_local.lnk", (
+        header(HasLinkTargetIDList | HasLinkInfo | HasRelativePath | HasWorkingDir | HasIconLocation | IsUnicode | EnableTargetMetadata)
+        + idlist([root_item(MY_COMPUTER), drive_item("C"), file_item("Program Files", True), file_item("Mozilla Firefox", True), file_item("firefox.exe", False)])
+        + link_info(local=firefox)
+        + string_data(["..\\..\\..\\..\\..\\Program Files\\Mozilla Firefox\\firefox.exe", "C:\\Program Files\\Mozilla Firefox", firefox], True)
+        + special_folder() + known_folder() + property_store() + tracker("desktop-4k2") + END
+    ), dict(target=firefox, workdir="C:\\Program Files\\Mozilla Firefox")
+
+    wide = "C:\\Users\\Zoë\\AppData\\Local\\Programs\\Ünïcode App\\app.exe"
+    yield "unicode_linkinfo.lnk", (
+        header(HasLinkTargetIDList | HasLinkInfo | HasName | HasWorkingDir | IsUnicode)
+        + idlist([root_item(MY_COMPUTER), drive_item("C"), file_item("Users", True), file_item("app.exe", False)])
+        + link_info(local="C:\\Users\\ZOE~1\\APPDATA\\LOCAL\\PROGRA~1\\NICODE~1\\app.exe", unicode_local=wide)
+        + string_data(["Ünïcode App", "C:\\Users\\Zoë\\AppData\\Local\\Programs\\Ünïcode App"], True)
+        + tracker("zoe-laptop") + END
+    ), dict(target=wide, workdir="C:\\Users\\Zoë\\AppData\\Local\\Programs\\Ünïcode App")
+
+    yield "network_share.lnk", (
+        header(HasLinkTargetIDList | HasLinkInfo | HasArguments | IsUnicode)
+        + idlist([root_item(NETWORK), file_item("fileserver", True), file_item("tools", True), file_item("tool.exe", False)])
+        + link_info(net="\\\\fileserver\\tools", suffix="bin\\tool.exe")
+        + string_data(["--profile work"], True)
+        + END
+    ), dict(target="\\\\fileserver\\tools\\bin\\tool.exe", args="--profile work")
+
+    yield "env_target.lnk", (
+        header(HasLinkTargetIDList | HasArguments | HasExpString | HasIconLocation | IsUnicode)
+        + idlist([root_item(MY_COMPUTER), drive_item("C"), file_item("Windows", True), file_item("System32", True), file_item("cmd.exe", False)])
+        + string_data(["/k echo hi", "%windir%\\system32\\cmd.exe"], True)
+        + env_block(0xA0000001, "%windir%\\system32\\cmd.exe") + special_folder() + END
+    ), dict(target="%windir%\\system32\\cmd.exe", args="/k echo hi")
+
+    yield "msi_advertised.lnk", (
+        header(HasLinkTargetIDList | HasName | HasIconLocation | IsUnicode | HasDarwinID)
+        + idlist([root_item(MY_COMPUTER)])
+        + string_data(["Office App", "C:\\Windows\\Installer\\{90160000-0011-0000-1000-0000000FF1CE}\\icon.exe"], True)
+        + env_block(0xA0000006, "w_1^VX!!!!!!!!!MKKSkEXCELFiles>tW{~$4Q]c@II=l2xaTO5Z") + property_store() + END
+    ), dict(advertised=1)
+
+    yield "ansi_legacy.lnk", (
+        header(HasLinkInfo | HasName | HasRelativePath | HasArguments)
+        + link_info(local="C:\\LEGACY\\TOOL.EXE")
+        + string_data(["Legacy tool", ".\\TOOL.EXE", "-x"], False)
+        + END
+    ), dict(target="C:\\LEGACY\\TOOL.EXE", args="-x")
+
+    yield "base_and_suffix.lnk", (
+        header(HasLinkInfo | HasWorkingDir | IsUnicode)
+        + link_info(local="C:\\Apps\\", suffix="Vendor\\app.exe")
+        + string_data(["C:\\Apps\\Vendor"], True)
+        + END
+    ), dict(target="C:\\Apps\\Vendor\\app.exe", workdir="C:\\Apps\\Vendor")
+
+    yield "idlist_only.lnk", (
+        header(HasLinkTargetIDList | IsUnicode)
+        + idlist([root_item("4234d49b-0245-4df3-b780-3893943456e1"), b"\x00" * 40])
+        + property_store() + END
+    ), dict()
+
+    # Not shortcuts, or broken ones
+    yield "not_a_link.lnk", b"[InternetShortcut]\r\nURL=https://example.com/\r\n", dict(ok=0)
+    bad = bytearray(header(HasLinkInfo) + link_info(local="C:\\a.exe") + END)
+    bad[4] ^= 0xFF
+    yield "bad_clsid.lnk", bytes(bad), dict(ok=0)
+    cut = header(HasLinkInfo | IsUnicode) + link_info(local="C:\\Program Files\\cut\\cut.exe")
+    yield "truncated_linkinfo.lnk", cut[:len(cut) - 12], dict(ok=0)
+    yield "truncated_idlist.lnk", header(HasLinkTargetIDList) + struct.pack("<H", 0x400) + b"\0" * 16, dict(ok=0)
+
+
+def main():
+    rows = ["# file\tok\ttarget\tadvertised\targuments\tworking dir"]
+    for name, data, expect in corpus():
+        with open(os.path.join(HERE, name), "wb") as f:
+            f.write(data)
+        rows.append("\t".join([name, str(expect.get("ok", 1)), expect.get("target", ""), str(expect.get("advertised", 0)),
+                               expect.get("args", ""), expect.get("workdir", "")]))
+    with open(os.path.join(HERE, "expected.tsv"), "w", encoding="utf-8", newline="\n") as f:
+        f.write("\n".join(rows) + "\n")
+
+
+if __name__ == "__main__":
+    main()
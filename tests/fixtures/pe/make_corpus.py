@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+# make_corpus.py
+# Writes the PE corpus for PeVersionFuzz and PeVersionBench: small images laid out as a
+# linker writes them (DOS stub, COFF and optional headers, section table, .rsrc with a
+# type/name/language directory tree and a VS_VERSIONINFO resource), plus broken ones.
+# expected.tsv lists the strings ReadPeVersionStrings must return. Output goes next to
+# this script.
+import os
+import struct
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+FILE_ALIGN, SECTION_ALIGN = 0x200, 0x1000
+
+
+def utf16z(s):
+    return s.encode("utf-16-le") + b"\0\0"
+
+
+def pad4(b):
+    return b + b"\0" * (-len(b) % 4)
+
+
+def block(key, value=b"", text=False, children=()):
+    """One version block; offsets are relative to the resource start, which is 4-aligned."""
+    head = struct.pack("<HHH", 0, len(value) // 2 if text else len(value), 1 if text else 0) + utf16z(key)
+    body = pad4(head) + value
+    for child in children:
+        body = pad4(body) + child
+    return struct.pack("<H", len(body)) + body[2:]
+
+
+def version_info(tables, translations):
+    fixed = struct.pack("<13I", 0xFEEF04BD, 0x10000, 0x10002, 0x30004, 0x10002, 0x30004, 0x3F, 0, 0x40004, 1, 0, 0, 0)
+    children = []
+    if tables:
+        children.append(block("StringFileInfo", children=[
+            block(code, children=[block(k, utf16z(v), True) for k, v in strings]) for code, strings in tables]))
+    if translations is not None:
+        children.append(block("VarFileInfo", children=[
+            block("Translation", b"".join(struct.pack("<HH", lang, cp) for lang, cp in translations))]))
+    return block("VS_VERSION_INFO", fixed, children=children)
+
+
+def resource_section(rva, resources):
+    """resources: list of (type, [(name, lang, data)]); type/name are ints or strings."""
+    # Layout: root, type and name directories, language directories, data entries, name
+    # strings, then the resource data itself
+    def directory(entries):
+        named = [e for e in entries if isinstance(e[0], str)]
+        ids = sorted((e for e in entries if not isinstance(e[0], str)), key=lambda e: e[0])
+        return named + ids
+
+    root = directory([(t, items) for t, items in resources])
+    tree = []  # each directory is 16 bytes plus 8 per entry
+    for t, items in root:
+        names = {}
+        for name, lang, blob in items:
+            names.setdefault(name, []).append((lang, blob))
+        tree.append((t, directory(list(names.items()))))
+    offset = 16 + 8 * len(tree)
+    type_dirs = []
+    for t, names in tree:
+        type_dirs.append(offset)
+        offset += 16 + 8 * len(names)
+    name_dirs = []
+    for t, names in tree:
+        row = []
+        for name, langs in names:
+            row.append(offset)
+            offset += 16 + 8 * len(langs)
+        name_dirs.append(row)
+    data_entry_start = offset
+    count = sum(len(langs) for _, names in tree for _, langs in names)
+    string_start = data_entry_start + 16 * count
+    labels = [k for t, names in tree for k in [t] + [n for n, _ in names] if isinstance(k, str)]
+    string_offsets, strings = {}, b""
+    for label in labels:
+        string_offsets[label] = string_start + len(strings)
+        strings += struct.pack("<H", len(label)) + label.encode("utf-16-le")
+    blob_start = string_start + len(pad4(strings))
+
+    def entry(key, target, subdir):
+        name = (0x80000000 | string_offsets[key]) if isinstance(key, str) else key
+        return struct.pack("<II", name, target | (0x80000000 if subdir else 0))
+
+    def dir_header(entries):
+        n = sum(isinstance(e, str) for e in entries)
+        return struct.pack("<IIHHHH", 0, 0, 4, 0, n, len(entries) - n)
+
+    out = dir_header([t for t, _ in tree]) + b"".join(entry(t, type_dirs[i], True) for i, (t, _) in enumerate(tree))
+    for i, (t, names) in enumerate(tree):
+        out += dir_header([n for n, _ in names]) + b"".join(entry(n, name_dirs[i][j], True) for j, (n, _) in enumerate(names))
+    de_index, lang_dirs = 0, b""
+    for i, (t, names) in enumerate(tree):
+        for j, (n, langs) in enumerate(names):
+            lang_dirs += dir_header([l for l, _ in langs])
+            for lang, blob in langs:
+                lang_dirs += entry(lang, data_entry_start + 16 * de_index, False)
+                de_index += 1
+    out += lang_dirs
+    assert len(out) == data_entry_start
+    entries, blobs = b"", b""
+    for _, names in tree:
+        for _, langs in names:
+            for _, blob in langs:
+                entries += struct.pack("<IIII", rva + blob_start + len(blobs), len(blob), 1200, 0)
+                blobs = pad4(blobs + blob)
+    return out + entries + pad4(strings) + blobs
+
+
+def pe(resources, pe32plus=False, rsrc_rva_override=None, truncate_rsrc=0):
+    text = b"\xc3" + b"\xcc" * 15  # ret
+    sections = [(b".text", text, 0x60000020)]
+    rsrc_rva = SECTION_ALIGN * 2
+    rsrc = resource_section(rsrc_rva, resources) if resources is not None else b""
+    if resources is not None:
+        sections.append((b".rsrc", rsrc, 0x40000040))
+    opt_size = 240 if pe32plus else 224
+    headers = 0x80 + 24 + opt_size + 40 * len(sections)
+    size_of_headers = -(-headers // FILE_ALIGN) * FILE_ALIGN
+    raw, raw_ptr, table = b"", size_of_headers, b""
+    for i, (name, body, flags) in enumerate(sections):
+        va = SECTION_ALIGN * (i + 1)
+        raw_size = -(-len(body) // FILE_ALIGN) * FILE_ALIGN
+        if name == b".rsrc" and truncate_rsrc:
+            raw_size = max(0, raw_size - truncate_rsrc)
+        table += struct.pack("<8sIIIIIIHHI", name, len(body), va, raw_size, raw_ptr + len(raw), 0, 0, 0, 0, flags)
+        raw += body.ljust(raw_size, b"\0")[:raw_size]
+    image_size = SECTION_ALIGN * (len(sections) + 1)
+
+    dos = bytearray(0x80)
+    dos[0:2] = b"MZ"
+    dos[0x3C:0x40] = struct.pack("<I", 0x80)
+    dos[0x40:0x40 + 39] = b"This program cannot be run in DOS mode.".ljust(39)
+    coff = b"PE\0\0" + struct.pack("<HHIIIHH", 0x8664 if pe32plus else 0x14C, len(sections), 0x5F000000, 0, 0, opt_size, 0x22 if pe32plus else 0x102)
+    dirs = [(0, 0)] * 16
+    if resources is not None:
+        dirs[2] = (rsrc_rva_override if rsrc_rva_override is not None else rsrc_rva, len(rsrc))
+    dir_bytes = b"".join(struct.pack("<II", a, s) for a, s in dirs)
+    if pe32plus:
+        opt = struct.pack("<HBBIIIII", 0x20B, 14, 0, FILE_ALIGN, FILE_ALIGN, 0, SECTION_ALIGN, SECTION_ALIGN)
+        opt += struct.pack("<QIIHHHHHHIIIIHHQQQQII", 0x140000000, SECTION_ALIGN, FILE_ALIGN, 6, 0, 0, 0, 6, 0, 0,
+                           image_size, size_of_headers, 0, 3, 0x8160, 0x100000, 0x1000, 0x100000, 0x1000, 0, 16)
+    else:
+        opt = struct.pack("<HBBIIIIII", 0x10B, 14, 0, FILE_ALIGN, FILE_ALIGN, 0, SECTION_ALIGN, SECTION_ALIGN, SECTION_ALIGN * 2)
+        opt += struct.pack("<IIIHHHHHHIIIIHHIIIIII", 0x400000, SECTION_ALIGN, FILE_ALIGN, 6, 0, 0, 0, 6, 0, 0,
+                           image_size, size_of_headers, 0, 3, 0x8140, 0x100000, 0x1000, 0x100000, 0x1000, 0, 16)
+    opt += dir_bytes
+    assert len(opt) == opt_size
+    head = bytes(dos) + coff + opt + table
+    return head.ljust(size_of_headers, b"\0") + raw
+
+
+ENGLISH = [("CompanyName", "Contoso Ltd."), ("FileDescription", "Contoso Widget Tool"),
+           ("FileVersion", "1.2.3.4"), ("ProductName", "Contoso Widget"), ("LegalCopyright", "(c) Contoso")]
+GERMAN = [("CompanyName", "Contoso GmbH"), ("FileDescription", "Werkzeug für Widgets"),
+          ("FileVersion", "1.2.3.4"), ("ProductName", "Contoso Widget Ü")]
+ICON = b"\x28\0\0\0" + b"\0" * 36
+
+
+def corpus():
+    english = version_info([("040904b0", ENGLISH)], [(0x409, 1200)])
+    yield "app32.exe", pe([(16, [(1, 0x409, english)])]), dict(product="Contoso Widget", description="Contoso Widget Tool", company="Contoso Ltd.", version="1.2.3.4")
+    both = version_info([("040704b0", GERMAN), ("040904b0", ENGLISH)], [(0x409, 1200)])
+    yield "app64_translation.exe", pe([(3, [(1, 0x409, ICON)]), (16, [(1, 0x409, both)])], pe32plus=True), dict(product="Contoso Widget", description="Contoso Widget Tool", company="Contoso Ltd.", version="1.2.3.4")
+    german = version_info([("040704b0", GERMAN), ("040904b0", ENGLISH)], None)
+    yield "no_translation.dll", pe([(16, [(1, 0x407, german)])], pe32plus=True), dict(product="Contoso Widget Ü", description="Werkzeug für Widgets", company="Contoso GmbH", version="1.2.3.4")
+    yield "named_types.exe", pe([("MUI", [(1, 0x409, b"\0" * 32)]), ("TYPELIB", [(1, 0, b"\0" * 8)]), (3, [(1, 0x409, ICON), (2, 0x409, ICON)]), (16, [(1, 0x409, english)]), (24, [(1, 0, b"<assembly/>")])]), dict(product="Contoso Widget", description="Contoso Widget Tool", company="Contoso Ltd.", version="1.2.3.4")
+    partial = version_info([("040904b0", [("ProductName", "Only A Name")])], [(0x409, 1200)])
+    yield "product_only.exe", pe([(16, [(1, 0x409, partial)])]), dict(product="Only A Name")
+    yield "no_version.exe", pe([(3, [(1, 0x409, ICON)])]), dict(ok=0)
+    yield "no_resources.exe", pe(None, pe32plus=True), dict(ok=0)
+    yield "rsrc_outside_sections.exe", pe([(16, [(1, 0x409, english)])], rsrc_rva_override=0x9000), dict(ok=0)
+    yield "rsrc_truncated.exe", pe([(16, [(1, 0x409, english)])], truncate_rsrc=0x200), dict(ok=0)
+    yield "not_pe.bin", b"\x7fELF\x02\x01\x01" + b"\0" * 57, dict(ok=0)
+
+
+def main():
+    rows = ["# file\tok\tProductName\tFileDescription\tCompanyName\tFileVersion"]
+    for name, data, expect in corpus():
+        with open(os.path.join(HERE, name), "wb") as f:
+            f.write(data)
+        rows.append("\t".join([name, str(expect.get("ok", 1)), expect.get("product", ""), expect.get("description", ""),
+                               expect.get("company", ""), expect.get("version", "")]))
+    with open(os.path.join(HERE, "expected.tsv"), "w", encoding="utf-8", newline="\n") as f:
+        f.write("\n".join(rows) + "\n")
+
+
+if __name__ == "__main__":
+    main()